@@ -0,0 +1,44 @@
+//
+// alloc_count.hpp — Counting global operator new/delete for the benches
+//
+// Replaces the global allocation operators, so include it from exactly one
+// translation unit per program (the bench's own .cpp). Each block carries a
+// 16-byte header (keeps alignment) holding the requested size, so delete can
+// take it off the live count and free what malloc returned.
+//   g_allocs  calls to operator new / new[]
+//   g_bytes   bytes requested by them
+//   g_live    bytes requested and not yet deleted
+//   g_peak    high-water mark of g_live; a bench resets it to g_live first
+//
+#ifndef ALLOC_COUNT_HPP
+#define ALLOC_COUNT_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+static size_t g_allocs = 0;
+static size_t g_bytes = 0;
+static size_t g_live = 0;
+static size_t g_peak = 0;
+
+void* operator new(size_t n) throw(std::bad_alloc) {
+    char* p = static_cast<char*>(std::malloc(n + 16));
+    if (!p) throw std::bad_alloc();
+    *reinterpret_cast<size_t*>(p) = n;
+    ++g_allocs;
+    g_bytes += n;
+    g_live += n;
+    if (g_live > g_peak) g_peak = g_live;
+    return p + 16;
+}
+void operator delete(void* q) throw() {
+    if (!q) return;
+    char* p = static_cast<char*>(q) - 16;
+    g_live -= *reinterpret_cast<size_t*>(p);
+    std::free(p);
+}
+void* operator new[](size_t n) throw(std::bad_alloc) { return operator new(n); }
+void operator delete[](void* q) throw() { operator delete(q); }
+
+#endif
@@ -0,0 +1,26 @@
+//
+// bench_config.hpp — ServerConfig for benchmarks that run a Server in-process
+//
+#ifndef BENCH_CONFIG_HPP
+#define BENCH_CONFIG_HPP
+
+#include "Server.hpp"
+
+// Nothing may be throttled, dropped or timed out: every connection class
+// gets SendQ and flood limits far above what a run can reach, and the
+// registration and keepalive timers are off.
+inline ServerConfig unthrottledConfig() {
+    ServerConfig cfg;
+    for (int k = 0; k < ServerConfig::CLASS_COUNT; ++k) {
+        ServerConfig::ConnClass& c = cfg.classes[k];
+        c.sendqSoft = c.sendqDrop = c.sendqHard = 1UL << 30;
+        c.floodRate = c.floodBurst = 1U << 30;
+        c.floodBacklog = 1UL << 30;
+    }
+    cfg.sendqTotal = ~0UL;
+    cfg.regTimeout = 0;
+    cfg.pingInterval = 0;
+    return cfg;
+}
+
+#endif
@@ -0,0 +1,159 @@
+#include "bench_net.hpp"
+#include "Utils.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL 0
+#endif
+
+BenchNet::BenchNet(): _poller(0), _addr(0), _queued(0), _bytesIn(0), _tool("bench") {}
+
+BenchNet::~BenchNet() {
+    for (size_t fd = 0; fd < _byFd.size(); ++fd) if (_byFd[fd] >= 0) close(fd);
+    if (_addr) freeaddrinfo(_addr);
+    delete _poller;
+}
+
+bool BenchNet::setup(const char* tool, const std::string& host, const std::string& port) {
+    _tool = tool;
+    signal(SIGPIPE, SIG_IGN);
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    struct addrinfo hints; std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    int err = getaddrinfo(host.c_str(), port.c_str(), &hints, &_addr);
+    if (err) { std::fprintf(stderr, "%s: %s\n", tool, gai_strerror(err)); return false; }
+    _poller = Poller::create("epoll");
+    return true;
+}
+
+bool BenchNet::open(NetConn& c) {
+    int fd = ::socket(_addr->ai_family, SOCK_STREAM, 0);
+    if (fd >= 0) fcntl(fd, F_SETFL, O_NONBLOCK);
+    if (fd < 0 || (connect(fd, _addr->ai_addr, _addr->ai_addrlen) != 0 && errno != EINPROGRESS)) {
+        std::fprintf(stderr, "%s: connect: %s\n", _tool, std::strerror(errno));
+        if (fd >= 0) close(fd);
+        c.net = NetConn::DEAD;
+        return false;
+    }
+    c.fd = fd;
+    c.net = NetConn::CONNECTING;
+    if ((size_t)fd >= _byFd.size()) _byFd.resize(fd + 1, -1);
+    _byFd[fd] = c.id;
+    _poller->add(fd, POLLIN | POLLOUT);
+    return true;
+}
+
+void BenchNet::watch(NetConn& c) {
+    _poller->modify(c.fd, POLLIN | (c.out.empty() && c.net != NetConn::CONNECTING ? 0 : POLLOUT));
+}
+
+void BenchNet::kill(NetConn& c, Reason why) {
+    if (c.dead()) return;
+    onClose(c, why);
+    _poller->remove(c.fd);
+    close(c.fd);
+    _byFd[c.fd] = -1;
+    _queued -= c.out.size();
+    c.out.clear();
+    c.net = NetConn::DEAD;
+}
+
+void BenchNet::flush(NetConn& c) {
+    bool had = !c.out.empty();
+    while (!c.out.empty()) {
+        ssize_t n = send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n <= 0) { kill(c, CLOSED_BY_PEER); return; }
+        c.out.erase(0, n);
+        _queued -= n;
+    }
+    if (had && c.out.empty()) watch(c);
+}
+
+void BenchNet::queue(NetConn& c, const char* p, size_t n) {
+    if (c.dead()) return;
+    bool idle = c.out.empty();
+    c.out.append(p, n);
+    _queued += n;
+    if (c.net == NetConn::CONNECTING) return;
+    flush(c);
+    if (idle && !c.out.empty() && !c.dead()) watch(c);
+}
+
+void BenchNet::onReadable(NetConn& c) {
+    char buf[65536];
+    unsigned long now = monotonicNsec();
+    while (!c.dead()) {
+        ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n <= 0) { kill(c, CLOSED_BY_PEER); return; }
+        _bytesIn += n;
+        c.in.append(buf, n);
+        if ((size_t)n < sizeof(buf)) break;
+    }
+    size_t start = 0;
+    while (!c.dead()) {
+        size_t e = c.in.find("\r\n", start);
+        if (e == std::string::npos) break;
+        onLine(c, c.in.data() + start, e - start, now);
+        start = e + 2;
+    }
+    if (!c.dead()) c.in.erase(0, start);
+}
+
+// Hangup without POLLIN closes; with it, the read gets the EOF (after any
+// data still buffered) and closes then.
+void BenchNet::pump(int timeoutMs) {
+    std::vector<PollEvent> ready;
+    if (_poller->wait(ready, timeoutMs) < 0) return;
+    for (size_t i = 0; i < ready.size(); ++i) {
+        int fd = ready[i].fd;
+        if ((size_t)fd >= _byFd.size() || _byFd[fd] < 0) continue;
+        NetConn& c = connAt(_byFd[fd]);
+        short re = ready[i].revents;
+        if (c.net == NetConn::CONNECTING && (re & (POLLOUT | POLLERR | POLLHUP))) {
+            int err = 0; socklen_t len = sizeof(err);
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+            if (err) { kill(c, CONNECT_FAILED); continue; }
+            c.net = NetConn::OPEN;
+            if (c.out.empty()) watch(c);
+        }
+        if (re & POLLIN) onReadable(c);
+        if (!c.dead() && (re & POLLOUT)) flush(c);
+        if (!c.dead() && (re & (POLLHUP | POLLERR)) && !(re & POLLIN)) kill(c, CLOSED_BY_PEER);
+        if (!c.dead()) afterEvent(c);
+    }
+}
+
+bool splitOption(const std::string& kv, std::string& key, std::string& value) {
+    size_t eq = kv.find('=');
+    if (eq == std::string::npos) return false;
+    key = kv.substr(0, eq);
+    value = kv.substr(eq + 1);
+    return true;
+}
+
+double secs(unsigned long ns) { return ns / 1e9; }
+double us(unsigned long ns) { return ns / 1e3; }
+
+void printLatency(const char* what, const Histogram& h) {
+    if (!h.count) { std::printf("%-8s none\n", what); return; }
+    std::printf("%-8s p50 %.1f us  p99 %.1f us  p999 %.1f us  max %.1f us  (n=%lu)\n", what,
+                us(h.quantile(0.5)), us(h.quantile(0.99)), us(h.quantile(0.999)), us(h.max), h.count);
+}
@@ -0,0 +1,103 @@
+//
+// bench_net.hpp — Non-blocking IRC client plumbing shared by ircbench and
+// ircreplay
+//
+// BenchNet owns the epoll Poller and the resolved server address, and runs
+// any number of client connections from one event loop: non-blocking
+// connect, an output buffer flushed on POLLOUT, CRLF line splitting on
+// input. A tool keeps its connections in its own container (each derives
+// from NetConn) and supplies the callbacks: connAt() to find one by id,
+// onLine() for each line received, onClose() when one goes away, and
+// afterEvent() once a connection's readiness has been handled.
+//
+#ifndef BENCH_NET_HPP
+#define BENCH_NET_HPP
+
+#include "Poller.hpp"
+#include "Metrics.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct addrinfo;
+
+/** @brief Transport state of one client connection. */
+struct NetConn {
+    enum State { CONNECTING, OPEN, DEAD };
+    int         id;     // the tool's index, passed back through connAt()
+    int         fd;
+    State       net;
+    std::string in, out;
+    NetConn(): id(-1), fd(-1), net(CONNECTING) {}
+    bool dead() const { return net == DEAD; }
+};
+
+class BenchNet {
+public:
+    /** @brief Why onClose() was called. */
+    enum Reason { CLOSED_BY_US, CLOSED_BY_PEER, CONNECT_FAILED };
+
+    BenchNet();
+    virtual ~BenchNet();
+
+    /**
+     * @brief Ignore SIGPIPE, raise RLIMIT_NOFILE to the hard limit, resolve
+     *        host:port and create the poller. Errors go to stderr as "tool: ...".
+     */
+    bool setup(const char* tool, const std::string& host, const std::string& port);
+
+    /**
+     * @brief Start a non-blocking connect for c, whose id must be set.
+     *        What is queue()d before it completes goes out once it does.
+     * @return false if it failed at once (c is DEAD, onClose() not called).
+     */
+    bool open(NetConn& c);
+    /** @brief Append bytes to c's output and write what the socket takes. */
+    void queue(NetConn& c, const char* p, size_t n);
+    void queue(NetConn& c, const std::string& s) { queue(c, s.data(), s.size()); }
+    /** @brief Write c's output until it is empty or the socket is full. */
+    void flush(NetConn& c);
+    /** @brief Close c (no-op if DEAD); onClose() runs first. */
+    void kill(NetConn& c, Reason why = CLOSED_BY_US);
+    /** @brief Wait up to timeoutMs and handle every ready connection. */
+    void pump(int timeoutMs);
+
+    /** @return Bytes waiting in every connection's output buffer. */
+    size_t queued() const { return _queued; }
+    /** @return Bytes received on every connection so far. */
+    unsigned long bytesIn() const { return _bytesIn; }
+
+protected:
+    virtual NetConn& connAt(int id) = 0;
+    /** @brief A complete line (CRLF stripped) arrived at time now (ns). */
+    virtual void onLine(NetConn& c, const char* p, size_t n, unsigned long now) = 0;
+    /** @brief c is about to be closed; its state and buffers are intact. */
+    virtual void onClose(NetConn&, Reason) {}
+    /** @brief c's readiness was handled this pump() and it is still open. */
+    virtual void afterEvent(NetConn&) {}
+
+private:
+    Poller*           _poller;
+    struct addrinfo*  _addr;
+    std::vector<int>  _byFd;    // fd -> conn id, -1 if none
+    size_t            _queued;
+    unsigned long     _bytesIn;
+    const char*       _tool;
+
+    void watch(NetConn& c);
+    void onReadable(NetConn& c);
+
+    BenchNet(const BenchNet&);
+    BenchNet& operator=(const BenchNet&);
+};
+
+/** @brief Split "key=value"; @return false if there is no '='. */
+bool splitOption(const std::string& kv, std::string& key, std::string& value);
+
+double secs(unsigned long ns);
+double us(unsigned long ns);
+/** @brief "what p50 .. p99 .. p999 .. max .. (n=..)" in microseconds, or "none". */
+void printLatency(const char* what, const Histogram& h);
+
+#endif
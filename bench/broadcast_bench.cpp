@@ -0,0 +1,83 @@
+//
+// broadcast_bench.cpp — Memory and CPU cost of channel fan-out
+//
+// Compares the two ways a channel line can reach <members> output queues:
+//   copy:   one std::string append per member (the old Client::_outbuf)
+//   shared: one Segment built once, a SegmentRef pushed per member (OutQueue)
+//
+// Each round queues <backlog> lines per member (slow readers that have not
+// drained yet), then drains every queue. Allocations and peak live heap
+// bytes are counted through alloc_count.hpp.
+//
+// Usage: ./bench/broadcast_bench [members=2000] [backlog=50] [linelen=200] [rounds=20]
+//
+#include "alloc_count.hpp"
+#include "OutQueue.hpp"
+#include "Utils.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+struct Result { double usPerBroadcast; double allocsPerBroadcast; size_t peakBytes; };
+
+static Result runCopy(int members, int backlog, const std::string& line, int rounds) {
+    size_t base = g_live; g_peak = g_live;
+    std::vector<std::string> q(members);
+    size_t a0 = g_allocs; unsigned long spent = 0;
+    for (int r = 0; r < rounds; ++r) {
+        unsigned long t0 = monotonicNsec();
+        for (int b = 0; b < backlog; ++b)
+            for (int m = 0; m < members; ++m) q[m].append(line);
+        spent += monotonicNsec() - t0;
+        for (int m = 0; m < members; ++m) std::string().swap(q[m]); // drained
+    }
+    Result res;
+    res.usPerBroadcast = spent / 1e3 / (rounds * backlog);
+    res.allocsPerBroadcast = (double)(g_allocs - a0) / (rounds * backlog);
+    res.peakBytes = g_peak - base;
+    return res;
+}
+
+static Result runShared(int members, int backlog, const std::string& line, int rounds) {
+    size_t base = g_live; g_peak = g_live;
+    std::vector<OutQueue> q(members); // counted: deque bookkeeping is real cost
+    size_t a0 = g_allocs; unsigned long spent = 0;
+    for (int r = 0; r < rounds; ++r) {
+        unsigned long t0 = monotonicNsec();
+        for (int b = 0; b < backlog; ++b) {
+            SegmentRef seg(line);
+            for (int m = 0; m < members; ++m) q[m].push(seg);
+        }
+        spent += monotonicNsec() - t0;
+        for (int m = 0; m < members; ++m) q[m].clear(); // drained
+    }
+    Result res;
+    res.usPerBroadcast = spent / 1e3 / (rounds * backlog);
+    res.allocsPerBroadcast = (double)(g_allocs - a0) / (rounds * backlog);
+    res.peakBytes = g_peak - base;
+    return res;
+}
+
+int main(int ac, char** av) {
+    int members = ac > 1 ? std::atoi(av[1]) : 2000;
+    int backlog = ac > 2 ? std::atoi(av[2]) : 50;
+    int linelen = ac > 3 ? std::atoi(av[3]) : 200;
+    int rounds  = ac > 4 ? std::atoi(av[4]) : 20;
+    std::string line(":nick PRIVMSG #chan :");
+    line.append(linelen > (int)line.size() + 2 ? linelen - line.size() - 2 : 1, 'x');
+    line += "\r\n";
+
+    Result c = runCopy(members, backlog, line, rounds);
+    Result s = runShared(members, backlog, line, rounds);
+    std::printf("members=%d backlog=%d linelen=%d rounds=%d\n", members, backlog, (int)line.size(), rounds);
+    std::printf("%-7s %10.2f us/broadcast %10.1f allocs/broadcast %10.2f MiB peak\n",
+                "copy", c.usPerBroadcast, c.allocsPerBroadcast, c.peakBytes / 1048576.0);
+    std::printf("%-7s %10.2f us/broadcast %10.1f allocs/broadcast %10.2f MiB peak\n",
+                "shared", s.usPerBroadcast, s.allocsPerBroadcast, s.peakBytes / 1048576.0);
+    std::printf("saved   %9.1f%% cpu %21s %9.1f%% memory\n",
+                100.0 * (1.0 - s.usPerBroadcast / c.usPerBroadcast), "",
+                100.0 * (1.0 - (double)s.peakBytes / (double)c.peakBytes));
+    return 0;
+}
@@ -0,0 +1,225 @@
+//
+// fanout_bench.cpp — Lines and bytes a NICK/QUIT costs, per channel vs per peer
+//
+// Builds a membership graph with heavy channel overlap on a real Server (over
+// MemoryTransport, every user registered and JOINed through the server's own
+// commands) and, for every user, queues one NICK and one QUIT line about that
+// user two ways, counting what the server actually queues (MSGS_OUT and
+// BYTES_QUEUED):
+//   per-channel: Server::broadcast() to each of the user's channels (the old
+//                cmdNICK/removeClient loop), so a peer sharing k channels
+//                gets k copies
+//   per-peer:    Server::broadcastPeers(), one copy per distinct peer
+// The per-channel count is checked against the channel sizes and the
+// per-peer count against a std::set of the members; the time spent in each
+// call is reported per event. Queues are flushed between users, untimed.
+//
+// Two populations are mixed:
+//   team:      <team> users who all sit in the same <teamchans> channels
+//   community: <users> users joining 1..30 channels each (popular channels
+//              picked more often) out of <channels>
+//
+// Usage: ./bench/fanout_bench [users=5000] [channels=300] [team=200] [teamchans=30]
+//
+#include "bench_config.hpp"
+#include "Server.hpp"
+#include "Transport.hpp"
+#include "Clock.hpp"
+#include "Channel.hpp"
+#include "Client.hpp"
+#include "Utils.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static unsigned long g_rng = 12345;
+static unsigned rnd(unsigned n) {
+    g_rng = g_rng * 1103515245UL + 12345UL;
+    return (unsigned)((g_rng >> 8) % n);
+}
+
+struct Sim {
+    MemoryTransport   net;
+    SimClock          clock;
+    Server*           srv;
+    std::vector<int>  fds;       // user -> connection
+    std::vector<std::vector<unsigned> > joined; // user -> channels asked for
+};
+
+static std::string nickOf(unsigned u) {
+    std::ostringstream o;
+    o << "u" << u;
+    return o.str();
+}
+
+static std::string chanOf(unsigned ch) {
+    std::ostringstream o;
+    o << "#c" << ch;
+    return o.str();
+}
+
+static void join(Sim& s, unsigned u, unsigned ch) {
+    for (size_t i = 0; i < s.joined[u].size(); ++i) if (s.joined[u][i] == ch) return;
+    s.joined[u].push_back(ch);
+}
+
+static void plan(Sim& s, unsigned users, unsigned channels, unsigned team, unsigned teamChans) {
+    s.joined.resize(team + users);
+    for (unsigned u = 0; u < team; ++u)
+        for (unsigned ch = 0; ch < teamChans; ++ch) join(s, u, ch);
+    for (unsigned u = team; u < team + users; ++u) {
+        unsigned n = 1 + rnd(6) + (rnd(4) == 0 ? rnd(24) : 0); // mostly few, a tail up to 30
+        for (unsigned k = 0; k < n; ++k) {
+            // the smaller of two draws skews toward low (popular) channel numbers
+            unsigned a = rnd(channels), b = rnd(channels);
+            join(s, u, teamChans + (a < b ? a : b));
+        }
+        if (rnd(10) == 0) join(s, u, rnd(teamChans)); // a few outsiders lurk in team channels
+    }
+}
+
+// Tick until every byte sent has been read and every queue written out.
+static bool drive(Sim& s) {
+    for (unsigned long ticks = 0; !s.net.drained() || !s.srv->idle(); ++ticks) {
+        if (!s.srv->step(0) || ticks > 100000) {
+            std::fprintf(stderr, "server did not go idle\n");
+            return false;
+        }
+        s.clock.advance(1000);
+    }
+    return true;
+}
+
+// Register every user and send its JOINs; only the server's state is kept.
+static bool populate(Sim& s) {
+    s.net.keepOutput(false);
+    for (unsigned u = 0; u < s.joined.size(); ++u) {
+        int fd = s.net.connect();
+        std::string nick = nickOf(u);
+        std::string in = "CAP REQ :ircserv/no-hints\r\nPASS pw\r\nNICK " + nick
+                       + "\r\nUSER " + nick + " 0 * :fanout\r\nCAP END\r\n";
+        for (size_t k = 0; k < s.joined[u].size(); ++k) in += "JOIN " + chanOf(s.joined[u][k]) + "\r\n";
+        s.net.send(fd, in);
+        s.fds.push_back(fd);
+    }
+    if (!drive(s)) return false;
+    for (unsigned u = 0; u < s.joined.size(); ++u) {
+        Client* c = s.srv->findClientByNick(nickOf(u));
+        if (!c || c->channels().size() != s.joined[u].size()) {
+            std::fprintf(stderr, "user %u did not register or join\n", u);
+            return false;
+        }
+    }
+    return true;
+}
+
+struct Tally {
+    unsigned long lines, bytes, ns;
+    Tally(): lines(0), bytes(0), ns(0) {}
+};
+
+// One event through one path: count what the server queued, time the call.
+static void fanout(Sim& s, Client& c, const MsgBuilder& m, bool perPeer, Tally& t) {
+    const Metrics& mx = s.srv->metrics();
+    unsigned long lines0 = mx.counter(Metrics::MSGS_OUT);
+    unsigned long bytes0 = mx.counter(Metrics::BYTES_QUEUED);
+    unsigned long t0 = monotonicNsec();
+    if (perPeer) s.srv->broadcastPeers(c, m, c.fd());
+    else {
+        const std::vector<Atom>& chans = c.channels();
+        for (size_t k = 0; k < chans.size(); ++k) s.srv->broadcast(s.srv->channelByAtom(chans[k]), m, c.fd());
+    }
+    t.ns += monotonicNsec() - t0;
+    t.lines += mx.counter(Metrics::MSGS_OUT) - lines0;
+    t.bytes += mx.counter(Metrics::BYTES_QUEUED) - bytes0;
+}
+
+// What each path should reach for c, from the channels' member lists.
+static void expected(Sim& s, const Client& c, unsigned long& lines, unsigned long& peers) {
+    std::set<unsigned> seen;
+    lines = 0;
+    const std::vector<Atom>& chans = c.channels();
+    for (size_t k = 0; k < chans.size(); ++k) {
+        Channel* ch = s.srv->channelByAtom(chans[k]);
+        lines += ch->memberCount() - 1;
+        const std::vector<Channel::Member>& mem = ch->entries();
+        for (size_t i = 0; i < mem.size(); ++i)
+            if ((mem[i].roles & Channel::JOINED) && mem[i].id != c.memberId()) seen.insert(mem[i].id);
+    }
+    peers = seen.size();
+}
+
+static bool report(Sim& s, const char* name, unsigned from, unsigned to) {
+    if (from == to) return true;
+    Tally nick[2], quit[2]; // [0] per-channel, [1] per-peer
+    bool ok = true;
+    for (unsigned u = from; u < to; ++u) {
+        Client& c = *s.srv->findClientByNick(nickOf(u));
+        unsigned long lines, peers;
+        expected(s, c, lines, peers);
+        unsigned long before[2] = { nick[0].lines, nick[1].lines };
+        for (int p = 0; p < 2; ++p) {
+            MsgBuilder m(s.srv->arena());
+            m << ':' << c.nick() << " NICK :" << c.nick() << "_\r\n";
+            fanout(s, c, m, p == 1, nick[p]);
+            m.clear();
+            m << ':' << c.nick() << " QUIT :Client disconnected\r\n";
+            fanout(s, c, m, p == 1, quit[p]);
+        }
+        if (nick[0].lines - before[0] != lines || nick[1].lines - before[1] != peers) {
+            std::fprintf(stderr, "%s: user %u reached %lu/%lu, expected %lu/%lu\n", name, u,
+                         nick[0].lines - before[0], nick[1].lines - before[1], lines, peers);
+            ok = false;
+        }
+        if ((u - from) % 64 == 63 || u + 1 == to) ok = drive(s) && ok;
+    }
+    double n = to - from;
+    std::printf("%-10s users=%-5u lines/event %8.1f -> %7.1f  NICK bytes %9.0f -> %8.0f  QUIT bytes %9.0f -> %8.0f  (%.1fx)"
+                "  ns/event %8.0f -> %7.0f%s\n",
+                name, to - from, nick[0].lines / n, nick[1].lines / n,
+                nick[0].bytes / n, nick[1].bytes / n, quit[0].bytes / n, quit[1].bytes / n,
+                nick[1].lines ? (double)nick[0].lines / nick[1].lines : 1.0,
+                (nick[0].ns + quit[0].ns) / (2 * n), (nick[1].ns + quit[1].ns) / (2 * n),
+                ok ? "" : "  MISMATCH");
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    unsigned users = 5000, channels = 300, team = 200, teamChans = 30;
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        if (!std::strncmp(a, "users=", 6)) users = std::strtoul(a + 6, 0, 10);
+        else if (!std::strncmp(a, "channels=", 9)) channels = std::strtoul(a + 9, 0, 10);
+        else if (!std::strncmp(a, "team=", 5)) team = std::strtoul(a + 5, 0, 10);
+        else if (!std::strncmp(a, "teamchans=", 10)) teamChans = std::strtoul(a + 10, 0, 10);
+        else channels = 0;
+    }
+    if (channels < 1 || teamChans < 1) {
+        std::fprintf(stderr, "usage: %s [users=N] [channels=N] [team=N] [teamchans=N]\n", argv[0]);
+        return 2;
+    }
+
+    Sim s;
+    ServerConfig cfg = unthrottledConfig();
+    cfg.backlog = 1 << 16;
+    cfg.acceptBudget = cfg.welcomeBudget = 4096;
+    cfg.transport = &s.net;
+    cfg.clock = &s.clock;
+    Server srv("0", "pw", cfg);
+    s.srv = &srv;
+
+    plan(s, users, channels, team, teamChans);
+    if (!populate(s)) return 1;
+    unsigned all = team + users;
+    std::printf("users=%u channels=%u team=%u teamchans=%u\n", users, channels, team, teamChans);
+    bool ok = report(s, "team", 0, team);
+    ok = report(s, "community", team, all) && ok;
+    ok = report(s, "all", 0, all) && ok;
+    for (size_t i = 0; i < s.fds.size(); ++i) s.net.hangup(s.fds[i]);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,81 @@
+//
+// intern_bench.cpp — Heap held by repeated nick/channel name copies
+//
+// Builds the name-keyed state of <users> clients spread over <channels>
+// channels (<per> joins each, uniformly random) in two layouts:
+//   strings: every client keeps a std::set of folded channel names, and the
+//            nick/channel indexes keep their own key copy (the old layout)
+//   atoms:   every client keeps a std::vector<Atom>; each distinct name is
+//            stored once in an AtomTable
+// Display names (Client::_nick, Channel::_name) are the same in both layouts
+// and are not counted. Live heap bytes come from alloc_count.hpp.
+//
+// Usage: ./bench/intern_bench [users=50000] [channels=5000] [per=8]
+//
+#include "alloc_count.hpp"
+#include "AtomTable.hpp"
+#include "Utils.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <vector>
+
+static std::string nickName(int i) {
+    char b[32]; std::sprintf(b, "User%05d", i); return b;
+}
+static std::string chanName(int i) {
+    char b[32]; std::sprintf(b, "#Channel-%04d", i); return b;
+}
+
+int main(int ac, char** av) {
+    int users    = ac > 1 ? std::atoi(av[1]) : 50000;
+    int channels = ac > 2 ? std::atoi(av[2]) : 5000;
+    int per      = ac > 3 ? std::atoi(av[3]) : 8;
+
+    // the same membership for both layouts
+    std::vector<int> joins((size_t)users * per);
+    std::srand(42);
+    for (size_t i = 0; i < joins.size(); ++i) joins[i] = std::rand() % channels;
+
+    size_t base = g_live;
+    size_t strBytes;
+    {
+        std::vector<std::string> nickKeys(users), chanKeys(channels);
+        std::vector<std::set<std::string> > member(users);
+        for (int u = 0; u < users; ++u) nickKeys[u] = toLower(nickName(u));
+        for (int c = 0; c < channels; ++c) chanKeys[c] = toLower(chanName(c));
+        for (int u = 0; u < users; ++u)
+            for (int k = 0; k < per; ++k)
+                member[u].insert(toLower(chanName(joins[(size_t)u * per + k])));
+        strBytes = g_live - base;
+    }
+
+    base = g_live;
+    size_t atomBytes;
+    {
+        AtomTable atoms;
+        std::vector<Atom> nickAtom(users), chanAtom(channels);
+        std::vector<std::vector<Atom> > member(users);
+        for (int u = 0; u < users; ++u) nickAtom[u] = atoms.intern(nickName(u));
+        for (int c = 0; c < channels; ++c) chanAtom[c] = atoms.intern(chanName(c));
+        for (int u = 0; u < users; ++u) {
+            std::vector<Atom>& m = member[u];
+            for (int k = 0; k < per; ++k) {
+                Atom a = chanAtom[joins[(size_t)u * per + k]];
+                bool dup = false;
+                for (size_t j = 0; j < m.size(); ++j) if (m[j] == a) dup = true;
+                if (!dup) m.push_back(a);
+            }
+        }
+        atomBytes = g_live - base;
+    }
+
+    std::printf("users=%d channels=%d joins/user=%d\n", users, channels, per);
+    std::printf("%-8s %10.2f MiB\n", "strings", strBytes / 1048576.0);
+    std::printf("%-8s %10.2f MiB\n", "atoms", atomBytes / 1048576.0);
+    std::printf("saved    %10.2f MiB (%.1f%%)\n", (strBytes - atomBytes) / 1048576.0,
+                100.0 * (1.0 - (double)atomBytes / (double)strBytes));
+    return 0;
+}
@@ -0,0 +1,296 @@
+//
+// ircbench.cpp — Load generator and end-to-end latency benchmark for ircserv
+//
+// Opens <clients> connections to a running server from one event loop,
+// registers them (CAP ircserv/no-hints, PASS, NICK, USER), joins each to
+// <join> of <channels> channels, then sends PRIVMSG to those channels at
+// <rate> messages/s in total for <duration> seconds. Every message carries
+// the time it was scheduled to go out; receivers subtract it from their
+// arrival time, so queueing inside the benchmark counts too (no coordinated
+// omission). Reports registration and join times, sustained msgs/s (and
+// schedule slots skipped because their sender never joined), fan-out
+// deliveries/s, p50/p99/p999 end-to-end latency, and lost lines. Expected
+// deliveries count the channel members that are joined and alive when a
+// message is sent.
+//
+// With storm=1 every client registers first and all JOINs are sent at once;
+// the per-client time to its last 366 is the join latency.
+//
+// Usage: ./bench/ircbench [scenario-file ...] [key=value ...]
+//
+// A scenario file holds key=value lines (# starts a comment); arguments are
+// applied in order, so later ones override. See bench/scenarios/. Keys:
+//   host=127.0.0.1 port=6667 pass=pw   server to load
+//   clients=100                        connections
+//   channels=1 join=1                  channel count, channels per client
+//   senders=0                          clients that send (0 = all)
+//   rate=1000 duration=10 size=64      msgs/s in total, seconds, text bytes
+//   connect_rate=0                     new connections/s (0 = no pacing)
+//   storm=0                            join everyone at once after registration
+//   setup_timeout=60 linger=5          seconds for setup, for trailing deliveries
+//
+// The server's per-client flood limits apply to the senders: run it with
+// IRCSERV_FLOOD_USER raised (e.g. 100000,100000,1000000) unless rate/senders
+// stays under 20 msgs/s. Large client counts need RLIMIT_NOFILE raised on
+// both sides; ircbench raises its own soft limit to the hard limit.
+//
+#include "bench_net.hpp"
+#include "Utils.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+struct Options {
+    std::string host, port, pass;
+    int clients, channels, join, senders, size;
+    double rate, duration, connectRate, setupTimeout, linger;
+    bool storm;
+    Options(): host("127.0.0.1"), port("6667"), pass("pw"), clients(100), channels(1), join(1),
+               senders(0), size(64), rate(1000), duration(10), connectRate(0), setupTimeout(60),
+               linger(5), storm(false) {}
+};
+
+static bool setOption(Options& o, const std::string& kv) {
+    std::string k, v;
+    if (!splitOption(kv, k, v)) return false;
+    const char* s = v.c_str();
+    if (k == "host") o.host = v;
+    else if (k == "port") o.port = v;
+    else if (k == "pass") o.pass = v;
+    else if (k == "clients") o.clients = std::atoi(s);
+    else if (k == "channels") o.channels = std::atoi(s);
+    else if (k == "join") o.join = std::atoi(s);
+    else if (k == "senders") o.senders = std::atoi(s);
+    else if (k == "size") o.size = std::atoi(s);
+    else if (k == "rate") o.rate = std::atof(s);
+    else if (k == "duration") o.duration = std::atof(s);
+    else if (k == "connect_rate") o.connectRate = std::atof(s);
+    else if (k == "setup_timeout") o.setupTimeout = std::atof(s);
+    else if (k == "linger") o.linger = std::atof(s);
+    else if (k == "storm") o.storm = std::atoi(s) != 0;
+    else return false;
+    return true;
+}
+
+static bool loadScenario(Options& o, const char* path) {
+    std::ifstream in(path);
+    if (!in) { std::fprintf(stderr, "ircbench: cannot read %s\n", path); return false; }
+    std::string line;
+    for (int n = 1; std::getline(in, line); ++n) {
+        size_t h = line.find('#');
+        if (h != std::string::npos) line.erase(h);
+        size_t b = line.find_first_not_of(" \t\r"), e = line.find_last_not_of(" \t\r");
+        if (b == std::string::npos) continue;
+        if (!setOption(o, line.substr(b, e - b + 1))) {
+            std::fprintf(stderr, "ircbench: %s:%d: unknown setting\n", path, n);
+            return false;
+        }
+    }
+    return true;
+}
+
+enum Stage { REGISTERING, REGISTERED, JOINING, READY };
+
+struct Conn : NetConn {
+    Stage            state;     // meaningful while the connection is alive
+    std::vector<int> chans;     // channel indexes this client joins
+    size_t           joinsLeft; // 366s still expected
+    unsigned long    joinStart; // ns when its JOINs were sent
+    size_t           next;      // round-robin over chans when sending
+    Conn(): state(REGISTERING), joinsLeft(0), joinStart(0), next(0) {}
+};
+
+struct Bench : public BenchNet {
+    Options              o;
+    std::vector<Conn>    conns;
+    std::vector<int>     members;   // channel -> READY clients in it
+    int                  opened, registered, joined, dead;
+    unsigned long        slots, sent, skipped, delivered, expected, joinLines;
+    Histogram            latency;   // ns, PRIVMSG scheduled -> received
+    Histogram            joinLat;   // ns, JOINs sent -> last 366
+    Bench(): opened(0), registered(0), joined(0), dead(0),
+             slots(0), sent(0), skipped(0), delivered(0), expected(0), joinLines(0),
+             latency(), joinLat() {}
+
+    void setMember(Conn& c, int delta);
+    void sendJoins(Conn& c);
+    void openOne(int i);
+    virtual NetConn& connAt(int id) { return conns[id]; }
+    virtual void onLine(NetConn& nc, const char* p, size_t n, unsigned long now);
+    virtual void onClose(NetConn& nc, Reason);
+};
+
+// Membership counts only READY clients, so expected deliveries leave out
+// the ones that never finished joining or have died since.
+void Bench::setMember(Conn& c, int delta) {
+    for (size_t i = 0; i < c.chans.size(); ++i) members[c.chans[i]] += delta;
+}
+
+void Bench::onClose(NetConn& nc, Reason) {
+    Conn& c = static_cast<Conn&>(nc);
+    if (c.state == READY) setMember(c, -1);
+    ++dead;
+}
+
+static std::string chanName(int i) {
+    char buf[32];
+    std::sprintf(buf, "#bench%d", i);
+    return buf;
+}
+
+// One JOIN per channel: the server's JOIN takes a single channel.
+void Bench::sendJoins(Conn& c) {
+    std::string line;
+    for (size_t i = 0; i < c.chans.size(); ++i) line += "JOIN " + chanName(c.chans[i]) + "\r\n";
+    c.state = JOINING;
+    c.joinsLeft = c.chans.size();
+    c.joinStart = monotonicNsec();
+    queue(c, line);
+}
+
+void Bench::openOne(int i) {
+    Conn& c = conns[i];
+    c.id = i;
+    ++opened;
+    if (!open(c)) { ++dead; return; }
+    char reg[256];
+    std::sprintf(reg, "CAP REQ :ircserv/no-hints\r\nCAP END\r\nPASS %s\r\nNICK b%d\r\nUSER b%d 0 * :ircbench\r\n",
+                 o.pass.c_str(), i, i);
+    queue(c, reg);
+}
+
+// Only the lines the benchmark cares about are looked at: 001, 366, JOIN
+// echoes, PING, ERROR and our own PRIVMSG payloads.
+void Bench::onLine(NetConn& nc, const char* p, size_t n, unsigned long now) {
+    Conn& c = static_cast<Conn&>(nc);
+    if (n >= 4 && std::memcmp(p, "PING", 4) == 0) {
+        queue(c, "PONG" + std::string(p + 4, n - 4) + "\r\n");
+        return;
+    }
+    if (n >= 5 && std::memcmp(p, "ERROR", 5) == 0) { kill(c); return; }
+    const char* sp = static_cast<const char*>(std::memchr(p, ' ', n));
+    if (!sp || p[0] != ':') return;
+    const char* cmd = sp + 1;
+    size_t left = n - (cmd - p);
+    if (left > 8 && std::memcmp(cmd, "PRIVMSG ", 8) == 0) {
+        static const char tag[] = " :ircbench ";
+        for (const char* q = cmd + 8; q + sizeof(tag) - 1 <= p + n; ++q) {
+            if (*q != ' ' || std::memcmp(q, tag, sizeof(tag) - 1) != 0) continue;
+            unsigned long t = std::strtoul(q + sizeof(tag) - 1, 0, 10);
+            latency.record(now > t ? now - t : 0);
+            ++delivered;
+            return;
+        }
+        return;
+    }
+    if (left > 5 && std::memcmp(cmd, "JOIN ", 5) == 0) { ++joinLines; return; }
+    if (left > 4 && std::memcmp(cmd, "001 ", 4) == 0 && c.state == REGISTERING) {
+        c.state = REGISTERED;
+        ++registered;
+        if (!o.storm) sendJoins(c);
+        return;
+    }
+    if (left > 4 && std::memcmp(cmd, "366 ", 4) == 0 && c.state == JOINING && c.joinsLeft) {
+        if (--c.joinsLeft) return;
+        c.state = READY;
+        setMember(c, 1);
+        ++joined;
+        joinLat.record(now - c.joinStart);
+    }
+}
+
+int main(int ac, char** av) {
+    Bench b;
+    Options& o = b.o;
+    for (int i = 1; i < ac; ++i) {
+        if (std::strchr(av[i], '=')) {
+            if (!setOption(o, av[i])) { std::fprintf(stderr, "ircbench: unknown setting %s\n", av[i]); return 1; }
+        } else if (!loadScenario(o, av[i])) return 1;
+    }
+    if (o.clients < 1 || o.channels < 1 || o.join < 1 || o.size < 0 || o.rate < 0) {
+        std::fprintf(stderr, "ircbench: clients, channels and join must be >= 1\n");
+        return 1;
+    }
+    if (o.join > o.channels) o.join = o.channels;
+    if (o.senders <= 0 || o.senders > o.clients) o.senders = o.clients;
+    if (!b.setup("ircbench", o.host, o.port)) return 1;
+
+    b.conns.resize(o.clients);
+    b.members.assign(o.channels, 0);
+    int stride = o.channels / o.join;
+    for (int i = 0; i < o.clients; ++i)
+        for (int j = 0; j < o.join; ++j) b.conns[i].chans.push_back((i + j * stride) % o.channels);
+
+    std::printf("clients=%d channels=%d join=%d senders=%d rate=%g duration=%g size=%d storm=%d\n",
+                o.clients, o.channels, o.join, o.senders, o.rate, o.duration, o.size, o.storm ? 1 : 0);
+
+    // connect and register (and, unless storming, join as soon as welcomed)
+    unsigned long t0 = monotonicNsec(), deadline = t0 + (unsigned long)(o.setupTimeout * 1e9);
+    while (monotonicNsec() < deadline) {
+        unsigned long now = monotonicNsec();
+        int want = o.connectRate > 0 ? (int)(secs(now - t0) * o.connectRate) + 1 : o.clients;
+        while (b.opened < want && b.opened < o.clients) b.openOne(b.opened);
+        int settled = (o.storm ? b.registered : b.joined) + b.dead;
+        if (settled >= o.clients) break;
+        b.pump(1);
+    }
+    unsigned long tReg = monotonicNsec();
+    std::printf("setup    %d/%d registered, %d joined, %d failed in %.2f s\n",
+                b.registered, o.clients, b.joined, b.dead, secs(tReg - t0));
+
+    if (o.storm) {
+        unsigned long s0 = monotonicNsec();
+        for (int i = 0; i < o.clients; ++i)
+            if (!b.conns[i].dead() && b.conns[i].state == REGISTERED) b.sendJoins(b.conns[i]);
+        deadline = s0 + (unsigned long)(o.setupTimeout * 1e9);
+        while (b.joined + b.dead < o.clients && monotonicNsec() < deadline) b.pump(1);
+        unsigned long s1 = monotonicNsec();
+        std::printf("storm    %d joined, %d failed in %.3f s, %lu JOIN lines received (%.0f/s)\n",
+                    b.joined, b.dead, secs(s1 - s0), b.joinLines, b.joinLines / secs(s1 - s0 ? s1 - s0 : 1));
+    }
+    printLatency("join", b.joinLat);
+
+    // steady send phase: slot k is due at start + k / rate; a slot whose
+    // sender is not READY is skipped, not sent
+    if (o.rate > 0 && o.duration > 0) {
+        std::string pad(o.size > 0 ? o.size : 0, 'x');
+        unsigned long s0 = monotonicNsec(), end = s0 + (unsigned long)(o.duration * 1e9);
+        double perNs = o.rate / 1e9;
+        int sender = 0;
+        char head[128];
+        while (true) {
+            unsigned long now = monotonicNsec();
+            if (now >= end) break;
+            unsigned long due = (unsigned long)((now - s0) * perNs);
+            while (b.slots < due) {
+                Conn& c = b.conns[sender];
+                sender = (sender + 1) % o.senders;
+                unsigned long at = s0 + (unsigned long)(b.slots / perNs);
+                ++b.slots;
+                if (c.dead() || c.state != READY) { ++b.skipped; continue; }
+                int ch = c.chans[c.next++ % c.chans.size()];
+                std::sprintf(head, "PRIVMSG %s :ircbench %lu ", chanName(ch).c_str(), at);
+                b.queue(c, head + pad + "\r\n");
+                ++b.sent;
+                b.expected += b.members[ch] - 1;
+            }
+            b.pump(1);
+        }
+        unsigned long s1 = monotonicNsec();
+        unsigned long lingerEnd = s1 + (unsigned long)(o.linger * 1e9);
+        while (b.delivered < b.expected && monotonicNsec() < lingerEnd) b.pump(1);
+        unsigned long s2 = monotonicNsec();
+        std::printf("send     %lu msgs in %.2f s: %.0f msgs/s, %lu slots skipped (sender not joined)\n",
+                    b.sent, secs(s1 - s0), b.sent / secs(s1 - s0), b.skipped);
+        std::printf("fan-out  %lu of %lu deliveries in %.2f s: %.0f deliveries/s, lost %lu\n",
+                    b.delivered, b.expected, secs(s2 - s0), b.delivered / secs(s2 - s0),
+                    b.expected > b.delivered ? b.expected - b.delivered : 0);
+        printLatency("latency", b.latency);
+    }
+    std::printf("disconnected %d\n", b.dead);
+    return b.dead ? 2 : 0;
+}
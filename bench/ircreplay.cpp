@@ -0,0 +1,307 @@
+//
+// ircreplay.cpp — Play a traffic capture back against a running server
+//
+// Reads a log written by ircserv with IRCSERV_CAPTURE (format in
+// Capture.hpp) and re-enacts it: one connection per captured connection,
+// opened, fed its lines and closed on the captured schedule. speed=1 keeps
+// the original timing, speed=N compresses it N times, speed=0 sends as fast
+// as the server takes it (at most <window> bytes queued at once).
+//
+// Each connection is sent its lines in capture order; across connections
+// the schedule is the capture's, but what the server interleaves within one
+// tick may differ, as it would have live. At speed=0 there is no schedule
+// across connections at all: a client may speak before a peer's JOIN has
+// run, or leave before others' messages reach it, so fan-out is lower than
+// in the capture.
+//
+// Latency is measured with probes: after a batch of lines goes to a
+// connection, "PING ircreplay-<due>" follows it unless that connection
+// already has one in flight, and the PONG's arrival minus the time the
+// batch was due is recorded. A connection the log closes always gets a last
+// probe and is closed once that is answered, so the server has run all the
+// connection sent before it goes (at speed=0 too). Lag is how far behind
+// schedule lines were actually queued (paced runs only). Reports lines/s
+// and bytes/s both ways.
+//
+// Usage: ./bench/ircreplay <capture> [key=value ...]
+//   host=127.0.0.1 port=6667   server to replay against
+//   pass=                      rewrite PASS lines to this password (empty = keep)
+//   speed=1                    time compression; 0 = as fast as possible
+//   window=4194304             bytes queued to the server before speed=0 waits
+//   linger=5                   seconds to wait for probes after the log ends
+//
+// Replaying faster than captured can trip the fresh server's flood limits:
+// raise IRCSERV_FLOOD_USER and IRCSERV_FLOOD_UNREG there.
+//
+#include "bench_net.hpp"
+#include "Capture.hpp"
+#include "Utils.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <strings.h>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+struct Options {
+    std::string log, host, port, pass;
+    double speed, linger;
+    size_t window;
+    Options(): host("127.0.0.1"), port("6667"), speed(1), linger(5), window(4UL << 20) {}
+};
+
+static bool setOption(Options& o, const std::string& kv) {
+    std::string k, v;
+    if (!splitOption(kv, k, v)) return false;
+    const char* s = v.c_str();
+    if (k == "host") o.host = v;
+    else if (k == "port") o.port = v;
+    else if (k == "pass") o.pass = v;
+    else if (k == "speed") o.speed = std::atof(s);
+    else if (k == "linger") o.linger = std::atof(s);
+    else if (k == "window") o.window = std::strtoul(s, 0, 10);
+    else return false;
+    return true;
+}
+
+struct Conn : NetConn {
+    bool          closing;  // the log closed it: close once out is sent and probed
+    bool          dirty;    // got lines this pass; probe after them
+    unsigned long due;      // ns the last line sent was due
+    std::vector<unsigned long> probes; // due times of probes in flight, oldest first
+    Conn(): closing(false), dirty(false), due(0) {}
+};
+
+struct Replay : public BenchNet {
+    Options                          o;
+    std::vector<Conn>                conns;
+    std::map<unsigned long, int>     byId;   // captured connection id -> index
+    std::vector<int>                 dirty;
+    unsigned long                    lines, bytesOut, linesIn, probes;
+    int                              opened, closed, cut, failed;
+    unsigned long                    unsent;
+    Histogram                        lag;     // ns, queued - due
+    Histogram                        latency; // ns, batch due -> probe PONG
+    Replay(): lines(0), bytesOut(0), linesIn(0), probes(0),
+              opened(0), closed(0), cut(0), failed(0), unsent(0), lag(), latency() {}
+
+    int  openConn(unsigned long id);
+    void line(Conn& c, const char* p, size_t n);
+    void probe(Conn& c);
+    virtual NetConn& connAt(int id) { return conns[id]; }
+    virtual void onLine(NetConn& nc, const char* p, size_t n, unsigned long now);
+    virtual void onClose(NetConn& nc, Reason why);
+    virtual void afterEvent(NetConn& nc);
+};
+
+void Replay::onClose(NetConn& nc, Reason why) {
+    Conn& c = static_cast<Conn&>(nc);
+    c.probes.clear();
+    if (why == CONNECT_FAILED) ++failed;
+    else if (why == CLOSED_BY_PEER && !c.closing) ++cut;
+}
+
+// A connection the log closed goes once all it was sent is answered.
+void Replay::afterEvent(NetConn& nc) {
+    Conn& c = static_cast<Conn&>(nc);
+    if (c.closing && c.probes.empty() && c.out.empty()) kill(c);
+}
+
+void Replay::line(Conn& c, const char* p, size_t n) {
+    std::string l(p, n);
+    l += "\r\n";
+    queue(c, l);
+}
+
+int Replay::openConn(unsigned long id) {
+    int i = (int)conns.size();
+    conns.push_back(Conn());
+    byId[id] = i;
+    conns[i].id = i;
+    ++opened;
+    if (!open(conns[i])) ++failed;
+    return i;
+}
+
+void Replay::probe(Conn& c) {
+    char buf[64];
+    int n = std::sprintf(buf, "PING ircreplay-%lu", c.due);
+    c.probes.push_back(c.due);
+    ++probes;
+    line(c, buf, n);
+}
+
+static void apply(Replay& r, const Capture::Record& rec, unsigned long due, unsigned long now) {
+    std::map<unsigned long, int>::iterator it = r.byId.find(rec.conn);
+    if (rec.kind == Capture::OPEN) {
+        if (it == r.byId.end()) r.openConn(rec.conn);
+        return;
+    }
+    if (it == r.byId.end()) {
+        if (rec.kind == Capture::CLOSE) return;
+        r.openConn(rec.conn); // opened before the capture started
+        it = r.byId.find(rec.conn);
+    }
+    Conn& c = r.conns[it->second];
+    if (rec.kind == Capture::CLOSE) {
+        ++r.closed;
+        if (c.dead() || c.closing) return;
+        c.closing = true;
+        c.due = due;
+        r.probe(c); // closed once answered
+        return;
+    }
+    if (c.dead() || c.closing) { ++r.unsent; return; }
+    if (!r.o.pass.empty() && rec.len >= 5 && strncasecmp(rec.line, "PASS ", 5) == 0) {
+        std::string pass = "PASS " + r.o.pass;
+        r.line(c, pass.data(), pass.size());
+    } else {
+        r.line(c, rec.line, rec.len);
+    }
+    ++r.lines;
+    r.bytesOut += rec.len + 2;
+    if (r.o.speed > 0) r.lag.record(now > due ? now - due : 0);
+    c.due = due;
+    if (!c.dirty) { c.dirty = true; r.dirty.push_back(it->second); }
+}
+
+// One probe in flight per connection, sent after the batch it times.
+static void sendProbes(Replay& r) {
+    for (size_t i = 0; i < r.dirty.size(); ++i) {
+        Conn& c = r.conns[r.dirty[i]];
+        c.dirty = false;
+        if (!c.dead() && !c.closing && c.probes.empty()) r.probe(c);
+    }
+    r.dirty.clear();
+}
+
+void Replay::onLine(NetConn& nc, const char* p, size_t n, unsigned long now) {
+    Conn& c = static_cast<Conn&>(nc);
+    ++linesIn;
+    if (n >= 4 && std::memcmp(p, "PING", 4) == 0) {
+        queue(c, "PONG" + std::string(p + 4, n - 4) + "\r\n");
+        return;
+    }
+    static const char tag[] = " :ircreplay-";
+    const size_t tl = sizeof(tag) - 1;
+    if (c.probes.empty() || n < tl) return;
+    for (const char* q = p; q + tl <= p + n; ++q) {
+        if (*q != ' ' || std::memcmp(q, tag, tl) != 0) continue;
+        unsigned long t = std::strtoul(q + tl, 0, 10);
+        if (t != c.probes.front()) return;
+        latency.record(now > t ? now - t : 0);
+        c.probes.erase(c.probes.begin());
+        return;
+    }
+}
+
+static bool inFlight(const Replay& r) {
+    if (r.queued()) return true;
+    for (size_t i = 0; i < r.conns.size(); ++i)
+        if (!r.conns[i].dead() && !r.conns[i].probes.empty()) return true;
+    return false;
+}
+
+int main(int ac, char** av) {
+    Replay r;
+    Options& o = r.o;
+    for (int i = 1; i < ac; ++i) {
+        if (std::strchr(av[i], '=')) {
+            if (!setOption(o, av[i])) { std::fprintf(stderr, "ircreplay: unknown setting %s\n", av[i]); return 1; }
+        } else if (o.log.empty()) o.log = av[i];
+        else { std::fprintf(stderr, "ircreplay: one capture at a time\n"); return 1; }
+    }
+    if (o.log.empty() || o.speed < 0) {
+        std::fprintf(stderr, "usage: %s <capture> [host=] [port=] [pass=] [speed=1] [window=] [linger=5]\n", av[0]);
+        return 1;
+    }
+
+    int lfd = open(o.log.c_str(), O_RDONLY);
+    struct stat st;
+    if (lfd < 0 || fstat(lfd, &st) != 0) { std::perror(o.log.c_str()); return 1; }
+    size_t size = st.st_size;
+    const char* base = size ? static_cast<const char*>(mmap(0, size, PROT_READ, MAP_PRIVATE, lfd, 0)) : 0;
+    if (size && base == MAP_FAILED) { std::perror(o.log.c_str()); return 1; }
+    if (!Capture::checkMagic(base, size)) {
+        std::fprintf(stderr, "ircreplay: %s is not a capture\n", o.log.c_str());
+        return 1;
+    }
+    const char* end = base + size;
+
+    // a first pass for the summary and the schedule origin
+    unsigned long records = 0, logLines = 0, first = 0, last = 0;
+    std::map<unsigned long, bool> ids;
+    Capture::Record rec;
+    const char* p = base + Capture::magicSize();
+    int k;
+    while ((k = Capture::next(p, end, rec)) > 0) {
+        if (!records++) first = rec.usec;
+        last = rec.usec;
+        if (rec.kind == Capture::LINE) ++logLines;
+        ids[rec.conn] = true;
+    }
+    if (k < 0) std::fprintf(stderr, "ircreplay: log ends in a partial record; replaying what precedes it\n");
+    std::printf("log      %s: %lu records, %lu connections, %lu lines, span %.2f s\n",
+                o.log.c_str(), records, (unsigned long)ids.size(), logLines, (last - first) / 1e6);
+
+    if (!r.setup("ircreplay", o.host, o.port)) return 1;
+
+    // record i is due at t0 + (usec_i - first) / speed
+    rec = Capture::Record();
+    p = base + Capture::magicSize();
+    bool have = false, more = records > 0;
+    unsigned long t0 = monotonicNsec();
+    while (more) {
+        unsigned long now = monotonicNsec();
+        int timeout = 1;
+        for (int budget = 4096; more && budget > 0; --budget) {
+            if (!have) {
+                if (Capture::next(p, end, rec) <= 0) { more = false; break; }
+                have = true;
+            }
+            unsigned long due = now;
+            if (o.speed > 0) {
+                due = t0 + (unsigned long)((rec.usec - first) * 1000.0 / o.speed);
+                if (due > now) {
+                    timeout = due - now < 1000000 ? 0 : 1;
+                    break;
+                }
+            } else if (r.queued() > o.window) {
+                break;
+            }
+            apply(r, rec, due, now);
+            have = false;
+            timeout = 0;
+        }
+        sendProbes(r);
+        r.pump(timeout);
+    }
+    unsigned long t1 = monotonicNsec();
+    unsigned long lingerEnd = t1 + (unsigned long)(o.linger * 1e9);
+    while (inFlight(r) && monotonicNsec() < lingerEnd) r.pump(1);
+    unsigned long t2 = monotonicNsec();
+
+    double dt = secs(t1 - t0 ? t1 - t0 : 1);
+    if (o.speed > 0) std::printf("replay   speed=%gx", o.speed);
+    else std::printf("replay   speed=max");
+    std::printf(": %lu lines (%lu bytes) in %.2f s: %.0f lines/s, %.2f MB/s\n",
+                r.lines, r.bytesOut, dt, r.lines / dt, r.bytesOut / dt / 1e6);
+    double dr = secs(t2 - t0 ? t2 - t0 : 1);
+    std::printf("received %lu lines (%lu bytes) in %.2f s: %.0f lines/s, %.2f MB/s\n",
+                r.linesIn, r.bytesIn(), dr, r.linesIn / dr, r.bytesIn() / dr / 1e6);
+    if (o.speed > 0) printLatency("lag", r.lag);
+    printLatency("latency", r.latency);
+    std::printf("connections %d opened, %d failed, %d closed by the log, %d cut by the server; "
+                "%lu lines unsent, %lu probes unanswered\n",
+                r.opened, r.failed, r.closed, r.cut, r.unsent, r.probes - r.latency.count);
+
+    munmap(const_cast<char*>(base), size);
+    close(lfd);
+    return 0;
+}
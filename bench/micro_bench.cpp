@@ -0,0 +1,335 @@
+//
+// micro_bench.cpp — Per-call cost of hot helpers, with a stored baseline
+//
+// Each case is run for about <ms> milliseconds, split over five timed runs;
+// the fastest run gives ns/op, and every run counts heap allocations and the
+// bytes they request (alloc_count.hpp). Cases:
+//   split_cmd        splitCmd() over parser_bench's client line mix
+//   parse_irc_line   parseIrcLine() over the same lines, for comparison
+//   to_lower         toLower() of nick and channel names
+//   nick_valid       isNickValid() of valid and invalid nicks
+//   b64_decode       FileTransfer::b64Decode() of one 300-byte FILEDATA chunk
+//   broadcast_100    Server::broadcast() of a PRIVMSG to a 100-member channel
+//   names_build_200  Channel::names() rebuilt for 200 members (after a NICK)
+//   names_cached_200 Channel::names() served from the cache
+//
+// The broadcast and NAMES cases run against a real Server whose clients are
+// socketpair-backed (Server::admit()); queued output is dropped with
+// OutQueue::consume() instead of being written, so only the core's work is
+// timed.
+//
+// Output is one line per case: "name ns/op allocs/op bytes/op". With
+// baseline=FILE the baseline's figures and the ns delta follow on each line,
+// and the exit status is 1 if any case now allocates more (calls or bytes);
+// ns/op is only flagged, as it moves with the machine. save=FILE writes the
+// current figures as a new baseline ("make bench-baseline").
+//
+// Usage: ./bench/micro_bench [ms=200] [baseline=FILE] [save=FILE] [only=SUBSTR]
+//
+#include "alloc_count.hpp"
+#include "bench_config.hpp"
+#include "Server.hpp"
+#include "Client.hpp"
+#include "Channel.hpp"
+#include "FileTransfer.hpp"
+#include "Utils.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+static unsigned long g_sink = 0; // keeps results live
+
+typedef void (*Kernel)(void* ctx, unsigned long ops);
+
+struct Result {
+    std::string name;
+    double ns, allocs, bytes;
+};
+
+// Grow the op count until one run takes a tenth of the budget, then take
+// the best of five runs sized to a fifth of it each.
+static Result measure(const char* name, Kernel k, void* ctx, double budgetNs) {
+    unsigned long ops = 16;
+    k(ctx, ops);
+    double t;
+    for (;;) {
+        unsigned long t0 = monotonicNsec();
+        k(ctx, ops);
+        t = (double)(monotonicNsec() - t0);
+        if (t >= budgetNs / 10 || ops >= (1UL << 30)) break;
+        ops *= 4;
+    }
+    ops = (unsigned long)(ops * (budgetNs / 5) / (t > 1 ? t : 1)) + 1;
+
+    Result r;
+    r.name = name;
+    r.ns = 0;
+    size_t a0 = g_allocs, b0 = g_bytes;
+    for (int run = 0; run < 5; ++run) {
+        unsigned long t0 = monotonicNsec();
+        k(ctx, ops);
+        double ns = (double)(monotonicNsec() - t0) / ops;
+        if (run == 0 || ns < r.ns) r.ns = ns;
+    }
+    r.allocs = (double)(g_allocs - a0) / (5.0 * ops);
+    r.bytes  = (double)(g_bytes - b0) / (5.0 * ops);
+    return r;
+}
+
+// --- string helpers ----------------------------------------------------------
+
+typedef std::vector<std::string> Lines;
+
+static void benchSplitCmd(void* p, unsigned long ops) {
+    const Lines& in = *static_cast<Lines*>(p);
+    for (unsigned long i = 0; i < ops; ++i) {
+        std::string command, trailing;     // per line, as the handler had them
+        std::vector<std::string> params;
+        splitCmd(in[i % in.size()], command, params, trailing);
+        g_sink += command.size() + params.size() + trailing.size();
+    }
+}
+
+static void benchParseIrcLine(void* p, unsigned long ops) {
+    const Lines& in = *static_cast<Lines*>(p);
+    for (unsigned long i = 0; i < ops; ++i) {
+        const std::string& s = in[i % in.size()];
+        IrcLine l;
+        parseIrcLine(s.data(), s.size(), l);
+        g_sink += l.command.n + l.nparams + l.trailing.n;
+    }
+}
+
+static void benchToLower(void* p, unsigned long ops) {
+    const Lines& in = *static_cast<Lines*>(p);
+    for (unsigned long i = 0; i < ops; ++i) g_sink += toLower(in[i % in.size()]).size();
+}
+
+static void benchNickValid(void* p, unsigned long ops) {
+    const Lines& in = *static_cast<Lines*>(p);
+    for (unsigned long i = 0; i < ops; ++i) g_sink += isNickValid(in[i % in.size()]);
+}
+
+static void benchB64Decode(void* p, unsigned long ops) {
+    const std::string& chunk = *static_cast<std::string*>(p);
+    for (unsigned long i = 0; i < ops; ++i) {
+        std::string raw;                   // FileTransfer::data() decodes into a fresh string
+        FileTransfer::b64Decode(chunk, raw);
+        g_sink += raw.size();
+    }
+}
+
+static std::string b64Encode(const std::string& in) {
+    static const char A[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    size_t i = 0;
+    for (; i + 2 < in.size(); i += 3) {
+        unsigned v = ((unsigned char)in[i] << 16) | ((unsigned char)in[i + 1] << 8) | (unsigned char)in[i + 2];
+        out += A[v >> 18]; out += A[(v >> 12) & 63]; out += A[(v >> 6) & 63]; out += A[v & 63];
+    }
+    if (i < in.size()) {
+        unsigned v = (unsigned char)in[i] << 16;
+        if (i + 1 < in.size()) v |= (unsigned char)in[i + 1] << 8;
+        out += A[v >> 18]; out += A[(v >> 12) & 63];
+        out += i + 1 < in.size() ? A[(v >> 6) & 63] : '=';
+        out += '=';
+    }
+    return out;
+}
+
+// --- server paths --------------------------------------------------------------
+
+struct Room {
+    Server*              srv;
+    Channel*             ch;
+    std::vector<Client*> members;
+    unsigned long        sent;
+};
+
+// Drop what broadcasts queued and recycle the reply arena, as a tick would.
+static void drain(Room& r) {
+    for (size_t i = 0; i < r.members.size(); ++i) {
+        OutQueue& q = r.members[i]->outbuf();
+        q.consume(q.bytes());
+    }
+    r.srv->arena().reset();
+}
+
+static void benchBroadcast(void* p, unsigned long ops) {
+    Room& r = *static_cast<Room*>(p);
+    for (unsigned long i = 0; i < ops; ++i) {
+        MsgBuilder m(r.srv->arena());
+        m << ":alice_dev!alice@127.0.0.1 PRIVMSG " << r.ch->name()
+          << " :hey, did anyone look at the build failure from last night?\r\n";
+        r.srv->broadcast(r.ch, m, -1);
+        if ((++r.sent & 63) == 0) drain(r);
+    }
+    drain(r);
+}
+
+static void benchNamesBuild(void* p, unsigned long ops) {
+    Room& r = *static_cast<Room*>(p);
+    for (unsigned long i = 0; i < ops; ++i) {
+        r.ch->invalidateNames();
+        g_sink += r.ch->names(&Server::memberNick, r.srv).size();
+    }
+}
+
+static void benchNamesCached(void* p, unsigned long ops) {
+    Room& r = *static_cast<Room*>(p);
+    for (unsigned long i = 0; i < ops; ++i) g_sink += r.ch->names(&Server::memberNick, r.srv).size();
+}
+
+// Admit n socketpair-backed clients named <prefix><i> into channel name.
+static bool fillRoom(Server& s, Room& r, const char* name, const char* prefix, int n,
+                     std::vector<int>& peers) {
+    r.srv = &s;
+    r.ch = s.getOrCreateChannel(name);
+    r.sent = 0;
+    for (int i = 0; i < n; ++i) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) { perror("socketpair"); return false; }
+        fcntl(sv[0], F_SETFL, O_NONBLOCK);
+        peers.push_back(sv[1]);
+        Client* c = s.admit(sv[0]);
+        char nick[32];
+        std::sprintf(nick, "%s%03d", prefix, i);
+        s.setClientNick(*c, nick);
+        r.ch->addMember(c->memberId());
+        c->joinChannel(r.ch->atom());
+        r.members.push_back(c);
+    }
+    drain(r);
+    return true;
+}
+
+// --- baseline ------------------------------------------------------------------
+
+static bool loadBaseline(const char* path, std::map<std::string, Result>& out) {
+    FILE* f = std::fopen(path, "r");
+    if (!f) { perror(path); return false; }
+    char line[256], name[128];
+    while (std::fgets(line, sizeof(line), f)) {
+        Result r;
+        if (line[0] == '#') continue;
+        if (std::sscanf(line, "%127s %lf %lf %lf", name, &r.ns, &r.allocs, &r.bytes) != 4) continue;
+        r.name = name;
+        out[name] = r;
+    }
+    std::fclose(f);
+    return true;
+}
+
+static void writeResults(FILE* f, const std::vector<Result>& rs) {
+    std::fprintf(f, "# name ns/op allocs/op bytes/op\n");
+    for (size_t i = 0; i < rs.size(); ++i)
+        std::fprintf(f, "%-18s %10.1f %9.2f %10.1f\n", rs[i].name.c_str(), rs[i].ns, rs[i].allocs, rs[i].bytes);
+}
+
+int main(int ac, char** av) {
+    double ms = 200;
+    const char* baseline = 0;
+    const char* save = 0;
+    const char* only = "";
+    for (int i = 1; i < ac; ++i) {
+        if (!std::strncmp(av[i], "ms=", 3)) ms = std::atof(av[i] + 3);
+        else if (!std::strncmp(av[i], "baseline=", 9)) baseline = av[i] + 9;
+        else if (!std::strncmp(av[i], "save=", 5)) save = av[i] + 5;
+        else if (!std::strncmp(av[i], "only=", 5)) only = av[i] + 5;
+        else {
+            std::fprintf(stderr, "usage: %s [ms=200] [baseline=FILE] [save=FILE] [only=SUBSTR]\n", av[0]);
+            return 1;
+        }
+    }
+    if (ms < 1) ms = 1;
+
+    static const char* mix[] = {
+        "PRIVMSG #general :hey, did anyone look at the build failure from last night?",
+        "PRIVMSG #general :yes, it was the flaky test again",
+        "PRIVMSG alice :can you review my change when you get a minute",
+        "PRIVMSG #dev :pushed a fix, running the suite now",
+        "PRIVMSG #general :lol",
+        "PRIVMSG #dev,#ops :deploy window starts in 10 minutes",
+        "NOTICE bob :auto-away",
+        "PING :ircserv",
+        "JOIN #random",
+        "MODE #dev +o carol",
+    };
+    static const char* names[] = {
+        "AliceDev", "#General", "bob", "#Some-Channel_Name", "Carol[away]", "#dev", "DAVE", "#OPS",
+    };
+    static const char* nicks[] = {
+        "alice", "Bob_", "carol[m]", "9lives", "dave-dev", "x", "way_too_long_for_a_nick", "bad nick",
+    };
+    Lines lines(mix, mix + sizeof(mix) / sizeof(mix[0]));
+    Lines lowers(names, names + sizeof(names) / sizeof(names[0]));
+    Lines nickList(nicks, nicks + sizeof(nicks) / sizeof(nicks[0]));
+    std::string raw;
+    for (int i = 0; i < 300; ++i) raw += (char)(i * 131 + 7);
+    std::string chunk = b64Encode(raw);
+
+    Server srv("0", "pw", unthrottledConfig());
+    std::vector<int> peers;
+    Room bcast, nameRoom;
+    if (!fillRoom(srv, bcast, "#bench", "member_", 100, peers)
+        || !fillRoom(srv, nameRoom, "#names", "lurker_nick_", 200, peers))
+        return 1;
+
+    struct Case { const char* name; Kernel k; void* ctx; } cases[] = {
+        { "split_cmd",        benchSplitCmd,     &lines },
+        { "parse_irc_line",   benchParseIrcLine, &lines },
+        { "to_lower",         benchToLower,      &lowers },
+        { "nick_valid",       benchNickValid,    &nickList },
+        { "b64_decode",       benchB64Decode,    &chunk },
+        { "broadcast_100",    benchBroadcast,    &bcast },
+        { "names_build_200",  benchNamesBuild,   &nameRoom },
+        { "names_cached_200", benchNamesCached,  &nameRoom },
+    };
+    std::vector<Result> results;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        if (!std::strstr(cases[i].name, only)) continue;
+        results.push_back(measure(cases[i].name, cases[i].k, cases[i].ctx, ms * 1e6));
+    }
+    for (size_t i = 0; i < peers.size(); ++i) close(peers[i]);
+
+    std::map<std::string, Result> base;
+    if (baseline && !loadBaseline(baseline, base)) return 1;
+
+    int worse = 0;
+    std::printf("# name ns/op allocs/op bytes/op%s\n",
+                baseline ? " | baseline ns/op allocs/op bytes/op ns-delta" : "");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::printf("%-18s %10.1f %9.2f %10.1f", r.name.c_str(), r.ns, r.allocs, r.bytes);
+        std::map<std::string, Result>::const_iterator b = base.find(r.name);
+        if (b != base.end()) {
+            const Result& o = b->second;
+            // amortized counts wobble with the op count; allow that much
+            bool allocs = r.allocs > o.allocs * 1.02 + 0.01 || r.bytes > o.bytes * 1.02 + 1;
+            bool slower = r.ns > o.ns * 1.25;
+            std::printf(" | %10.1f %9.2f %10.1f %+6.1f%%%s%s", o.ns, o.allocs, o.bytes,
+                        (r.ns - o.ns) * 100 / (o.ns > 0 ? o.ns : 1),
+                        allocs ? "  MORE-ALLOCS" : "", slower ? "  SLOWER" : "");
+            if (allocs) ++worse;
+        } else if (baseline) {
+            std::printf(" | (not in baseline)");
+        }
+        std::printf("\n");
+    }
+    if (save) {
+        FILE* f = std::fopen(save, "w");
+        if (!f) { perror(save); return 1; }
+        writeResults(f, results);
+        std::fclose(f);
+    }
+    if (g_sink == 0) std::printf("# (sink empty)\n");
+    if (worse) std::printf("# %d case(s) allocate more than the baseline\n", worse);
+    return worse ? 1 : 0;
+}
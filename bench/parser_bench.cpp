@@ -0,0 +1,114 @@
+//
+// parser_bench.cpp — Read-path framing and parsing throughput
+//
+// Feeds a typical client mix (mostly PRIVMSG, some PING/JOIN/MODE/NOTICE)
+// through the two read paths, in recv()-sized pieces:
+//   old:     std::string inbuf, find("\r\n") + substr + erase, splitCmd()
+//   views:   LineBuffer::next() + parseIrcLine() into views, nothing copied
+//   scratch: views copied into reused strings (what CommandHandler does)
+//
+// Allocations are counted through alloc_count.hpp.
+//
+// Usage: ./bench/parser_bench [lines=200000] [recv=4096] [rounds=5]
+//
+#include "alloc_count.hpp"
+#include "Utils.hpp"
+#include "LineBuffer.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+static std::string makeStream(int lines) {
+    static const char* mix[] = {
+        "PRIVMSG #general :hey, did anyone look at the build failure from last night?\r\n",
+        "PRIVMSG #general :yes, it was the flaky test again\r\n",
+        "PRIVMSG alice :can you review my change when you get a minute\r\n",
+        "PRIVMSG #dev :pushed a fix, running the suite now\r\n",
+        "PRIVMSG #general :lol\r\n",
+        "PRIVMSG #dev,#ops :deploy window starts in 10 minutes\r\n",
+        "NOTICE bob :auto-away\r\n",
+        "PING :ircserv\r\n",
+        "JOIN #random\r\n",
+        "MODE #dev +o carol\r\n",
+    };
+    const int n = sizeof(mix) / sizeof(mix[0]);
+    std::string s;
+    for (int i = 0; i < lines; ++i) s += mix[i % n];
+    return s;
+}
+
+struct Result { double linesPerSec; double allocsPerLine; };
+
+static Result runOld(const std::string& in, size_t chunk, int rounds) {
+    size_t lines = 0, a0 = g_allocs, sink = 0;
+    unsigned long t0 = monotonicNsec();
+    for (int r = 0; r < rounds; ++r) {
+        std::string inbuf;
+        for (size_t off = 0; off < in.size(); off += chunk) {
+            inbuf.append(in, off, chunk);
+            size_t pos;
+            while ((pos = inbuf.find("\r\n")) != std::string::npos) {
+                std::string line = inbuf.substr(0, pos);
+                inbuf.erase(0, pos + 2);
+                std::string cmd, trailing; std::vector<std::string> params;
+                splitCmd(line, cmd, params, trailing);
+                sink += cmd.size() + params.size() + trailing.size();
+                ++lines;
+            }
+        }
+    }
+    unsigned long ns = monotonicNsec() - t0;
+    if (!sink) std::printf("?");
+    Result res = { lines / (ns / 1e9), (double)(g_allocs - a0) / lines };
+    return res;
+}
+
+static Result runNew(const std::string& in, size_t chunk, int rounds, bool scratch) {
+    size_t lines = 0, a0 = g_allocs, sink = 0;
+    std::string cmd, trailing;
+    std::string params[IrcLine::MAX_PARAMS];
+    unsigned long t0 = monotonicNsec();
+    for (int r = 0; r < rounds; ++r) {
+        LineBuffer inbuf;
+        for (size_t off = 0; off < in.size(); off += chunk) {
+            size_t n = in.size() - off < chunk ? in.size() - off : chunk;
+            inbuf.append(in.data() + off, n);
+            const char* p; size_t len; IrcLine msg;
+            while (inbuf.next(p, len)) {
+                if (!parseIrcLine(p, len, msg)) continue;
+                if (scratch) {
+                    cmd.assign(msg.command.p, msg.command.n);
+                    for (int i = 0; i < msg.nparams; ++i) params[i].assign(msg.params[i].p, msg.params[i].n);
+                    trailing.assign(msg.trailing.p, msg.trailing.n);
+                }
+                sink += msg.command.n + msg.nparams + msg.trailing.n;
+                ++lines;
+            }
+            inbuf.compact();
+        }
+    }
+    unsigned long ns = monotonicNsec() - t0;
+    if (!sink) std::printf("?");
+    Result res = { lines / (ns / 1e9), (double)(g_allocs - a0) / lines };
+    return res;
+}
+
+int main(int ac, char** av) {
+    int lines  = ac > 1 ? std::atoi(av[1]) : 200000;
+    int chunk  = ac > 2 ? std::atoi(av[2]) : 4096;
+    int rounds = ac > 3 ? std::atoi(av[3]) : 5;
+    std::string in = makeStream(lines);
+
+    Result o = runOld(in, chunk, rounds);
+    Result v = runNew(in, chunk, rounds, false);
+    Result s = runNew(in, chunk, rounds, true);
+    std::printf("lines=%d recv=%d rounds=%d bytes=%lu\n", lines, chunk, rounds, (unsigned long)in.size());
+    std::printf("%-8s %12.0f lines/s %8.2f allocs/line\n", "old", o.linesPerSec, o.allocsPerLine);
+    std::printf("%-8s %12.0f lines/s %8.2f allocs/line\n", "views", v.linesPerSec, v.allocsPerLine);
+    std::printf("%-8s %12.0f lines/s %8.2f allocs/line\n", "scratch", s.linesPerSec, s.allocsPerLine);
+    std::printf("speedup  %11.1fx (views) %7.1fx (scratch)\n",
+                v.linesPerSec / o.linesPerSec, s.linesPerSec / o.linesPerSec);
+    return 0;
+}
@@ -0,0 +1,90 @@
+//
+// poller_bench.cpp — Event-loop tick cost per Poller backend
+//
+// Registers <idle> descriptors that never become ready plus <active>
+// socketpairs that receive one byte per tick, then measures the cost of one
+// loop iteration: poller wait(0) + draining the ready descriptors. This is
+// the part of Server::run that scales with connection count.
+//
+// Usage: ./bench/poller_bench [idle=10000] [active=100] [ticks=2000]
+//
+// Idle descriptors are unbound UDP sockets (one fd each, never readable), so
+// 10k idle + 100 active fits under a 20k RLIMIT_NOFILE.
+//
+#include "Poller.hpp"
+#include "Utils.hpp"
+
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+static void raiseFdLimit(size_t need) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0) return;
+    if (rl.rlim_cur >= need) return;
+    rl.rlim_cur = (rl.rlim_max < need) ? rl.rlim_max : need;
+    setrlimit(RLIMIT_NOFILE, &rl);
+}
+
+static void runOne(const std::string& kind, int idle, int active, int ticks) {
+    Poller* p = Poller::create(kind);
+    if (kind != p->name()) {
+        std::cout << kind << ": unavailable (got " << p->name() << ")\n";
+        delete p;
+        return;
+    }
+    std::vector<int> idleFds, rd, wr;
+    for (int i = 0; i < idle; ++i) {
+        int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0) { std::perror("socket"); break; }
+        idleFds.push_back(fd);
+        p->add(fd, POLLIN);
+    }
+    for (int i = 0; i < active; ++i) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) { std::perror("socketpair"); break; }
+        fcntl(sv[0], F_SETFL, O_NONBLOCK);
+        rd.push_back(sv[0]); wr.push_back(sv[1]);
+        p->add(sv[0], POLLIN);
+    }
+
+    std::vector<PollEvent> ready;
+    char b = 'x', sink[64];
+    unsigned long spent = 0;
+    long seen = 0;
+    for (int t = 0; t < ticks; ++t) {
+        for (size_t i = 0; i < wr.size(); ++i) if (::write(wr[i], &b, 1) < 0) std::perror("write");
+        unsigned long t0 = monotonicNsec();
+        p->wait(ready, 0);
+        for (size_t i = 0; i < ready.size(); ++i) {
+            // drain until EAGAIN so edge-triggered mode is exercised fairly
+            while (::read(ready[i].fd, sink, sizeof(sink)) > 0) {}
+        }
+        spent += monotonicNsec() - t0;
+        seen += (long)ready.size();
+    }
+    std::printf("%-9s idle=%-6d active=%-4d ticks=%-5d  %9.2f us/tick  %6.1f ready/tick\n",
+                p->name(), (int)idleFds.size(), (int)rd.size(), ticks,
+                spent / 1e3 / ticks, (double)seen / ticks);
+
+    for (size_t i = 0; i < idleFds.size(); ++i) { p->remove(idleFds[i]); close(idleFds[i]); }
+    for (size_t i = 0; i < rd.size(); ++i) { p->remove(rd[i]); close(rd[i]); close(wr[i]); }
+    delete p;
+}
+
+int main(int ac, char** av) {
+    int idle   = ac > 1 ? std::atoi(av[1]) : 10000;
+    int active = ac > 2 ? std::atoi(av[2]) : 100;
+    int ticks  = ac > 3 ? std::atoi(av[3]) : 2000;
+    raiseFdLimit((size_t)idle + 2 * (size_t)active + 64);
+
+    runOne("poll", idle, active, ticks);
+    runOne("epoll", idle, active, ticks);
+    runOne("epoll-et", idle, active, ticks);
+    return 0;
+}
@@ -0,0 +1,140 @@
+//
+// privmsg_bench.cpp — Heap allocations per PRIVMSG, string concat vs arena
+//
+// Replays the reply side of cmdPRIVMSG for a channel message (fan-out to
+// <members> queues) and for a private message, both ways:
+//   concat: the old handler: targets split into a vector<string>, the text
+//           copied, the line and the "Message sent" hint built from
+//           std::string operator+ chains, the bot's target/text copies
+//   arena:  targets walked in place, both lines composed by MsgBuilder in
+//           a per-tick Arena that is reset after every <batch> messages
+// Queues are drained after every batch, as the write path would.
+// Allocations are counted through alloc_count.hpp; the channel case still
+// pays the one shared Segment every recipient references.
+//
+// Usage: ./bench/privmsg_bench [messages=500000] [members=20] [batch=64]
+//
+#include "alloc_count.hpp"
+#include "Arena.hpp"
+#include "OutQueue.hpp"
+#include "Utils.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+struct World {
+    std::string            nick, peer, channel, text;
+    std::vector<OutQueue>  members; // channel members other than the sender
+    OutQueue               self, dm;
+};
+
+static void drain(World& w) {
+    for (size_t i = 0; i < w.members.size(); ++i) w.members[i].consume(w.members[i].bytes());
+    w.self.consume(w.self.bytes());
+    w.dm.consume(w.dm.bytes());
+}
+
+static void fanout(World& w, const SegmentRef& seg) {
+    for (size_t i = 0; i < w.members.size(); ++i) w.members[i].push(seg);
+}
+
+static size_t g_sink = 0; // keeps the bot's copies alive to the optimizer
+
+// What cmdPRIVMSG did before: every piece is a std::string temporary.
+static void oldPrivmsg(World& w, const std::string& p0, const std::string& trailing) {
+    const std::string text = trailing;
+    std::vector<std::string> tgts; { std::string cur; for (size_t i=0;i<p0.size();++i){ if(p0[i]==','){ if(!cur.empty()) tgts.push_back(cur); cur.clear(); } else cur+=p0[i]; } if(!cur.empty()) tgts.push_back(cur); }
+    for (size_t i = 0; i < tgts.size(); ++i) {
+        const std::string& target = tgts[i];
+        if (target[0] == '#') {
+            std::string msg = ":" + w.nick + " PRIVMSG " + target + " :" + text + "\r\n";
+            fanout(w, SegmentRef(msg));
+        } else {
+            w.dm.append(":" + w.nick + " PRIVMSG " + w.peer + " :" + text + "\r\n");
+        }
+        w.self.append(":ircserv NOTICE " + w.nick + " :Message sent to " + target + ".\r\n");
+    }
+    std::string target = p0;
+    std::string copy = trailing;
+    g_sink += target.size() + copy.size();
+}
+
+// What it does now.
+static void newPrivmsg(World& w, Arena& a, const std::string& p0, const std::string& trailing) {
+    const std::string& text = trailing;
+    MsgBuilder m(a);
+    for (size_t b = 0; b <= p0.size(); ) {
+        size_t e = p0.find(',', b);
+        if (e == std::string::npos) e = p0.size();
+        StrView target(p0.data() + b, e - b);
+        b = e + 1;
+        if (target.empty()) continue;
+        m.clear();
+        if (target.p[0] == '#') {
+            m << ':' << w.nick << " PRIVMSG " << target << " :" << text << "\r\n";
+            fanout(w, SegmentRef(Segment::create(m.data(), m.size())));
+        } else {
+            m << ':' << w.nick << " PRIVMSG " << w.peer << " :" << text << "\r\n";
+            w.dm.append(m.data(), m.size());
+        }
+        m.clear();
+        m << ":ircserv NOTICE " << w.nick << " :Message sent to " << target << ".\r\n";
+        w.self.append(m.data(), m.size());
+    }
+    g_sink += p0.size() + text.size();
+}
+
+struct Result { double allocs, ns; };
+
+static Result run(World& w, bool arena, const std::string& target, int n, int batch) {
+    Arena a;
+    std::string text = w.text; // the handler's scratch string
+    // warm up: queues, deques and arena blocks reach their steady state
+    for (int i = 0; i < batch * 4; ++i) {
+        if (arena) newPrivmsg(w, a, target, text); else oldPrivmsg(w, target, text);
+        if ((i + 1) % batch == 0) { drain(w); a.reset(); }
+    }
+    size_t a0 = g_allocs;
+    unsigned long t0 = monotonicNsec();
+    for (int i = 0; i < n; ++i) {
+        if (arena) newPrivmsg(w, a, target, text); else oldPrivmsg(w, target, text);
+        if ((i + 1) % batch == 0) { drain(w); a.reset(); }
+    }
+    unsigned long t1 = monotonicNsec();
+    Result r = { (double)(g_allocs - a0) / n, (double)(t1 - t0) / n };
+    drain(w);
+    return r;
+}
+
+int main(int ac, char** av) {
+    int n       = ac > 1 ? std::atoi(av[1]) : 500000;
+    int members = ac > 2 ? std::atoi(av[2]) : 20;
+    int batch   = ac > 3 ? std::atoi(av[3]) : 64;
+    if (n < 1 || members < 0 || batch < 1) {
+        std::fprintf(stderr, "usage: %s [messages] [members] [batch]\n", av[0]);
+        return 1;
+    }
+
+    World w;
+    w.nick = "alice_dev";
+    w.peer = "bob_the_builder";
+    w.channel = "#general";
+    w.text = "hey, did anyone look at the build failure from last night?";
+    w.members.resize(members);
+
+    std::printf("messages=%d members=%d batch=%d\n", n, members, batch);
+    const char* names[] = { "channel", "private" };
+    const std::string targets[] = { w.channel, w.peer };
+    bool ok = true;
+    for (int k = 0; k < 2; ++k) {
+        Result o = run(w, false, targets[k], n, batch);
+        Result x = run(w, true, targets[k], n, batch);
+        std::printf("%-8s concat %6.2f allocs/msg %7.1f ns/msg | arena %6.2f allocs/msg %7.1f ns/msg\n",
+                    names[k], o.allocs, o.ns, x.allocs, x.ns);
+        if (x.allocs > o.allocs) ok = false;
+    }
+    std::printf("%s\n", ok ? "ok" : "arena path allocated more than concat");
+    return g_sink ? (ok ? 0 : 1) : 1;
+}
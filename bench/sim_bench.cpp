@@ -0,0 +1,198 @@
+//
+// sim_bench.cpp — The whole server, driven in-process over MemoryTransport
+//
+// A Server is built on a MemoryTransport and a SimClock, so its clients are
+// buffers in this process: no sockets, no syscalls, no kernel limit on their
+// number. The bench then runs the server's own code (CommandHandler,
+// Channel, broadcast, OutQueue) through four phases:
+//   register  every client connects, sends PASS/NICK/USER and asks for CAP
+//             ircserv/no-hints, so PRIVMSG has no sender notice
+//   join      client i joins #c<i / members>
+//   privmsg   every client sends <msgs> PRIVMSGs to its channel
+//   quit      every client sends QUIT
+// Each phase feeds all input first, then calls Server::step(0) (advancing the
+// clock by one millisecond per tick) until the server is idle. Replies are
+// kept through registration, to check each client got its 001, and only
+// counted after that (MemoryTransport::keepOutput(false)).
+//
+// Per phase: input lines, ticks, wall time, lines/s, messages and bytes
+// out, and ns per input line. The run fails (exit 1) if a phase's outcome
+// is wrong: a client left unregistered, a delivery count off, a connection
+// still open after QUIT.
+//
+// Usage: ./bench/sim_bench [clients=20000] [members=50] [msgs=4]
+//
+#include "bench_config.hpp"
+#include "Server.hpp"
+#include "Transport.hpp"
+#include "Clock.hpp"
+#include "Utils.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+struct Sim {
+    MemoryTransport net;
+    SimClock        clock;
+    Server*         srv;
+    std::vector<int> fds;
+};
+
+struct Phase {
+    const char*   name;
+    unsigned long lines;
+    unsigned long ticks;
+    unsigned long ns;
+    unsigned long msgsOut;
+    unsigned long bytesOut;
+};
+
+// Tick until every byte sent has been read and the server has nothing
+// queued. A bounded number of ticks, so a wedged server fails the run.
+static bool drive(Sim& s, unsigned long& ticks) {
+    unsigned long limit = ticks + 100000 + s.fds.size();
+    do {
+        if (!s.srv->step(0)) return false;
+        s.clock.advance(1000);
+        if (++ticks > limit) {
+            std::fprintf(stderr, "server did not go idle\n");
+            return false;
+        }
+    } while (!s.net.drained() || !s.srv->idle());
+    return true;
+}
+
+static bool runPhase(Sim& s, Phase& p, const char* name, unsigned long lines) {
+    const Metrics& m = s.srv->metrics();
+    unsigned long msgs0 = m.counter(Metrics::MSGS_OUT);
+    unsigned long bytes0 = m.counter(Metrics::BYTES_OUT);
+    p.name = name;
+    p.lines = lines;
+    p.ticks = 0;
+    unsigned long t0 = monotonicNsec();
+    bool ok = drive(s, p.ticks);
+    p.ns = monotonicNsec() - t0;
+    p.msgsOut = m.counter(Metrics::MSGS_OUT) - msgs0;
+    p.bytesOut = m.counter(Metrics::BYTES_OUT) - bytes0;
+    return ok;
+}
+
+static std::string nickOf(size_t i) {
+    std::ostringstream o;
+    o << "u" << i;
+    return o.str();
+}
+
+static std::string chanOf(size_t i, size_t members) {
+    std::ostringstream o;
+    o << "#c" << i / members;
+    return o.str();
+}
+
+int main(int argc, char** argv) {
+    size_t clients = 20000, members = 50, msgs = 4;
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        if (!std::strncmp(a, "clients=", 8)) clients = std::strtoul(a + 8, 0, 10);
+        else if (!std::strncmp(a, "members=", 8)) members = std::strtoul(a + 8, 0, 10);
+        else if (!std::strncmp(a, "msgs=", 5)) msgs = std::strtoul(a + 5, 0, 10);
+        else {
+            std::fprintf(stderr, "usage: %s [clients=N] [members=N] [msgs=N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!clients || !members) return 2;
+
+    Sim s;
+    ServerConfig cfg = unthrottledConfig();
+    cfg.backlog = 1 << 16;
+    cfg.acceptBudget = cfg.welcomeBudget = 4096;
+    cfg.transport = &s.net;
+    cfg.clock = &s.clock;
+    Server srv("0", "pw", cfg);
+    s.srv = &srv;
+
+    std::vector<Phase> phases;
+    Phase p;
+    bool ok = true;
+
+    for (size_t i = 0; i < clients; ++i) {
+        int fd = s.net.connect();
+        std::string nick = nickOf(i);
+        s.net.send(fd, "CAP REQ :ircserv/no-hints\r\nPASS pw\r\nNICK " + nick
+                       + "\r\nUSER " + nick + " 0 * :sim\r\nCAP END\r\n");
+        s.fds.push_back(fd);
+    }
+    ok = runPhase(s, p, "register", clients * 5);
+    phases.push_back(p);
+    // every connection gets a NOTICE on arrival: look for the 001 itself
+    std::string out;
+    for (size_t i = 0; ok && i < clients; ++i) {
+        s.net.takeOutput(s.fds[i], out);
+        if (out.find(" 001 ") == std::string::npos || s.net.closedByServer(s.fds[i])) {
+            std::fprintf(stderr, "register: client %lu not welcomed\n", (unsigned long)i);
+            ok = false;
+        }
+    }
+    std::string().swap(out);
+    s.net.keepOutput(false);
+
+    if (ok) {
+        for (size_t i = 0; i < clients; ++i)
+            s.net.send(s.fds[i], "JOIN " + chanOf(i, members) + "\r\n");
+        ok = runPhase(s, p, "join", clients);
+        phases.push_back(p);
+    }
+
+    if (ok) {
+        unsigned long expect = 0;
+        for (size_t i = 0; i < clients; ++i) {
+            size_t first = i / members * members;
+            size_t size = (first + members < clients ? first + members : clients) - first;
+            std::string line = "PRIVMSG " + chanOf(i, members) + " :hello from the simulation\r\n";
+            for (size_t k = 0; k < msgs; ++k) s.net.send(s.fds[i], line);
+            expect += msgs * (size - 1);
+        }
+        ok = runPhase(s, p, "privmsg", clients * msgs);
+        phases.push_back(p);
+        if (ok && p.msgsOut != expect) {
+            std::fprintf(stderr, "privmsg: %lu deliveries, expected %lu\n", p.msgsOut, expect);
+            ok = false;
+        }
+    }
+
+    if (ok) {
+        for (size_t i = 0; i < clients; ++i) s.net.send(s.fds[i], "QUIT :done\r\n");
+        ok = runPhase(s, p, "quit", clients);
+        phases.push_back(p);
+        for (size_t i = 0; ok && i < clients; ++i) {
+            if (!s.net.closedByServer(s.fds[i])) {
+                std::fprintf(stderr, "quit: client %lu still open\n", (unsigned long)i);
+                ok = false;
+            }
+        }
+        for (size_t i = 0; i < clients; ++i) s.net.hangup(s.fds[i]);
+    }
+
+    std::printf("# %lu clients, %lu per channel, %lu msgs each\n",
+                (unsigned long)clients, (unsigned long)members, (unsigned long)msgs);
+    std::printf("# %-9s %10s %7s %9s %12s %12s %12s %9s\n",
+                "phase", "lines", "ticks", "ms", "lines/s", "msgs_out", "bytes_out", "ns/line");
+    for (size_t i = 0; i < phases.size(); ++i) {
+        const Phase& ph = phases[i];
+        double ms = ph.ns / 1e6;
+        std::printf("  %-9s %10lu %7lu %9.1f %12.0f %12lu %12lu %9.0f\n",
+                    ph.name, ph.lines, ph.ticks, ms, ms > 0 ? ph.lines / (ms / 1e3) : 0.0,
+                    ph.msgsOut, ph.bytesOut, ph.lines ? (double)ph.ns / ph.lines : 0.0);
+    }
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    std::printf("# peak RSS %ld MiB, %lu connections left\n",
+                ru.ru_maxrss / 1024, (unsigned long)s.net.connections());
+    return ok ? 0 : 1;
+}
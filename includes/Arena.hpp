@@ -0,0 +1,122 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+/**
+ * @file Arena.hpp
+ * @brief Per-tick bump allocator and the reply builder that writes into it.
+ *
+ * Every reply a handler composes lives only until it is copied into an
+ * OutQueue chunk or a shared Segment, i.e. within the same event-loop tick.
+ * Arena hands out that scratch memory by bumping a pointer through large
+ * blocks and forgets all of it at once in reset(), which Server::run()
+ * calls at the end of every tick. Blocks are kept across resets, so after
+ * the first busy tick composing a reply does no heap work at all.
+ *
+ * Requests larger than a block get a block of their own; those are freed
+ * on reset(), as are ordinary blocks beyond keepBlocks.
+ *
+ * Not thread-safe: the arena belongs to the core thread.
+ */
+
+#include "Utils.hpp"
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+class Arena {
+public:
+    /** @param blockSize Bytes per block. @param keepBlocks Blocks retained by reset(). */
+    explicit Arena(size_t blockSize = 64 * 1024, size_t keepBlocks = 4);
+    ~Arena();
+
+    /** @brief n bytes, 8-byte aligned, valid until the next reset(). */
+    char* alloc(size_t n);
+
+    /**
+     * @brief Grow the most recent allocation p from oldN to newN bytes in
+     *        place, if it is still the last one and the block has room.
+     * @return false if the caller has to alloc() and copy instead.
+     */
+    bool extend(char* p, size_t oldN, size_t newN);
+
+    /** @brief Release everything handed out since the last reset(). */
+    void reset();
+
+    /** @return Bytes handed out since the last reset(). */
+    size_t used() const { return _used; }
+    /** @return Bytes held in retained blocks. */
+    size_t reserved() const { return _blocks.size() * _blockSize; }
+    /** @return Largest used() seen at a reset(). */
+    size_t peak() const { return _peak; }
+
+private:
+    std::vector<char*> _blocks;  // ordinary blocks; _blocks[_cur] is being filled
+    std::vector<char*> _large;   // oversized one-off blocks, freed on reset()
+    size_t             _blockSize;
+    size_t             _keep;
+    size_t             _cur;
+    size_t             _off;     // fill offset in _blocks[_cur]
+    char*              _last;    // most recent alloc(), for extend()
+    size_t             _used;
+    size_t             _peak;
+
+    char* newBlock();
+
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+};
+
+/**
+ * @brief Appends the pieces of one IRC line into arena memory.
+ *
+ * @code
+ *   MsgBuilder m(srv.arena());
+ *   m << ':' << nick << " PRIVMSG " << target << " :" << text << "\r\n";
+ *   srv.sendToClient(fd, m);
+ * @endcode
+ *
+ * The buffer starts at 512 bytes (one RFC line) and doubles when needed,
+ * in place while it is the arena's last allocation. data() is not
+ * NUL-terminated and is valid until the arena's next reset().
+ */
+class MsgBuilder {
+public:
+    explicit MsgBuilder(Arena& a, size_t hint = 512);
+
+    MsgBuilder& operator<<(const std::string& s) { return append(s.data(), s.size()); }
+    MsgBuilder& operator<<(const StrView& v) { return append(v.p, v.n); }
+    MsgBuilder& operator<<(const char* s);
+    MsgBuilder& operator<<(char ch) { return append(&ch, 1); }
+    MsgBuilder& operator<<(int v) { return number(v); }
+    MsgBuilder& operator<<(long v) { return number(v); }
+    MsgBuilder& operator<<(unsigned v) { return unsignedNumber(v); }
+    MsgBuilder& operator<<(unsigned long v) { return unsignedNumber(v); }
+
+    MsgBuilder& append(const char* p, size_t n);
+
+    /** @brief Start over, keeping the buffer. */
+    void clear() { _n = 0; }
+    /** @brief Drop everything after the first n bytes. */
+    void truncate(size_t n) { if (n < _n) _n = n; }
+
+    const char* data() const { return _p; }
+    size_t      size() const { return _n; }
+    /** @return A heap copy, for the rare caller that must keep the line. */
+    std::string str() const { return std::string(_p, _n); }
+
+private:
+    Arena& _a;
+    char*  _p;
+    size_t _n;
+    size_t _cap;
+
+    void reserve(size_t need);
+    MsgBuilder& number(long v);
+    MsgBuilder& unsignedNumber(unsigned long v);
+
+    MsgBuilder(const MsgBuilder&);
+    MsgBuilder& operator=(const MsgBuilder&);
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef ATOM_TABLE_HPP
+#define ATOM_TABLE_HPP
+
+/**
+ * @file AtomTable.hpp
+ * @brief Server-wide intern table for IRC names (nicks, channels).
+ *
+ * intern() maps a name to a small integer Atom. Names are compared under
+ * RFC 1459 case mapping, so "#Chan" and "#chan" get the same Atom, and the
+ * table stores each distinct name once, in folded form, with its hash
+ * precomputed. Everything else (client channel lists, invites, the server's
+ * nick and channel indexes) holds the Atom, so name equality is an integer
+ * compare and per-object copies of the string disappear. Display spelling
+ * stays with the owner (Client::nick(), Channel::name()).
+ *
+ * Atoms are reference counted; an Atom and its slot are reused once the
+ * last holder releases it. find() never allocates.
+ */
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+typedef unsigned Atom;
+
+class AtomTable {
+    struct Entry {
+        std::string   text;  // folded
+        unsigned long hash;  // ircHash(text)
+        unsigned      refs;  // 0: free
+    };
+    std::vector<Entry> _atoms; // index = Atom; [0] is NO_ATOM
+    std::vector<Atom>  _free;
+    std::vector<Atom>  _slots; // open addressing, 0 = empty, power-of-two size
+    size_t             _live;
+
+    size_t probe(const char* p, size_t n, unsigned long h) const;
+    void   grow();
+    void   unlink(Atom a);
+
+    AtomTable(const AtomTable&);
+    AtomTable& operator=(const AtomTable&);
+public:
+    enum { NO_ATOM = 0 };
+
+    AtomTable();
+
+    /** @brief Atom for name, creating it if needed; adds one reference. */
+    Atom intern(const std::string& name);
+    /** @return Atom for name (any case) or NO_ATOM. Does not allocate. */
+    Atom find(const char* p, size_t n) const;
+    Atom find(const std::string& name) const { return find(name.data(), name.size()); }
+
+    void retain(Atom a);
+    /** @brief Drop one reference; the Atom is freed at zero. */
+    void release(Atom a);
+
+    /** @return Folded name of a. */
+    const std::string& text(Atom a) const { return _atoms[a].text; }
+    unsigned long      hash(Atom a) const { return _atoms[a].hash; }
+
+    /** @return Live atoms. */
+    size_t size() const { return _live; }
+    /** @return Upper bound on Atom values handed out so far (for side tables). */
+    size_t limit() const { return _atoms.size(); }
+};
+
+#endif
@@ -1,10 +1,6 @@
 #ifndef BOT_HPP
 # define BOT_HPP
 
-<<<<<<< Updated upstream
-# include <set>
-# include <string>
-=======
 /**
  * @file Bot.hpp
  * @brief Lightweight helper bot that reacts to PRIVMSGs and channel events.
@@ -22,34 +18,12 @@
 #include <map>
 #include <vector>
 #include <ctime>
->>>>>>> Stashed changes
+
+#include "TimerWheel.hpp"
 
 class	Server;
 class	Client;
 
-<<<<<<< Updated upstream
-class Bot
-{
-	Server &_srv;
-	std::string _nick;                // shown in all bot messages
-	std::set<std::string> _ops_lower; // allow-list (lowercased)
-  public:
-	Bot(Server &s, const std::string &nick);
-
-	const std::string &nick() const;
-
-	// Called by server when a brand-new channel is created
-	void onChannelCreated(const std::string &chan);
-
-	// Called by command handler to let the bot react to user messages
-	void onPrivmsg(const Client &from, const std::string &target,
-		const std::string &text);
-
-  private:
-	static std::string toLower(const std::string &s);
-	bool isChannel(const std::string &s) const;
-	void say(const std::string &where, const std::string &text);
-=======
 class Bot {
 public:
     /**
@@ -81,6 +55,7 @@ public:
 private:
     Server&      _srv;
     std::string  _nick;
+    std::set<std::string> _ops_lower; // allow-list for !op / !kick (lowercased)
 
     // ---- runtime state for richer features ----
     std::time_t  _startedAt;
@@ -92,6 +67,7 @@ private:
         std::time_t due;    // due time (epoch)
     };
     std::vector<Reminder> _reminders;
+    Timer                 _reminderTimer; // armed for the earliest due reminder
 
     struct Poll {
         int                      id;
@@ -117,8 +93,12 @@ private:
     void say(const std::string& where, const std::string& text);
     /** Quick responses to casual phrases to make the bot feel alive. */
     void smallTalk(const std::string& where, const std::string& who, const std::string& text);
-    /** Check reminders and deliver any that are due; called periodically. */
+    /** Check reminders and deliver any that are due; run by _reminderTimer. */
     void checkReminders();
+    /** Arm _reminderTimer for the earliest pending reminder. */
+    void scheduleReminders();
+    /** Timer callback (ctx is the Bot). */
+    static void onReminderTimer(void* bot, Timer& t);
     /** Small, deterministic RNG wrapper for bounded integer in [0,max). */
     static long rngi(long maxExclusive);
 
@@ -166,7 +146,6 @@ private:
     static std::string formatDuration(long secs);
     /** Split a string into parts around '|', trimming spaces. */
     static bool splitByBar(const std::string& s, std::vector<std::string>& parts); // "a | b | c"
->>>>>>> Stashed changes
 };
 
 #endif
@@ -0,0 +1,121 @@
+#ifndef CAPTURE_HPP
+#define CAPTURE_HPP
+
+/**
+ * @file Capture.hpp
+ * @brief Traffic recorder: every dispatched input line, to a binary log.
+ *
+ * With ServerConfig::captureFile set, the Server records each connection's
+ * arrival, every line it dispatches (after flood control, so the log is the
+ * load the server actually executed) and each disconnect. bench/ircreplay
+ * plays a log back against a fresh server.
+ *
+ * The core only appends to an in-memory chunk; full chunks, and any partial
+ * one older than FLUSH_MS, go over a Mailbox to a writer thread that does
+ * the write(2) calls and hands the chunk back for reuse. If the disk falls
+ * MAX_CHUNKS behind, records are dropped (and counted) rather than stalling
+ * the event loop. Killing the server loses at most the last FLUSH_MS.
+ *
+ * The log holds everything clients sent, PASS lines included: it is created
+ * mode 0600.
+ *
+ * Format: the 8-byte magic "IRCCAP1\n", then records of
+ *   kind    1 byte (OPEN, LINE, CLOSE)
+ *   conn    varint, Client::connId()
+ *   delta   varint, microseconds since the previous record (or start())
+ *   length  varint, LINE only
+ *   bytes   LINE only, the line without CR LF
+ * Varints are little-endian base 128 (7 bits per byte, high bit = more).
+ */
+
+#include <string>
+#include <cstddef>
+#include <pthread.h>
+
+#include "Mailbox.hpp"
+
+class Capture {
+public:
+    enum Kind { OPEN, LINE, CLOSE };
+    enum {
+        CHUNK_BYTES = 64 << 10,
+        MAX_CHUNKS  = 256,    ///< 16 MiB written ahead of the disk at most
+        FLUSH_MS    = 50      ///< longest a record waits in a partial chunk
+    };
+
+    /** One decoded record; usec accumulates across next() calls. */
+    struct Record {
+        int           kind;
+        unsigned long conn;
+        unsigned long usec;   ///< since the capture started
+        const char*   line;   ///< LINE payload, points into the log
+        size_t        len;
+        Record(): kind(OPEN), conn(0), usec(0), line(0), len(0) {}
+    };
+
+    Capture();
+    ~Capture();
+
+    /**
+     * @brief Create (truncate) the log and start the writer. usec is the
+     *        current time on the clock later records are stamped with.
+     * @return false on error.
+     */
+    bool start(const std::string& path, unsigned long usec);
+    /** @brief Hand over what is buffered, let the writer finish, close the log. */
+    void stop();
+    bool active() const { return _fd >= 0; }
+
+    /**
+     * @brief Record an event at time usec (the Server's Clock).
+     * @return false if the record was dropped (writer behind, or inactive).
+     */
+    bool opened(unsigned long conn, unsigned long usec) { return append(OPEN, conn, usec, 0, 0); }
+    bool line(unsigned long conn, unsigned long usec, const char* p, size_t n) {
+        return append(LINE, conn, usec, p, n);
+    }
+    bool closed(unsigned long conn, unsigned long usec) { return append(CLOSE, conn, usec, 0, 0); }
+
+    /** @return true while a partial chunk waits for tick() to hand it over. */
+    bool pending() const { return _cur && _cur->n; }
+    /** @brief End of an event-loop tick: hand over a partial chunk once it is FLUSH_MS old. */
+    void tick(unsigned long usec);
+
+    /** @return true if the buffer starts with the log magic. */
+    static bool checkMagic(const char* p, size_t n);
+    /** @return Bytes of magic to skip before the first record. */
+    static size_t magicSize();
+    /**
+     * @brief Decode the record at p (advanced past it) into r.
+     * @return 1 on success, 0 at end, -1 if the log is truncated or corrupt.
+     */
+    static int next(const char*& p, const char* end, Record& r);
+
+private:
+    struct Chunk {
+        size_t n;
+        char   data[CHUNK_BYTES];
+    };
+
+    int             _fd;
+    pthread_t       _thread;
+    bool            _running;
+    int             _stop;      // set by the core, read by the writer
+    Mailbox<Chunk*> _full;      // core -> writer
+    Mailbox<Chunk*> _empty;     // writer -> core, for reuse
+    Wakeup          _wake;      // rung when _full gets a chunk
+    Chunk*          _cur;       // being filled by the core
+    unsigned long   _curSince;  // usec of the first record in _cur
+    unsigned long   _last;      // usec of the previous record
+    unsigned        _chunks;    // allocated so far
+
+    bool append(Kind k, unsigned long conn, unsigned long usec, const char* p, size_t n);
+    void handOver();
+    static void* threadMain(void* self);
+    void writerLoop();
+
+    Capture(const Capture&);
+    Capture& operator=(const Capture&);
+};
+
+#endif
@@ -5,56 +5,96 @@
  * @file Channel.hpp
  * @brief In-memory representation of an IRC channel and its modes.
  *
- * The Channel encapsulates member tracking (by client fd), operator list
- * (by nick, lower-cased), optional invite list, and a small subset of IRC
- * modes commonly seen in school projects:
+ * The Channel encapsulates member tracking, per-member roles (operator,
+ * invited) and a small subset of IRC modes commonly seen in school projects:
  * - i: invite-only
  * - t: topic settable by ops only
  * - k: channel key (password)
  * - l: user limit (max members)
  *
- * The server stores channels in a case-insensitive map by lower-case key,
- * while preserving the original name for display.
+ * The server stores channels in a case-insensitive index by folded name,
+ * while preserving the original name for display. Channel objects are
+ * recycled through an ObjectPool (see reset() / recycle()).
+ *
+ * People are identified by the small member ID the server gives each
+ * connection (Client::memberId()), not by fd or nick, so roles survive NICK.
+ * Entries live in one vector sorted by ID, each with a role bitmask; an entry
+ * exists while any role bit is set (an invited non-member has only INVITED).
+ * Membership tests are a binary search and broadcasts a linear scan.
+ *
+ * The serialized NAMES list and mode string are cached and rebuilt only
+ * after a change (membership, ops, a member's nick, a mode), so a JOIN
+ * burst or MODE query copies prebuilt text instead of walking members.
  */
 
 #include <string>
-#include <set>
+#include <vector>
+#include <cstddef>
 
-class Channel {
-    std::string _name;
-    std::string _topic;
-    std::set<int> _members;                 // client fds
-    std::set<std::string> _operators;       // nicks
-    std::set<std::string> _invited;         // nicks
-    bool _inviteOnly;
-    bool _topicRestricted;
-    std::string _key;
-    int _userLimit; // -1 = none
+#include "AtomTable.hpp"
 
+class Channel {
 public:
-    Channel(const std::string& name);
+    /** Role bits of a channel entry. */
+    enum {
+        JOINED  = 1 << 0,
+        OP      = 1 << 1,
+        INVITED = 1 << 2,
+        VOICE   = 1 << 3
+    };
+    struct Member {
+        unsigned      id;
+        unsigned char roles;
+    };
+    /** @brief Resolves a member ID to its nick (ctx is the resolver's owner). */
+    typedef const std::string& (*NickFn)(void* ctx, unsigned id);
+
+    /**
+     * @param name Display name.
+     * @param atom Interned folded name; the Server holds its reference.
+     */
+    Channel(const std::string& name = std::string(), Atom atom = AtomTable::NO_ATOM);
+
+    /** @brief Reuse this object for a new channel (state starts clean). */
+    void reset(const std::string& name, Atom atom);
+    /** @brief Drop members, topic and modes; keep capacity (ObjectPool hook). */
+    void recycle();
 
     const std::string& name() const;
+    /** @return Interned channel name. */
+    Atom atom() const;
     const std::string& topic() const;
     void setTopic(const std::string& t);
 
-    bool hasMemberFd(int fd) const;
-    void addMember(int fd);
-    void removeMember(int fd);
-    const std::set<int>& members() const;
+    bool hasMember(unsigned id) const;
+    /** @brief Mark id as joined (keeps other role bits). */
+    void addMember(unsigned id);
+    /** @brief Drop id's entry entirely (membership and all roles). */
+    void removeMember(unsigned id);
+    /** @return Number of joined members (invite-only entries excluded). */
+    size_t memberCount() const;
+    /** @return All entries sorted by ID; test JOINED before treating as member. */
+    const std::vector<Member>& entries() const;
 
-    bool isOp(const std::string& nick) const;
-    void addOp(const std::string& nick);
-    void removeOp(const std::string& nick);
-<<<<<<< Updated upstream
-=======
+    /**
+     * @return NAMES body ("@op nick ..." for joined members, in ID order),
+     *         rebuilt through nickOf only if something changed since.
+     */
+    const std::string& names(NickFn nickOf, void* ctx);
+    /** @brief A member changed nick: the next names() rebuilds. */
+    void invalidateNames();
+    /** @return "+itkl key limit" as in 324 / MODE, rebuilt after a change. */
+    const std::string& modes();
+
+    bool isOp(unsigned id) const;
+    /** @brief Grant or revoke OP; only applies to joined members. */
+    void setOp(unsigned id, bool on);
     /** @brief True if the channel has at least one operator. */
-    bool hasAnyOp() const;                 // NEW
->>>>>>> Stashed changes
+    bool hasAnyOp() const;
 
-    void invite(const std::string& nick);
-    bool isInvited(const std::string& nick) const;
-    bool consumeInvite(const std::string& nick);
+    void invite(unsigned id);
+    bool isInvited(unsigned id) const;
+    bool consumeInvite(unsigned id);
 
     /** @return Whether the channel is invite-only (+i). */
     bool inviteOnly() const;
@@ -73,30 +113,33 @@ public:
     /** @brief Remove the channel key (-k). */
     void clearKey();
 
-<<<<<<< Updated upstream
-    int userLimit() const;
-=======
-    /** @return Current user limit (+l), or 0 if unlimited. */
+    /** @return Current user limit (+l), or -1 if unlimited. */
     int  userLimit() const;
-    /** @brief Set the user limit (+l), clamped to non-negative values. */
->>>>>>> Stashed changes
+    /** @brief Set the user limit (+l); -1 removes the limit. */
     void setUserLimit(int lim);
-    /** @return True if userLimit() > 0 and members().size() >= limit. */
+    /** @return True if userLimit() != -1 and memberCount() >= limit. */
     bool isFull() const;
-<<<<<<< Updated upstream
-=======
 
 private:
+    size_t lowerBound(unsigned id) const;
+    const Member* findEntry(unsigned id) const;
+    /** @brief Set/clear role bits, creating or dropping the entry as needed. */
+    void setRoles(unsigned id, unsigned char set, unsigned char clear);
+
     std::string         _name;
+    Atom                _atom;
     std::string         _topic;
-    std::set<int>         _members;     //!< Joined members (by client fd)
-    std::set<std::string> _operators;   //!< Operator nicks (lower-case)
-    std::set<std::string> _invited;     //!< One-time invite tokens (lower-case)
+    std::vector<Member> _entries;     //!< Sorted by id
+    size_t              _joined;      //!< Entries with JOINED
+    size_t              _ops;         //!< Entries with OP
     bool                _inviteOnly;
     bool                _topicRestricted;
     std::string         _key;
     int                 _userLimit;
->>>>>>> Stashed changes
+    std::string         _names;       //!< names() cache
+    std::string         _modes;       //!< modes() cache
+    bool                _namesDirty;
+    bool                _modesDirty;
 };
 
 #endif
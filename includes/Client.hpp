@@ -6,35 +6,81 @@
  * @brief Representation of a single connected IRC client.
  *
  * Client objects track registration state (PASS/NICK/USER), identity fields
- * (nick, user, real), per-fd input/output buffers, and the set of joined
- * channel names. The Server owns Client instances and manages their lifetime.
+ * (nick, user, real), per-fd input/output buffers, and the joined channels
+ * (as interned names, see AtomTable.hpp). The Server owns Client instances
+ * and manages their lifetime; they are recycled through an ObjectPool, so
+ * one object serves many connections (see reset() / recycle()).
  */
 
 #include <string>
-#include <set>
+#include <vector>
+
+#include "OutQueue.hpp"
+#include "LineBuffer.hpp"
+#include "AtomTable.hpp"
+#include "TimerWheel.hpp"
 
 class Server;
 
 class Client {
     int _fd;
+    unsigned long _connId;
+    unsigned _memberId;
     bool _registered;
     bool _pass_ok;
+    bool _readPaused; // SendQ over soft limit: input not read
+    bool _evicting;   // SendQ over hard limit: removal pending
+    bool _throttled;  // input bucket empty: lines deferred
+    bool _capHold;    // CAP negotiation in progress: registration waits
+    unsigned _caps;   // enabled IRCv3 capabilities (Cap bits)
+    unsigned long _floodTokens; // input bucket, in 1/1000 tokens
+    unsigned long _floodAt;     // monotonicUsec() the bucket is filled up to
+    unsigned long _lastActive;  // ms (wheel clock) of the last line received
+    bool _pingPending;          // server PING sent, no line received since
+    Timer _timer;               // registration / keepalive deadline
     std::string _nick, _user, _real;
-    std::string _inbuf, _outbuf;
-    std::set<std::string> _channels; // lowercased names
+    std::string _stem;          // ":server 000 nick " for numeric replies
+    Atom _nickAtom;
+    LineBuffer _inbuf;
+    OutQueue _outbuf;
+    std::vector<Atom> _channels; // joined channels
+    std::vector<Atom> _invites;  // channels with a pending invite (referenced)
 
 public:
+    /** @brief Capabilities a client can enable with CAP REQ. */
+    enum Cap {
+        CAP_ECHO_MESSAGE = 1 << 0, ///< echo-message: own PRIVMSGs come back
+        CAP_NO_HINTS     = 1 << 1  ///< ircserv/no-hints: no helper NOTICEs
+    };
+
     /**
      * @brief Construct a client wrapper for a newly accepted fd.
-     * @param fd Non-blocking socket file descriptor.
+     * @param fd     Non-blocking socket file descriptor.
+     * @param connId Server-wide connection serial (never reused, unlike fd).
+     * @param memberId Small ID channels use to refer to this client; reused
+     *                 only after the client is gone.
      */
-    Client(int fd);
+    Client(int fd = -1, unsigned long connId = 0, unsigned memberId = 0);
     ~Client();
 
+    /** @brief Start a new connection's lifecycle on a recycled object. */
+    void reset(int fd, unsigned long connId, unsigned memberId);
+    /**
+     * @brief Drop all per-connection state, keeping buffer capacity
+     * (ObjectPool hook). Oversized input buffers are released.
+     */
+    void recycle();
+
     /** @return The client's socket fd. */
     int fd() const;
+    /** @return Connection serial assigned at accept time. */
+    unsigned long connId() const;
+    /** @return Channel member ID (stable for the connection's lifetime). */
+    unsigned memberId() const;
     /** @return Current nickname (may be empty before registration). */
     const std::string& nick() const;
+    /** @return Interned nick, or NO_ATOM before the first NICK. */
+    Atom nickAtom() const;
     /** @return USER field. */
     const std::string& user() const;
     /** @return Real name (gecos). */
@@ -46,8 +92,18 @@ public:
 
     /** @brief Set PASS result; used by CommandHandler PASS. */
     void setPassOk(bool v);
-    /** @brief Update nickname; validation is done in CommandHandler. */
-    void setNick(const std::string& n);
+    /**
+     * @brief Update nickname; validation is done in CommandHandler and the
+     * atom is managed by Server::setClientNick().
+     */
+    void setNick(const std::string& n, Atom atom);
+    /**
+     * @brief Rebuild the cached numeric stem from the current nick ("*"
+     * until one is set). Server calls this on admission and nick change.
+     */
+    void setReplyStem(const std::string& serverPrefix);
+    /** @return ":server 000 nick "; the code goes at the prefix length. */
+    const std::string& replyStem() const;
     /** @brief Set USER/REAL fields. */
     void setUser(const std::string& u, const std::string& r);
     /**
@@ -58,17 +114,72 @@ public:
      */
     void tryRegister(Server& s);
 
+    /** @return true if the client enabled capability cap (a Cap bit). */
+    bool hasCap(unsigned cap) const;
+    /** @return Enabled Cap bits. */
+    unsigned caps() const;
+    void setCaps(unsigned caps);
+    /**
+     * @brief Hold registration while CAP negotiation runs (CAP LS/REQ
+     * before registering); CAP END releases it.
+     */
+    void setCapHold(bool v);
+
     /** @return Mutable reference to the input accumulation buffer. */
-    std::string& inbuf();
-    /** @return Mutable reference to the output (pending send) buffer. */
-    std::string& outbuf();
-
-    /** @return Set of lower-cased channel names the client has joined. */
-    const std::set<std::string>& channels() const;
-    /** @brief Track that the client joined a channel (lower-case name). */
-    void joinChannel(const std::string& name);
-    /** @brief Track that the client left a channel (lower-case name). */
-    void leaveChannel(const std::string& name);
+    LineBuffer& inbuf();
+    /** @return Mutable reference to the output (pending send) queue. */
+    OutQueue& outbuf();
+    /** @return Bytes queued for this client but not yet sent (its SendQ). */
+    size_t sendqBytes() const;
+
+    /** @return true while the server holds back this client's input. */
+    bool readPaused() const;
+    void setReadPaused(bool v);
+    /** @return true once scheduled for an "Excess SendQ" disconnect. */
+    bool evicting() const;
+    void setEvicting();
+
+    /** @return true while lines wait in inbuf for flood-control tokens. */
+    bool throttled() const;
+    void setThrottled(bool v);
+    /**
+     * @brief Spend cost tokens from the input bucket, refilling it first.
+     * @param now   monotonicUsec() timestamp.
+     * @param rate  Tokens earned per second (>= 1).
+     * @param burst Bucket capacity; a full bucket absorbs a short paste.
+     * @return false (nothing spent) if the bucket holds fewer tokens.
+     */
+    bool takeTokens(unsigned cost, unsigned long now, unsigned rate, unsigned burst);
+    /** @brief Fill the input bucket to burst tokens as of now (a new class). */
+    void refillTokens(unsigned long now, unsigned burst);
+
+    /** @brief Note a line from the client (answers any pending PING). */
+    void touch(unsigned long nowMs);
+    /** @return Wheel time of the last line received. */
+    unsigned long lastActive() const;
+    bool pingPending() const;
+    void setPingPending(bool v);
+    /** @return The client's liveness timer (see Server::clientTimer()). */
+    Timer& timer();
+
+    /** @return Channels the client has joined. */
+    const std::vector<Atom>& channels() const;
+    /** @brief Track that the client joined a channel. */
+    void joinChannel(Atom chan);
+    /** @brief Track that the client left a channel. */
+    void leaveChannel(Atom chan);
+    /** @return Channels that invited this client. */
+    const std::vector<Atom>& invites() const;
+    /**
+     * @brief Remember an invite so it can be revoked on disconnect.
+     * @return true if new (the caller then takes a reference on the atom).
+     */
+    bool noteInvite(Atom chan);
+    /**
+     * @brief Forget an invite once the channel no longer holds it.
+     * @return true if it was held (the caller then drops its reference).
+     */
+    bool dropInvite(Atom chan);
 };
 
 #endif
@@ -0,0 +1,41 @@
+#ifndef CLOCK_HPP
+#define CLOCK_HPP
+
+/**
+ * @file Clock.hpp
+ * @brief Time source for the Server's logic: timers, flood control, idle
+ *        pings, the bot's reminders.
+ *
+ * The Server reads time only through a Clock (ServerConfig::clock), so a
+ * simulation can substitute SimClock and make time pass as fast, or as
+ * slowly, as it likes. Measurements (tick and command latencies) keep
+ * using monotonicNsec(): they time the real work, whatever the clock says.
+ */
+
+#include <ctime>
+
+class Clock {
+public:
+    virtual ~Clock() {}
+    /** @return Microseconds from an arbitrary fixed point, never decreasing. */
+    virtual unsigned long usec() = 0;
+    /** @return Wall-clock seconds since the epoch, for human-facing times. */
+    virtual std::time_t wall() = 0;
+
+    /** @return The process clock: monotonicUsec() and time(). */
+    static Clock& system();
+};
+
+/** @brief Manually advanced clock; wall time moves along with usec(). */
+class SimClock : public Clock {
+    unsigned long _usec;
+    std::time_t   _wall0;
+public:
+    explicit SimClock(unsigned long usec = 1000000, std::time_t wall0 = 1700000000)
+    : _usec(usec), _wall0(wall0) {}
+    virtual unsigned long usec() { return _usec; }
+    virtual std::time_t wall() { return _wall0 + (std::time_t)(_usec / 1000000); }
+    void advance(unsigned long usec) { _usec += usec; }
+};
+
+#endif
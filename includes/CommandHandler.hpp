@@ -6,18 +6,57 @@
  * @brief IRC command parsing and dispatching.
  *
  * CommandHandler transforms a parsed IRC line into server-side actions. It
- * assumes splitCmd() has separated the command, params, and trailing text.
- * Validation and numeric error replies are emitted from here.
+ * assumes parseIrcLine() has separated the command, params, and trailing
+ * text. Validation and numeric error replies are emitted from here.
+ *
+ * The Server keeps one long-lived CommandHandler for the read path so the
+ * parameter strings below are reused line after line: once warmed up,
+ * copying views into them does not touch the heap.
+ *
+ * Commands are looked up in a static table (a switch on the first letter,
+ * then a length + case-insensitive compare). Each entry carries the
+ * minimum number of parameters and whether registration is required, so
+ * handlers only see lines that already passed those checks. The table also
+ * counts calls and bytes per command and keeps a histogram of handler
+ * time (reported by STATS m and STATS l), and gives each command its input
+ * flood-control cost (see lineCost()).
  */
 
 #include <string>
 #include <vector>
+#include <cstddef>
+
+#include "Utils.hpp"
+#include "Metrics.hpp"
+#include "VisitMarks.hpp"
 
 class Server;
 class Client;
+class Channel;
+
+/** @brief Usage counters for one command. */
+struct CommandStat {
+    const char*   name;
+    unsigned long calls;
+    unsigned long bytes; // raw line bytes, CRLF excluded
+    Histogram     ns;    // handler wall time per call
+};
 
 class CommandHandler {
+    typedef void (CommandHandler::*Handler)(Client&, const std::vector<std::string>&, const std::string&);
+    struct Command;
+    static Command _commands[];
+
+    /** @return Table entry for the command token, or 0 if unknown. */
+    static Command* lookup(const char* p, size_t n);
+
     Server& _srv;
+    // scratch reused across lines (capacity is kept)
+    std::string              _cmd;
+    std::vector<std::string> _params;
+    std::vector<std::string> _spare;    // parked param strings, buffers intact
+    std::string              _trailing;
+    VisitMarks               _targets;  // atoms already sent to by this PRIVMSG
 public:
     CommandHandler(Server& s): _srv(s) {}
     /**
@@ -28,55 +67,67 @@ public:
      */
     void handleLine(Client& c, const std::string& line);
 
+    /**
+     * @brief Execute an already-parsed line (views into the receive buffer).
+     * @param c    The client issuing the command.
+     * @param msg  Parsed line; only read before any handler runs.
+     */
+    void handleLine(Client& c, const IrcLine& msg);
+
+    /** @return Number of entries in the command table. */
+    static size_t commandCount();
+    /** @return Usage counters of the i-th command (table order). */
+    static const CommandStat& commandStat(size_t i);
+
+    /** @return Flood-control tokens the line costs (by command). */
+    static unsigned lineCost(const IrcLine& msg);
+
 private:
+    /** Handle CAP LS|LIST|REQ|END (IRCv3 capability negotiation) */
+    void cmdCAP(Client&, const std::vector<std::string>&, const std::string& trailing);
     /** Handle PASS <password> */
-    void cmdPASS(Client&, const std::vector<std::string>&);
+    void cmdPASS(Client&, const std::vector<std::string>&, const std::string&);
     /** Handle NICK <nickname> */
-    void cmdNICK(Client&, const std::vector<std::string>&);
+    void cmdNICK(Client&, const std::vector<std::string>&, const std::string&);
     /** Handle USER <user> <mode> * :<realname> */
     void cmdUSER(Client&, const std::vector<std::string>&, const std::string& trailing);
     /** Handle PING <token> */
-    void cmdPING(Client&, const std::vector<std::string>&);
+    void cmdPING(Client&, const std::vector<std::string>&, const std::string&);
     /** Handle PONG <token> */
-    void cmdPONG(Client&, const std::vector<std::string>&);
+    void cmdPONG(Client&, const std::vector<std::string>&, const std::string&);
     /** Handle PRIVMSG <target> :<text> (user or channel) */
     void cmdPRIVMSG(Client&, const std::vector<std::string>&, const std::string& trailing);
     /** Handle JOIN <chans> [<keys>] */
-    void cmdJOIN(Client&, const std::vector<std::string>&);
-<<<<<<< Updated upstream
-    void cmdPART(Client&, const std::vector<std::string>&);
-=======
-    /** Handle PART <chans> [:<reason>] */
-    void cmdPART(Client&, const std::vector<std::string>&, const std::string& trailing);
+    void cmdJOIN(Client&, const std::vector<std::string>&, const std::string&);
+    /** Handle PART <chan> */
+    void cmdPART(Client&, const std::vector<std::string>&, const std::string&);
     /** Handle QUIT [:<message>] */
->>>>>>> Stashed changes
     void cmdQUIT(Client&, const std::vector<std::string>&, const std::string& trailing);
     /** Handle TOPIC <chan> [:<topic>] honoring +t mode */
     void cmdTOPIC(Client&, const std::vector<std::string>&, const std::string& trailing);
     /** Handle MODE <chan> [[+|-]itkl <args>] */
-    void cmdMODE(Client&, const std::vector<std::string>&);
+    void cmdMODE(Client&, const std::vector<std::string>&, const std::string&);
     /** Handle INVITE <nick> <chan> */
-    void cmdINVITE(Client&, const std::vector<std::string>&);
+    void cmdINVITE(Client&, const std::vector<std::string>&, const std::string&);
     /** Handle KICK <chan> <nick> [:<reason>] */
     void cmdKICK(Client&, const std::vector<std::string>&, const std::string& trailing);
     /** Begin a file transfer offer (custom extension) */
     void cmdFILESEND(Client&, const std::vector<std::string>&, const std::string& trailing);
     /** Accept a previously offered file transfer (custom extension) */
-    void cmdFILEACCEPT(Client&, const std::vector<std::string>&);
+    void cmdFILEACCEPT(Client&, const std::vector<std::string>&, const std::string&);
     /** Stream data chunk for a transfer (custom extension) */
-    void cmdFILEDATA(Client&, const std::vector<std::string>&);
+    void cmdFILEDATA(Client&, const std::vector<std::string>&, const std::string&);
     /** Mark end-of-stream for a transfer (custom extension) */
-    void cmdFILEDONE(Client&, const std::vector<std::string>&);
+    void cmdFILEDONE(Client&, const std::vector<std::string>&, const std::string&);
     /** Cancel a transfer (custom extension) */
-    void cmdFILECANCEL(Client&, const std::vector<std::string>&);
+    void cmdFILECANCEL(Client&, const std::vector<std::string>&, const std::string&);
+    /** Handle STATS m (per-command usage counters) and STATS p (object pools) */
+    void cmdSTATS(Client&, const std::vector<std::string>&, const std::string&);
 
-    /**
-     * @brief Send a numeric reply to a client.
-     * @param code Numeric as a string (e.g., "401").
-     * @param msg  Preformatted message text after the code.
-     */
-    void sendNumeric(Client&, const std::string& code, const std::string& msg);
     
+    /** @brief 353 lines (each within 512 bytes) and 366 for ch, as chan. */
+    void sendNames(Client& c, Channel* ch, const std::string& chan);
+
     /**
      * @brief Ensure the client is fully registered before running a command.
      * @param c      Client reference.
@@ -0,0 +1,72 @@
+#ifndef CONN_TABLE_HPP
+#define CONN_TABLE_HPP
+
+/**
+ * @file ConnTable.hpp
+ * @brief Dense, fd-indexed table of live client connections.
+ *
+ * File descriptors are small integers handed out lowest-first by the kernel,
+ * so a vector indexed by fd gives O(1) lookup without hashing. Each slot
+ * records the Client, its position in a compact list of live fds (used for
+ * iteration), and the poll events mask last requested for it so redundant
+ * mask updates can be skipped.
+ *
+ * Removal swaps the last live fd into the hole, keeping the live list
+ * contiguous without a per-tick compaction pass.
+ */
+
+#include <vector>
+#include <cstddef>
+
+class Client;
+
+class ConnTable {
+public:
+    ConnTable();
+
+    /** @return Client for fd, or NULL if fd is not a live connection. */
+    Client* get(int fd) const {
+        return (fd >= 0 && (size_t)fd < _slots.size()) ? _slots[fd].client : 0;
+    }
+
+    /** @brief Register a connection. fd must not already be present. */
+    void insert(int fd, Client* c);
+
+    /**
+     * @brief Remove fd (swap-remove from the live list).
+     * @return The Client that was stored, or NULL if fd was not present.
+     */
+    Client* erase(int fd);
+
+    /** @return Number of live connections. */
+    size_t size() const { return _live.size(); }
+    /** @return fd of the i-th live connection (0 <= i < size()). */
+    int fdAt(size_t i) const { return _live[i]; }
+    /** @return Client of the i-th live connection (0 <= i < size()). */
+    Client* at(size_t i) const { return _slots[_live[i]].client; }
+
+    /** @return Poll events mask last recorded for fd (0 if unknown). */
+    short events(int fd) const {
+        return get(fd) ? _slots[fd].events : 0;
+    }
+    /**
+     * @brief Record the poll events mask for fd.
+     * @return true if fd is live and the mask actually changed.
+     */
+    bool setEvents(int fd, short events);
+
+    /** @brief Drop every entry (does not free Clients). */
+    void clear();
+
+private:
+    struct Slot {
+        Client* client;
+        int     live;   // index into _live, -1 when free
+        short   events; // last mask handed to the poller
+        Slot(): client(0), live(-1), events(0) {}
+    };
+    std::vector<Slot> _slots; // indexed by fd
+    std::vector<int>  _live;  // compact list of live fds
+};
+
+#endif
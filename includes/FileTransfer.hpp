@@ -9,11 +9,16 @@
  * custom IRC-like commands (FILESEND/FILEACCEPT/FILEDATA/FILEDONE/FILECANCEL).
  * Data is stored server-side under a dedicated folder and optionally streamed
  * between clients when accepted.
+ *
+ * A transfer record lives from FILESEND until FILEDONE, FILECANCEL or either
+ * peer disconnecting; records are recycled through an ObjectPool.
  */
 
 #include <string>
 #include <map>
 
+#include "ObjectPool.hpp"
+
 class Server;
 class Client;
 
@@ -30,23 +35,29 @@ struct Transfer {
     bool         accepted;
     bool         active;
     Transfer(): id(0), sender_fd(-1), receiver_fd(-1), size_total(0), size_seen(0), accepted(false), active(false) {}
+    /** @brief Back to the default state; filename keeps its capacity. */
+    void recycle() {
+        id = 0; sender_fd = receiver_fd = -1;
+        filename.clear();
+        size_total = size_seen = 0;
+        accepted = active = false;
+    }
 };
 
 class FileTransfer {
     Server& _srv;
     int     _nextId;
-    std::map<int, Transfer> _byId;
+    std::map<int, Transfer*> _byId;
+    ObjectPool<Transfer>     _pool;
+
+    /** @brief Forget a finished transfer and recycle its record. */
+    void finish(std::map<int, Transfer*>::iterator it);
 public:
     /**
      * @brief Construct the file transfer coordinator bound to a Server.
      */
     FileTransfer(Server& s);
-<<<<<<< Updated upstream
-    int  createOffer(int sender_fd, int receiver_fd, const std::string& filename, unsigned long size_total);
-    bool accept(int tid, int receiver_fd);
-    bool cancel(int tid, int who_fd, std::string& reasonOut);
-    // data is base64; will be decoded and forwarded *as-is* as bytes in chunks of up to chunkMax
-=======
+    ~FileTransfer();
 
     // Create an offer; filename is a relative path under the server's CWD (project root).
     /**
@@ -80,15 +91,14 @@ public:
 
     // Legacy/manual path retained for compatibility (not used when auto-streaming is available)
     /** Append a base64-encoded data chunk to the transfer's file. */
->>>>>>> Stashed changes
     bool pushData(int tid, int sender_fd, const std::string& base64, std::string& errOut);
     /** Mark the transfer as complete after all data has been sent. */
     bool done(int tid, int sender_fd, std::string& errOut);
+    /** @brief Drop every transfer fd takes part in (it disconnected). */
+    void dropClient(int fd);
+    /** @return Transfer record pool counters (STATS p). */
+    const PoolStats& poolStats() const { return _pool.stats(); }
 
-<<<<<<< Updated upstream
-    // small helpers for encoding/decoding
-    static bool b64Decode(const std::string& in, std::string& out);
-=======
     // small helpers for encoding/decoding (server uses both)
     /** Base64 decode utility (no newlines required). */
     static bool b64Decode(const std::string& in, std::string& out);
@@ -113,7 +123,6 @@ private:
     static unsigned long crc32_update(unsigned long crc, const unsigned char* buf, size_t len);
     static unsigned long crc32_init();
     static unsigned long crc32_final(unsigned long crc);
->>>>>>> Stashed changes
 };
 
 #endif
@@ -0,0 +1,53 @@
+#ifndef LINE_BUFFER_HPP
+#define LINE_BUFFER_HPP
+
+/**
+ * @file LineBuffer.hpp
+ * @brief Incremental CRLF framer for a connection's receive buffer.
+ *
+ * Bytes are appended as they arrive; next() hands out complete lines as
+ * views into the buffer without copying. Scanning resumes where the last
+ * search stopped, so a long partial line is not rescanned on every recv(),
+ * and the search itself is memchr() (vectorized by the C library).
+ *
+ * Consumed lines are not erased one by one: compact() drops the whole
+ * consumed prefix once per batch, which only moves the unfinished tail.
+ */
+
+#include <string>
+#include <cstddef>
+
+class LineBuffer {
+    std::string _buf;
+    size_t      _start; // first unconsumed byte
+    size_t      _scan;  // no "\r\n" ends before this offset
+    size_t      _prev;  // start of the line last returned by next()
+public:
+    LineBuffer();
+
+    /** @brief Append received bytes. Invalidates views from next(). */
+    void append(const char* p, size_t n);
+    void append(const std::string& s) { append(s.data(), s.size()); }
+
+    /**
+     * @brief Take the next complete line, CRLF excluded.
+     * @param line Output: start of the line inside the buffer.
+     * @param len  Output: line length.
+     * @return false if no complete line is buffered.
+     */
+    bool next(const char*& line, size_t& len);
+
+    /** @brief Put back the line last returned by next() (not yet handled). */
+    void unread();
+
+    /** @brief Release consumed bytes; call after a batch of next(). */
+    void compact();
+
+    /** @brief Empty the buffer; keep its capacity unless above keepCap. */
+    void reset(size_t keepCap);
+
+    /** @return Buffered bytes not yet returned by next(). */
+    size_t pending() const { return _buf.size() - _start; }
+};
+
+#endif
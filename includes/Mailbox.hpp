@@ -0,0 +1,86 @@
+#ifndef MAILBOX_HPP
+#define MAILBOX_HPP
+
+/**
+ * @file Mailbox.hpp
+ * @brief Lock-free single-producer/single-consumer queue plus a wakeup fd.
+ *
+ * Mailboxes carry work between the core thread and reactor threads (see
+ * Reactor.hpp). Every mailbox has exactly one producer thread and one
+ * consumer thread, which keeps the queue a plain linked list with two
+ * atomic pointer operations and no locks. FIFO order per mailbox is what
+ * preserves per-sender message order across threads.
+ *
+ * Wakeup is the doorbell paired with a mailbox: a non-blocking pipe the
+ * consumer registers in its Poller. A pending flag ensures producers write
+ * at most one byte per consumer wake-up, however many messages they push.
+ *
+ * C++98 has no atomics; the GCC/Clang __atomic builtins are used instead.
+ */
+
+#include <cstddef>
+
+template <typename T>
+class Mailbox {
+    struct Node {
+        Node* next;
+        T     value;
+        Node(): next(0), value() {}
+    };
+    Node* _head;                    // consumer-owned; always a consumed/dummy node
+    char  _pad[64 - sizeof(Node*)]; // keep producer and consumer lines apart
+    Node* _tail;                    // producer-owned
+
+    Mailbox(const Mailbox&);
+    Mailbox& operator=(const Mailbox&);
+public:
+    Mailbox(): _head(new Node()), _tail(_head) { (void)_pad; }
+    ~Mailbox() {
+        while (_head) { Node* n = _head->next; delete _head; _head = n; }
+    }
+
+    /** @brief Append a value. Producer thread only. */
+    void push(const T& v) {
+        Node* n = new Node();
+        n->value = v;
+        __atomic_store_n(&_tail->next, n, __ATOMIC_RELEASE);
+        _tail = n;
+    }
+
+    /** @brief Take the oldest value, if any. Consumer thread only. */
+    bool pop(T& out) {
+        Node* next = __atomic_load_n(&_head->next, __ATOMIC_ACQUIRE);
+        if (!next) return false;
+        out = next->value;
+        next->value = T(); // release payload memory now, not on the next pop
+        delete _head;
+        _head = next;
+        return true;
+    }
+};
+
+class Wakeup {
+    int _rfd;
+    int _wfd;
+    int _pending; // 1 while a byte is (about to be) in the pipe
+
+    Wakeup(const Wakeup&);
+    Wakeup& operator=(const Wakeup&);
+public:
+    Wakeup();
+    ~Wakeup();
+
+    /** @brief Create the pipe. @return false on failure. */
+    bool open();
+    /** @return Read end to register with a Poller (POLLIN). */
+    int fd() const { return _rfd; }
+    /** @brief Wake the consumer. Safe from any thread; coalesces. */
+    void signal();
+    /**
+     * @brief Consume the wake-up. The consumer must call this before it
+     * drains its mailboxes so no signal raised during the drain is lost.
+     */
+    void drain();
+};
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+/**
+ * @file Metrics.hpp
+ * @brief In-process counters, gauges and latency histograms.
+ *
+ * Every metric is declared once in the tables below and lives in a fixed
+ * array of the Metrics registry owned by the Server, so recording one is an
+ * indexed add: no lookup, no lock, no allocation. The registry belongs to
+ * the core thread, like the Arena; in reactor mode bytes are counted where
+ * the core receives or hands them off, not in the reactor threads.
+ *
+ * Gauges are sampled when read (Server::sampleGauges()), not maintained on
+ * every change.
+ *
+ * Histograms are log-linear: each power of two is split into 8 linear
+ * buckets, so a value is placed within 12.5% with 304 buckets covering
+ * 0 .. 2^40. Reports give bucket upper bounds.
+ *
+ * Operators read the registry with STATS c / STATS l, or as Prometheus-style
+ * text on the admin socket (ServerConfig::adminSocket).
+ */
+
+#include <string>
+#include <ostream>
+#include <cstddef>
+
+//  X(identifier,       exposition name,              help)
+#define IRC_COUNTERS(X) \
+    X(CONN_ACCEPTED,    "connections_accepted_total", "Sockets accepted on the listener") \
+    X(CONN_CLOSED,      "connections_closed_total",   "Clients disconnected, for any reason") \
+    X(EVICT_SENDQ,      "evictions_sendq_total",      "Clients disconnected for Excess SendQ") \
+    X(EVICT_FLOOD,      "evictions_flood_total",      "Clients disconnected for Excess Flood") \
+    X(BYTES_IN,         "bytes_in_total",             "Bytes received from clients") \
+    X(LINES_IN,         "lines_in_total",             "Lines parsed from client input") \
+    X(LINES_THROTTLED,  "lines_throttled_total",      "Times input stopped for flood-control tokens") \
+    X(MSGS_OUT,         "messages_out_total",         "Lines queued to clients, one per recipient") \
+    X(BYTES_QUEUED,     "bytes_queued_total",         "Bytes queued to clients") \
+    X(BYTES_OUT,        "bytes_out_total",            "Bytes written to sockets or handed to reactors") \
+    X(SENDQ_DROPPED,    "sendq_dropped_total",        "Low-priority lines dropped by SendQ limits") \
+    X(CAPTURE_DROPPED,  "capture_dropped_total",      "Capture records dropped while the log writer lagged")
+
+#define IRC_GAUGES(X) \
+    X(CLIENTS,          "clients",                    "Connected clients") \
+    X(PENDING,          "pending_admission",          "Accepted sockets not yet admitted") \
+    X(CHANNELS,         "channels",                   "Channels") \
+    X(SENDQ_BYTES,      "sendq_bytes",                "Bytes queued across all clients") \
+    X(ARENA_PEAK,       "arena_peak_bytes",           "Largest reply arena used in one tick")
+
+#define IRC_HISTOGRAMS(X) \
+    X(TICK_NS,          "tick_ns",                    "Event-loop work per tick, wait excluded") \
+    X(READ_BYTES,       "read_bytes",                 "Bytes per recv() (or reactor DATA message)") \
+    X(WRITE_BYTES,      "write_bytes",                "Bytes per send() (or reactor hand-off)")
+
+/**
+ * @brief Log-linear histogram of unsigned values (ns, bytes).
+ *
+ * A plain aggregate: a zero-initialized object is empty, so it can sit in
+ * static tables.
+ */
+struct Histogram {
+    enum {
+        SUB_BITS = 3,
+        SUB      = 1 << SUB_BITS,
+        MAX_BITS = 40,                                ///< values >= 2^40 share the last bucket
+        BUCKETS  = (MAX_BITS - SUB_BITS + 1) * SUB
+    };
+    unsigned long count;
+    unsigned long sum;
+    unsigned long max;
+    unsigned long bucket[BUCKETS];
+
+    void record(unsigned long v) {
+        ++count;
+        sum += v;
+        if (v > max) max = v;
+        ++bucket[index(v)];
+    }
+
+    static unsigned index(unsigned long v) {
+        if (v < SUB) return (unsigned)v;
+        unsigned e = (unsigned)(sizeof(unsigned long) * 8 - 1) - (unsigned)__builtin_clzl(v);
+        if (e >= MAX_BITS) return BUCKETS - 1;
+        return (e - SUB_BITS + 1) * SUB + (unsigned)((v >> (e - SUB_BITS)) & (SUB - 1));
+    }
+    /** @return Largest value that lands in bucket i. */
+    static unsigned long upperBound(unsigned i);
+    /** @return Upper bound of the bucket holding quantile q (0..1), capped at max. */
+    unsigned long quantile(double q) const;
+};
+
+class Metrics {
+public:
+#define IRC_METRIC_ENUM(id, name, help) id,
+    enum Counter { IRC_COUNTERS(IRC_METRIC_ENUM) COUNTER_COUNT };
+    enum Gauge { IRC_GAUGES(IRC_METRIC_ENUM) GAUGE_COUNT };
+    enum Hist { IRC_HISTOGRAMS(IRC_METRIC_ENUM) HIST_COUNT };
+#undef IRC_METRIC_ENUM
+
+    Metrics();
+
+    void add(Counter c, unsigned long n = 1) { _counter[c] += n; }
+    void set(Gauge g, unsigned long v) { _gauge[g] = v; }
+    void record(Hist h, unsigned long v) { _hist[h].record(v); }
+
+    unsigned long counter(Counter c) const { return _counter[c]; }
+    unsigned long gauge(Gauge g) const { return _gauge[g]; }
+    const Histogram& histogram(Hist h) const { return _hist[h]; }
+
+    static const char* name(Counter c);
+    static const char* name(Gauge g);
+    static const char* name(Hist h);
+
+    /** @brief Append every counter, gauge and histogram as exposition text. */
+    void write(std::ostream& os) const;
+
+    /** @brief "# HELP"/"# TYPE" header for a metric family. */
+    static void writeHeader(std::ostream& os, const char* name, const char* help, const char* type);
+    /**
+     * @brief One histogram's cumulative buckets (non-empty ones and +Inf),
+     *        _sum and _count. labels is empty or e.g. "cmd=\"JOIN\"".
+     */
+    static void writeHistogram(std::ostream& os, const char* name, const std::string& labels,
+                               const Histogram& h);
+
+private:
+    unsigned long _counter[COUNTER_COUNT];
+    unsigned long _gauge[GAUGE_COUNT];
+    Histogram     _hist[HIST_COUNT];
+
+    Metrics(const Metrics&);
+    Metrics& operator=(const Metrics&);
+};
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef NUMERICS_HPP
+#define NUMERICS_HPP
+
+/**
+ * @file Numerics.hpp
+ * @brief Compile-time table of numeric replies and their formatter.
+ *
+ * Each numeric is declared once below with its code and the text that
+ * follows the target nick; "%s" marks where the next argument goes. A
+ * reply is the client's cached stem (":server 000 nick ", see
+ * Client::replyStem()) with the code patched in, followed by the format
+ * expanded into a fixed 512-byte buffer: one bounded write, queued with a
+ * single copy, no heap work. Text past the RFC 1459 line limit is cut so
+ * the line still ends in CRLF.
+ *
+ * Replies whose length depends on the channel (353 NAMES) are built with
+ * MsgBuilder after Server::numericStem() instead.
+ */
+
+#include "Utils.hpp"
+
+#include <string>
+#include <cstddef>
+
+//  X(identifier,           code,  text after the target)
+#define IRC_NUMERICS(X) \
+    X(RPL_WELCOME,          "001", ":Welcome to ft_irc %s") \
+    X(RPL_STATSCOMMANDS,    "212", "%s %s %s %s") \
+    X(RPL_ENDOFSTATS,       "219", "%s :End of STATS report") \
+    X(RPL_STATSDEBUG,       "249", ":%s") \
+    X(RPL_CHANNELMODEIS,    "324", "%s %s") \
+    X(RPL_NOTOPIC,          "331", "%s :No topic is set") \
+    X(RPL_TOPIC,            "332", "%s :%s") \
+    X(RPL_INVITING,         "341", "%s %s") \
+    X(RPL_NAMREPLY,         "353", "= %s :%s") \
+    X(RPL_ENDOFNAMES,       "366", "%s :End of /NAMES list.") \
+    X(ERR_FILETRANSFER,     "400", "%s :%s") \
+    X(ERR_NOSUCHNICK,       "401", "%s :No such nick") \
+    X(ERR_NOSUCHCHANNEL,    "403", "%s :No such channel") \
+    X(ERR_INVALIDCAPCMD,    "410", "%s :Invalid CAP command") \
+    X(ERR_NOORIGIN,         "409", ":No origin specified") \
+    X(ERR_NORECIPIENT,      "411", ":No recipient given (%s)") \
+    X(ERR_NOTEXTTOSEND,     "412", ":No text to send") \
+    X(ERR_UNKNOWNCOMMAND,   "421", "%s :Unknown command") \
+    X(ERR_NONICKNAMEGIVEN,  "431", ":No nickname given") \
+    X(ERR_ERRONEUSNICKNAME, "432", "%s :Erroneous nickname") \
+    X(ERR_NICKNAMEINUSE,    "433", "%s :Nickname is already in use") \
+    X(ERR_USERNOTINCHANNEL, "441", "%s %s :They aren't on that channel") \
+    X(ERR_NOTONCHANNEL,     "442", "%s :You're not on that channel") \
+    X(ERR_NOTREGISTERED,    "451", "%s :You have not registered") \
+    X(ERR_NEEDMOREPARAMS,   "461", "%s :Not enough parameters") \
+    X(ERR_ALREADYREGISTRED, "462", ":You may not reregister") \
+    X(ERR_PASSWDMISMATCH,   "464", ":Password incorrect") \
+    X(ERR_CHANNELISFULL,    "471", "%s :Cannot join channel (+l)") \
+    X(ERR_INVITEONLYCHAN,   "473", "%s :Cannot join channel (+i)") \
+    X(ERR_BADCHANNELKEY,    "475", "%s :Cannot join channel (+k)") \
+    X(ERR_CHANOPRIVSNEEDED, "482", "%s :You're not channel operator") \
+    X(RPL_FILEOFFER,        "738", "%s %s :%s") \
+    X(RPL_FILEOFFERED,      "739", "%s %s %s :%s") \
+    X(RPL_FILEDONE,         "741", "%s :FILE DONE") \
+    X(RPL_FILEACCEPTED,     "742", "%s :ACCEPTED") \
+    X(RPL_FILECANCELLED,    "743", "%s :%s")
+
+enum Numeric {
+#define IRC_NUMERIC_ENUM(id, code, fmt) id,
+    IRC_NUMERICS(IRC_NUMERIC_ENUM)
+#undef IRC_NUMERIC_ENUM
+    NUMERIC_COUNT
+};
+
+struct NumericDef {
+    char        code[4];
+    const char* fmt;
+};
+
+/** @brief Indexed by Numeric. */
+extern const NumericDef NUMERICS[NUMERIC_COUNT];
+
+/**
+ * @brief One "%s" argument: a string, a view, or a number rendered in place.
+ *
+ * Strings are referenced, not copied: an argument lives as long as the
+ * full expression that creates it.
+ */
+class ReplyArg {
+    StrView _v;
+    char    _num[24];
+
+    void setNumber(unsigned long v, bool neg);
+    ReplyArg& operator=(const ReplyArg&);
+public:
+    ReplyArg() {}
+    ReplyArg(const ReplyArg& o);
+    ReplyArg(const std::string& s): _v(s.data(), s.size()) {}
+    ReplyArg(const char* s);
+    ReplyArg(const StrView& v): _v(v) {}
+    ReplyArg(int v) { setNumber(v < 0 ? 0UL - (unsigned long)v : (unsigned long)v, v < 0); }
+    ReplyArg(long v) { setNumber(v < 0 ? 0UL - (unsigned long)v : (unsigned long)v, v < 0); }
+    ReplyArg(unsigned long v) { setNumber(v, false); }
+
+    const StrView& view() const { return _v; }
+};
+
+enum { MAX_REPLY_LINE = 512, MAX_REPLY_ARGS = 4 };
+
+/**
+ * @brief Expand a numeric into out (MAX_REPLY_LINE bytes), CRLF included.
+ * @param stem   ":server 000 target " (the code digits are overwritten).
+ * @param codeAt Offset of the code digits in stem (the prefix length).
+ * @param args   nargs arguments, consumed in order by "%s".
+ * @return Bytes written.
+ */
+size_t formatNumeric(char* out, const StrView& stem, size_t codeAt, Numeric id,
+                     const ReplyArg* const* args, int nargs);
+
+#endif
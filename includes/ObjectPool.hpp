@@ -0,0 +1,96 @@
+#ifndef OBJECT_POOL_HPP
+#define OBJECT_POOL_HPP
+
+/**
+ * @file ObjectPool.hpp
+ * @brief Free-list pool of long-lived server objects (Client, Channel, ...).
+ *
+ * Released objects are not destroyed: release() calls T::recycle(), which
+ * drops the object's state but keeps its buffers' capacity (strings,
+ * vectors, queues), and parks it on a free list. acquire() hands the most
+ * recently released object back first, while it is still warm in cache.
+ * Under connection churn (monitoring probes, reconnect storms) a steady
+ * state is reached where accept/close does no allocator work at all.
+ *
+ * At most keep() idle objects are retained; beyond that released objects
+ * are deleted, so a one-off spike does not pin its memory forever.
+ *
+ * T needs a default constructor and a recycle() member.
+ */
+
+#include <vector>
+#include <cstddef>
+
+/** @brief Counters reported by STATS p. */
+struct PoolStats {
+    const char*   name;
+    size_t        live;   ///< objects handed out and not yet released
+    size_t        peak;   ///< high-water mark of live
+    size_t        idle;   ///< objects parked on the free list
+    unsigned long hits;   ///< acquire() served from the free list
+    unsigned long misses; ///< acquire() that had to allocate
+};
+
+template <class T>
+class ObjectPool {
+    std::vector<T*> _free;
+    size_t          _keep;
+    PoolStats       _st;
+
+    ObjectPool(const ObjectPool&);
+    ObjectPool& operator=(const ObjectPool&);
+public:
+    explicit ObjectPool(const char* name, size_t keep = 1024): _keep(keep) {
+        _st.name = name;
+        _st.live = _st.peak = _st.idle = 0;
+        _st.hits = _st.misses = 0;
+    }
+    /** @brief Frees idle objects; live ones belong to their holders. */
+    ~ObjectPool() { trim(0); }
+
+    /** @return A recycled object, or a new default-constructed one. */
+    T* acquire() {
+        T* p;
+        if (_free.empty()) {
+            p = new T();
+            ++_st.misses;
+        } else {
+            p = _free.back();
+            _free.pop_back();
+            ++_st.hits;
+        }
+        if (++_st.live > _st.peak) _st.peak = _st.live;
+        _st.idle = _free.size();
+        return p;
+    }
+
+    /** @brief Return p to the pool (recycled, or deleted if the pool is full). */
+    void release(T* p) {
+        if (!p) return;
+        --_st.live;
+        if (_free.size() < _keep) {
+            p->recycle();
+            _free.push_back(p);
+        } else {
+            delete p;
+        }
+        _st.idle = _free.size();
+    }
+
+    /** @brief Delete idle objects down to n. */
+    void trim(size_t n) {
+        while (_free.size() > n) {
+            delete _free.back();
+            _free.pop_back();
+        }
+        _st.idle = _free.size();
+    }
+
+    /** @brief Change how many idle objects are kept. */
+    void setKeep(size_t n) { _keep = n; trim(n); }
+    size_t keep() const { return _keep; }
+
+    const PoolStats& stats() const { return _st; }
+};
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef OUT_QUEUE_HPP
+#define OUT_QUEUE_HPP
+
+/**
+ * @file OutQueue.hpp
+ * @brief Per-connection outbound queue of shared, immutable message segments.
+ *
+ * A Segment is an immutable byte string with an intrusive reference count,
+ * allocated in one block (header + bytes). A channel line is built once as
+ * a Segment and the same Segment is queued for every recipient, so a
+ * 2,000-member broadcast costs 2,000 pointer pushes instead of 2,000 copies.
+ *
+ * OutQueue holds SegmentRefs in FIFO order plus a read offset into the
+ * head segment; writeTo() hands up to IOV_BATCH segments to the kernel in a
+ * single sendmsg() call. Reference counts are atomic because queues move
+ * between the core thread and reactor threads (see Reactor.hpp).
+ *
+ * Private lines (numerics, PMs, file relay) are packed into fixed-size
+ * chunks: while the tail segment is an unshared chunk with room left, new
+ * bytes are appended to it instead of allocating. The queue is therefore a
+ * chunked FIFO with a read offset: a partial write advances the offset in
+ * O(1), each writeTo() touches at most IOV_BATCH chunks, and chunks are
+ * freed as soon as they are fully sent.
+ */
+
+#include <string>
+#include <deque>
+#include <cstddef>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+class Segment {
+    int    _refs;
+    size_t _size;
+    size_t _cap;
+
+    Segment(size_t n, size_t cap): _refs(1), _size(n), _cap(cap) {}
+    ~Segment() {}
+    Segment(const Segment&);
+    Segment& operator=(const Segment&);
+public:
+    /** @brief Allocate a segment holding a copy of [p, p+n) (refcount 1). */
+    static Segment* create(const char* p, size_t n);
+    /** @brief Allocate an empty segment with room for cap bytes. */
+    static Segment* createChunk(size_t cap);
+
+    const char* data() const { return reinterpret_cast<const char*>(this + 1); }
+    size_t      size() const { return _size; }
+    size_t      room() const { return _cap - _size; }
+    /** @return true if nobody else holds a reference (safe to append). */
+    bool        unique() const { return __atomic_load_n(&_refs, __ATOMIC_ACQUIRE) == 1; }
+    /** @brief Append into spare capacity. Caller checks unique() and room(). */
+    void        fill(const char* p, size_t n);
+
+    void retain() { __atomic_add_fetch(&_refs, 1, __ATOMIC_RELAXED); }
+    void release();
+};
+
+/** @brief Owning handle to a Segment; copying shares, never copies bytes. */
+class SegmentRef {
+    Segment* _p;
+public:
+    SegmentRef(): _p(0) {}
+    explicit SegmentRef(const std::string& s);
+    /** @brief Adopt a freshly created segment (takes over its reference). */
+    explicit SegmentRef(Segment* adopt): _p(adopt) {}
+    SegmentRef(const SegmentRef& o): _p(o._p) { if (_p) _p->retain(); }
+    ~SegmentRef() { if (_p) _p->release(); }
+    SegmentRef& operator=(const SegmentRef& o) {
+        if (o._p) o._p->retain();
+        if (_p) _p->release();
+        _p = o._p;
+        return *this;
+    }
+    void swap(SegmentRef& o) { Segment* t = _p; _p = o._p; o._p = t; }
+
+    const char* data() const { return _p ? _p->data() : ""; }
+    size_t      size() const { return _p ? _p->size() : 0; }
+    bool        empty() const { return size() == 0; }
+    Segment*    get() const { return _p; }
+};
+
+class OutQueue {
+    std::deque<SegmentRef> _segs;
+    size_t                 _off;      // bytes of _segs.front() already written
+    size_t                 _bytes;    // unsent bytes across all segments
+    bool                   _tailOpen; // _segs.back() is our chunk, appendable
+public:
+    /** Max segments handed to one sendmsg(); well under IOV_MAX. */
+    enum { IOV_BATCH = 64 };
+    /** Allocation size of a private chunk (header included). */
+    enum { CHUNK_BYTES = 4096 };
+
+    OutQueue();
+
+    /** @return true if nothing is waiting to be sent. */
+    bool   empty() const { return _bytes == 0; }
+    /** @return Unsent bytes queued. */
+    size_t bytes() const { return _bytes; }
+
+    /** @brief Queue a shared segment (no byte copy). */
+    void push(const SegmentRef& seg);
+    /** @brief Queue a private copy of s, packed into the open tail chunk. */
+    void append(const std::string& s);
+    /** @brief Queue a private copy of [p, p+n). */
+    void append(const char* p, size_t n);
+    /** @brief Move all of other's segments to our tail; other ends empty. */
+    void splice(OutQueue& other);
+
+    /**
+     * @brief Write as much as the socket accepts with batched sendmsg().
+     * @return Bytes written, or -1 with errno set (EAGAIN when full).
+     */
+    ssize_t writeTo(int fd);
+    /**
+     * @brief Point iov at up to max leading segments, unwritten bytes only.
+     * @return Entries filled; consume() what actually got written.
+     */
+    int gather(struct iovec* iov, int max) const;
+    /** @brief Drop n already-written bytes from the front. */
+    void consume(size_t n);
+
+    void clear();
+    void swap(OutQueue& o);
+};
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef POLLER_HPP
+#define POLLER_HPP
+
+/**
+ * @file Poller.hpp
+ * @brief Readiness-notification backends for the Server event loop.
+ *
+ * A Poller tracks a set of file descriptors with an interest mask and, on
+ * wait(), reports only the descriptors that became ready. The Server talks
+ * to the abstract interface; the concrete backend is picked at startup.
+ *
+ * Backends:
+ * - "poll":     portable poll(2) over a pollfd vector (always available).
+ * - "epoll":    Linux epoll(7), level-triggered.
+ * - "epoll-et": Linux epoll(7), edge-triggered. Callers must drain reads,
+ *               writes and accept() until EAGAIN when this mode is active.
+ *
+ * Event masks use the poll(2) vocabulary (POLLIN, POLLOUT, POLLHUP, POLLERR,
+ * POLLNVAL) for every backend so the Server code stays backend-agnostic.
+ */
+
+#include <string>
+#include <vector>
+#include <poll.h>
+#ifdef __linux__
+# include <sys/epoll.h>
+#endif
+
+/** One ready descriptor as reported by Poller::wait(). */
+struct PollEvent {
+    int   fd;
+    short revents;
+};
+
+class Poller {
+public:
+    virtual ~Poller() {}
+
+    /** @return Short backend name ("poll", "epoll", "epoll-et"). */
+    virtual const char* name() const = 0;
+    /** @return true if readiness is reported only on state transitions. */
+    virtual bool edgeTriggered() const { return false; }
+
+    /** @brief Start watching fd for the given events mask. */
+    virtual void add(int fd, short events) = 0;
+    /** @brief Replace the events mask of an already-watched fd. */
+    virtual void modify(int fd, short events) = 0;
+    /** @brief Stop watching fd. Must be called before the fd is closed. */
+    virtual void remove(int fd) = 0;
+
+    /**
+     * @brief Block until at least one fd is ready or the timeout expires.
+     * @param ready      Output: cleared, then filled with ready descriptors.
+     * @param timeout_ms Milliseconds to wait; -1 blocks indefinitely.
+     * @return Number of ready descriptors, 0 on timeout, -1 on error (errno).
+     */
+    virtual int wait(std::vector<PollEvent>& ready, int timeout_ms) = 0;
+
+    /**
+     * @brief Instantiate a backend by name.
+     * @param kind "poll", "epoll" or "epoll-et"; empty selects the best
+     *             available backend. Unknown or unavailable kinds fall back
+     *             to poll.
+     */
+    static Poller* create(const std::string& kind);
+};
+
+/**
+ * @brief poll(2) backend; the kernel scans the whole pollfd vector on every
+ * wait(). An fd -> pollfd index table makes modify/remove O(1); removal
+ * swaps the last entry into the hole so the vector stays dense.
+ */
+class PollPoller : public Poller {
+    std::vector<struct pollfd> _pfds;
+    std::vector<int>           _index; // fd -> position in _pfds, -1 if absent
+public:
+    PollPoller();
+    virtual const char* name() const;
+    virtual void add(int fd, short events);
+    virtual void modify(int fd, short events);
+    virtual void remove(int fd);
+    virtual int  wait(std::vector<PollEvent>& ready, int timeout_ms);
+};
+
+#ifdef __linux__
+/** @brief epoll(7) backend; wait() cost scales with ready fds only. */
+class EpollPoller : public Poller {
+    int  _epfd;
+    bool _edge;
+    std::vector<struct epoll_event> _evbuf;
+    int  _watched;
+public:
+    explicit EpollPoller(bool edgeTriggered);
+    virtual ~EpollPoller();
+    virtual const char* name() const;
+    virtual bool edgeTriggered() const;
+    virtual void add(int fd, short events);
+    virtual void modify(int fd, short events);
+    virtual void remove(int fd);
+    virtual int  wait(std::vector<PollEvent>& ready, int timeout_ms);
+    /** @return true if epoll_create succeeded. */
+    bool ok() const;
+private:
+    EpollPoller(const EpollPoller&);
+    EpollPoller& operator=(const EpollPoller&);
+};
+#endif
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef REACTOR_HPP
+#define REACTOR_HPP
+
+/**
+ * @file Reactor.hpp
+ * @brief Socket I/O thread used by the multi-reactor server mode.
+ *
+ * In multi-reactor mode (ServerConfig::reactors > 0) the Server's own thread
+ * becomes the "core": it accepts connections and owns all IRC state
+ * (Client, Channel, Bot, FileTransfer) and runs every command. Each Reactor
+ * thread owns a shard of the client sockets and does the syscall-heavy part:
+ * recv(), send(), and readiness polling.
+ *
+ * No state is shared and nothing is locked. Two SPSC mailboxes per reactor
+ * carry all traffic:
+ * - inbox  (core -> reactor): ADOPT a new fd, SEND bytes, CLOSE an fd,
+ *   PAUSE/RESUME reading an fd (SendQ back-pressure).
+ * - outbox (reactor -> core): DATA received bytes, GONE (peer closed/error).
+ *
+ * The one thing the core reads directly is the per-fd count of bytes still
+ * queued in the reactor (queued()), published with atomic stores so the
+ * core's SendQ limits see the whole backlog, not just its own part.
+ *
+ * Every message carries the connection's serial id next to the fd, so a
+ * message about a closed connection can never reach a newer connection that
+ * reused the same fd. Reactors never close a socket on their own: they
+ * report GONE and wait for the core's CLOSE, so the core never sees an fd
+ * reused while it still owns the old Client.
+ *
+ * Ordering: the core executes commands in arrival order and each inbox is
+ * FIFO, so lines from one sender to one channel reach every recipient in
+ * the order they were sent.
+ */
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+#include "Mailbox.hpp"
+#include "Poller.hpp"
+#include "OutQueue.hpp"
+
+/** One unit of work on a reactor mailbox. */
+struct ReactorMsg {
+    enum Op { ADOPT, SEND, CLOSE, PAUSE, RESUME, DATA, GONE };
+    int           op;
+    int           fd;
+    unsigned long id;   // connection serial (Client::connId())
+    std::string   data; // DATA payload (received bytes)
+    OutQueue      out;  // SEND payload (shared segments, no byte copies)
+    ReactorMsg(): op(0), fd(-1), id(0), data(), out() {}
+    ReactorMsg(int o, int f, unsigned long i): op(o), fd(f), id(i), data(), out() {}
+};
+
+class Reactor {
+public:
+    /**
+     * @param index      Shard number (for logs).
+     * @param pollerKind Poller backend name (see Poller::create).
+     * @param coreWake   Core's doorbell, rung after pushing to the outbox.
+     */
+    Reactor(int index, const std::string& pollerKind, Wakeup& coreWake);
+    ~Reactor();
+
+    /** @brief Spawn the thread. @return false if setup failed. */
+    bool start();
+    /** @brief Ask the thread to exit, join it, and close owned sockets. */
+    void stop();
+
+    /** @brief Queue work for this reactor. Core thread only. */
+    void post(const ReactorMsg& m);
+    /** @brief Ring the doorbell if anything was post()ed since the last wake. */
+    void wake();
+    /** @brief Take the next message for the core. Core thread only. */
+    bool receive(ReactorMsg& out);
+
+    /** @return Bytes queued here for fd, not yet written. Any thread. */
+    size_t queued(int fd) const;
+    /** @return Bytes queued across all of this reactor's connections. */
+    size_t queuedTotal() const;
+
+private:
+    struct Conn {
+        unsigned long id;
+        OutQueue      outbuf;
+        bool          pollout; // POLLOUT currently armed
+        bool          paused;  // core asked us to stop reading
+        bool          gone;    // GONE reported, waiting for CLOSE
+        Conn(): id(0), outbuf(), pollout(false), paused(false), gone(false) {}
+    };
+
+    int                 _index;
+    std::string         _pollerKind;
+    Poller*             _poller;
+    Wakeup              _wake;
+    Wakeup&             _coreWake;
+    Mailbox<ReactorMsg> _inbox;
+    Mailbox<ReactorMsg> _outbox;
+    std::vector<Conn*>  _conns; // indexed by fd
+    std::vector<size_t> _queued; // fd -> outbuf bytes; fixed size, atomics
+    size_t              _queuedTotal;
+    pthread_t           _thread;
+    bool                _running;
+    bool                _posted; // core-side: inbox has unsignalled work
+    int                 _stop;
+
+    static void* threadMain(void* self);
+    void loop();
+    void drainInbox();
+    void handleRead(int fd);
+    void handleWrite(int fd);
+    void markGone(int fd);
+    void publishQueued(int fd, size_t bytes);
+    void rearm(int fd, Conn* c);
+    void closeConn(int fd);
+    Conn* conn(int fd) const;
+
+    Reactor(const Reactor&);
+    Reactor& operator=(const Reactor&);
+};
+
+#endif
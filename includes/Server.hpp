@@ -1,6 +1,3 @@
-<<<<<<< Updated upstream
-// ... existing includes ...
-=======
 #ifndef SERVER_HPP
 #define SERVER_HPP
 
@@ -9,29 +6,65 @@
  * @brief Core IRC server event loop and state management.
  *
  * This header declares the Server class, which owns the listening socket,
- * the poll() loop, and all global process state such as connected clients and
+ * the event loop, and all global process state such as connected clients and
  * known channels. It wires together the command handler, bot, and file
  * transfer sub-systems.
  *
  * Design notes:
- * - Single-threaded, non-blocking I/O via poll().
+ * - Single-threaded, non-blocking I/O via a pluggable Poller backend
+ *   (epoll on Linux, poll() everywhere else; see Poller.hpp).
+ * - Optional multi-reactor mode (ServerConfig::reactors > 0): this thread
+ *   stays the only owner of Client/Channel state and runs every command,
+ *   while N Reactor threads own the sockets and do recv()/send(). Bytes
+ *   move over lock-free per-reactor mailboxes; see Reactor.hpp.
  * - Each connected client has an integer file descriptor (fd) that indexes
- *   into _pfds and _clients.
+ *   directly into _clients (a dense ConnTable), so per-message lookups and
+ *   poll mask updates are O(1).
  * - Channels are looked up by a lower-cased key (IRC channels are case-
  *   insensitive in practice; the project normalizes names).
+ * - Output is bounded per client by SendQ classes (ServerConfig::ConnClass)
+ *   and globally by ServerConfig::sendqTotal. A client that falls behind is
+ *   first paused (its input is not read), then loses low-priority lines,
+ *   and finally is disconnected with "Excess SendQ".
+ * - Input is metered by a per-client token bucket (ConnClass::floodRate):
+ *   each command costs tokens, lines over budget wait in the client's
+ *   input buffer, and a backlog past floodBacklog disconnects with
+ *   "Excess Flood".
+ * - Time-driven work (registration timeout, PING keepalive, bot reminders)
+ *   runs off a TimerWheel whose next expiry bounds the poll timeout.
+ * - Client and Channel objects come from ObjectPools, so connection churn
+ *   reuses warm objects and their buffers instead of hitting the allocator.
+ * - Handlers compose replies with MsgBuilder in a per-tick Arena (arena()),
+ *   which run() resets once every tick; see Arena.hpp.
+ * - The accept, read, dispatch and flush paths feed a Metrics registry
+ *   (metrics()), read with STATS c/l or from the admin socket.
  * - The server exposes some containers publicly to keep the project simple;
  *   higher-level helpers wrap common operations for safety and clarity.
  */
 
 #include <string>
->>>>>>> Stashed changes
 #include <map>
 #include <vector>
-#include <poll.h>
-#include <string>
+#include <deque>
 
 #include "Bot.hpp"
 #include "FileTransfer.hpp"
+#include "Poller.hpp"
+#include "ConnTable.hpp"
+#include "Mailbox.hpp"
+#include "Reactor.hpp"
+#include "AtomTable.hpp"
+#include "TimerWheel.hpp"
+#include "Arena.hpp"
+#include "Numerics.hpp"
+#include "ObjectPool.hpp"
+#include "VisitMarks.hpp"
+#include "Metrics.hpp"
+#include "Capture.hpp"
+#include "Transport.hpp"
+#include "Clock.hpp"
+#include "Client.hpp"
+#include "Channel.hpp"
 
 class Client;
 class Channel;
@@ -39,18 +72,123 @@ class CommandHandler;
 class Bot;
 class FileTransfer;
 
+/**
+ * @brief Startup tunables. main() fills these from IRCSERV_* environment
+ * variables so the command line stays "<port> <password>".
+ */
+struct ServerConfig {
+    /** Poller backend: "poll", "epoll", "epoll-et"; empty = best available. */
+    std::string poller;
+    /** Reactor I/O threads; 0 keeps everything on the run() thread. */
+    int         reactors;
+    /** listen(2) backlog; also caps connections queued for admission. */
+    int         backlog;
+    /** Max connections accepted per event-loop tick. */
+    int         acceptBudget;
+    /** Max queued connections turned into Clients (and welcomed) per tick. */
+    int         welcomeBudget;
+
+    /** @brief SendQ and flood limits shared by a class of connections. */
+    struct ConnClass {
+        const char* name;
+        size_t   sendqSoft;    ///< above: stop reading the client's input
+        size_t   sendqDrop;    ///< above: drop low-priority lines (hints, file relay)
+        size_t   sendqHard;    ///< above: disconnect with "Excess SendQ"
+        unsigned floodRate;    ///< input tokens earned per second
+        unsigned floodBurst;   ///< token bucket size
+        size_t   floodBacklog; ///< deferred input bytes before "Excess Flood"
+    };
+    enum { CLASS_UNREGISTERED, CLASS_USER, CLASS_COUNT };
+    /** Per-class limits, indexed by CLASS_*. */
+    ConnClass   classes[CLASS_COUNT];
+    /** Budget for bytes queued across all clients. */
+    size_t      sendqTotal;
+    /** Seconds a connection may take to register; 0 = no limit. */
+    int         regTimeout;
+    /** Idle seconds before the server PINGs a client; 0 = never. */
+    int         pingInterval;
+    /** Seconds to wait for any reply to that PING before disconnecting. */
+    int         pingTimeout;
+    /** Idle Client/Channel objects kept for reuse (per pool). */
+    int         poolKeep;
+    /** Path of a local (AF_UNIX) socket serving the metrics dump; empty = none. */
+    std::string adminSocket;
+    /** Traffic capture log (see Capture.hpp); empty = no capture. */
+    std::string captureFile;
+    /** Client connections (caller-owned, must outlive the Server); null = kernel sockets. */
+    Transport*  transport;
+    /** Time source (caller-owned); null = the process's monotonic clock. */
+    Clock*      clock;
+
+    ServerConfig(): poller(), reactors(0), backlog(128), acceptBudget(64), welcomeBudget(32),
+                    sendqTotal(256UL << 20), regTimeout(60), pingInterval(120), pingTimeout(60),
+                    poolKeep(1024), adminSocket(), captureFile(),
+                    transport(0), clock(0) {
+        ConnClass unreg = { "unregistered", 16UL << 10, 32UL << 10, 64UL << 10, 10, 20, 8UL << 10 };
+        ConnClass user  = { "user", 256UL << 10, 512UL << 10, 1UL << 20, 40, 80, 64UL << 10 };
+        classes[CLASS_UNREGISTERED] = unreg;
+        classes[CLASS_USER] = user;
+    }
+};
+
 class Server {
     int _listen_fd;
-    std::string _password;
-    std::string _servername;
-    std::map<int, Client*> _clients;
-    std::map<std::string, Channel*> _channels;
-    std::vector<struct pollfd> _pfds;
+    int _admin_fd;   // metrics dump listener, -1 if disabled
+    ServerConfig _cfg;
+    Poller* _poller;
+    std::vector<PollEvent> _ready; // step()'s poller results, reused
+    Transport*      _transport;  // _cfg.transport, or _sockets
+    SocketTransport _sockets;
+    Clock*          _clock;      // _cfg.clock, or Clock::system()
+
+    // multi-reactor mode (empty when single-threaded)
+    std::vector<Reactor*> _reactors;
+    Wakeup                _coreWake;   // rung by reactors when their outbox fills
+    std::vector<int>      _flush;      // fds with output to hand to reactors
+    unsigned long         _nextConnId;
+
+    // accept-storm smoothing: accepted sockets wait here to become Clients
+    std::deque<int>       _pending;
+    int                   _acceptLeft; // accept budget left this tick
+    bool                  _acceptMore; // stopped on budget, not EAGAIN
+
+    CommandHandler*       _dispatcher; // read-path handler; scratch is reused
+    TimerWheel            _timers;
+    Arena                 _arena;      // reply scratch, reset every tick
+    ObjectPool<Client>    _clientPool;
+    ObjectPool<Channel>   _channelPool;
+    std::vector<Client*>  _nickOwner;  // nick atom -> client (0 if none)
+    std::vector<Client*>  _byMember;   // member ID -> client (0 if free)
+    std::vector<unsigned> _freeMembers;// released member IDs, reused first
+    VisitMarks            _peerMarks;  // member IDs reached by broadcastPeers()
+
+    // SendQ accounting (see enqueueOk())
+    size_t                _sendqTotal;   // bytes in core-side client queues
+    std::vector<int>      _paused;       // fds whose input is paused
+    std::vector<int>      _throttled;    // fds with lines waiting for tokens
+    enum { RECHECK_POLL_MS = 10 };       // wakeup while either list waits
+    std::vector<int>      _evict;        // fds over their hard limit
+    Metrics               _metrics;
+    Capture               _capture;      // inactive unless captureFile is set
 
-    Bot*          _bot;
-    FileTransfer* _ft;
+    /** @brief An admin socket reader with the rest of its dump to come. */
+    struct AdminConn {
+        int         fd;
+        std::string text;
+        size_t      off;
+        bool        polled;  // waiting for POLLOUT
+        Timer       timer;   // gives up on a reader that stops reading
+    };
+    std::map<int, AdminConn*> _adminConns;
+    enum {
+        ADMIN_MAX_CONNS  = 8,    // more are closed unanswered
+        ADMIN_TIMEOUT_MS = 5000  // whole dump, per connection
+    };
 
 public:
+    /** @brief Delivery priority; LOW lines are the first to go under load. */
+    enum SendPrio { PRIO_LOW, PRIO_NORMAL };
+
     /**
      * @brief Construct and prepare the server instance.
      *
@@ -60,48 +198,105 @@ public:
      * @param port     TCP port string to bind the listening socket on.
      * @param password Server password that clients must PASS before
      *                 completing registration.
+     * @param cfg      Optional tunables (poller backend, ...).
      */
-    Server(const std::string& port, const std::string& password);
+    Server(const std::string& port, const std::string& password,
+           const ServerConfig& cfg = ServerConfig());
     ~Server();
 
-<<<<<<< Updated upstream
-    void run();
-=======
     /**
      * @brief Get the server's advertised name.
      * @return Immutable reference to the server name used in numerics and
      *         prefixed messages.
      */
     const std::string& serverName() const;
->>>>>>> Stashed changes
 
     /**
      * @brief Queue a raw IRC line to a single client.
      *
      * This function appends to the client's outgoing buffer. The actual write
-     * to the socket occurs in handleClientWrite() when poll() reports the fd
-     * is writable.
+     * to the socket occurs in handleClientWrite() when the poller reports the
+     * fd is writable.
      *
      * @param fd  Target client's file descriptor.
      * @param msg Full IRC line including any trailing CRLF (or not; the
      *            sender can omit CRLF and the transport layer will ensure
      *            proper framing). The project tolerates either.
+     * @param prio PRIO_LOW lines are dropped once the client's SendQ passes
+     *             its class's drop threshold.
+     * @return false if the line was not queued (dropped, or the client is
+     *         being disconnected for Excess SendQ).
+     */
+    bool sendToClient(int fd, const std::string& msg, SendPrio prio = PRIO_NORMAL);
+
+    /**
+     * @brief Queue a shared, prebuilt segment to a single client.
+     *
+     * Only a reference is queued; use this when the same bytes go to many
+     * clients (see broadcast()).
+     */
+    bool sendToClient(int fd, const SegmentRef& msg, SendPrio prio = PRIO_NORMAL);
+
+    /** @brief Queue a line composed in the tick arena (see MsgBuilder). */
+    bool sendToClient(int fd, const MsgBuilder& msg, SendPrio prio = PRIO_NORMAL);
+
+    /** @brief Queue [p, p+n) (a complete line) to a single client. */
+    bool sendBytes(int fd, const char* p, size_t n, SendPrio prio = PRIO_NORMAL);
+
+    /**
+     * @brief Send numeric id to a client, addressed to its nick ("*"
+     * before NICK), with arguments substituted per Numerics.hpp.
+     */
+    bool sendReply(const Client& to, Numeric id,
+                   const ReplyArg& a = ReplyArg(), const ReplyArg& b = ReplyArg(),
+                   const ReplyArg& c = ReplyArg(), const ReplyArg& d = ReplyArg());
+    /** @brief Same, addressed to an explicit target instead of the nick. */
+    bool sendReplyTo(int fd, const StrView& target, Numeric id,
+                     const ReplyArg& a = ReplyArg(), const ReplyArg& b = ReplyArg(),
+                     const ReplyArg& c = ReplyArg(), const ReplyArg& d = ReplyArg());
+    /** @brief Start an unbounded numeric (e.g. 353) in m: ":server NNN nick ". */
+    void numericStem(MsgBuilder& m, const Client& to, Numeric id) const;
+
+    /**
+     * @brief Queue a helper NOTICE; dropped first when the client lags,
+     * never sent to clients that enabled ircserv/no-hints.
      */
-    void sendToClient(int fd, const std::string& msg);
+    void sendHint(int fd, const std::string& msg);
+    void sendHint(int fd, const MsgBuilder& msg);
+
+    /** @return Bytes queued for c, including any held by its reactor. */
+    size_t sendqOf(const Client* c) const;
+    /** @return Bytes queued across all clients. */
+    size_t sendqTotal() const;
+    /** @return Low-priority lines dropped so far because of SendQ limits. */
+    unsigned long sendqDropped() const { return _metrics.counter(Metrics::SENDQ_DROPPED); }
 
     /**
      * @brief Broadcast a message to all members of a channel.
      *
-     * @param chan       Channel name (any case). Internally resolved using a
-     *                   lower-cased key.
+     * The line is copied once into a shared Segment that every member's
+     * queue references.
+     *
+     * @param chan       Channel name (any case).
      * @param msg        Full message to deliver (prefix and command already
      *                   prepared by the caller).
      * @param except_fd  A member fd to skip (e.g., echo suppression). Pass -1
      *                   to send to everyone.
      */
     void broadcast(const std::string& chan, const std::string& msg, int except_fd);
-<<<<<<< Updated upstream
-=======
+    /** @brief Same, for an already-resolved channel. */
+    void broadcast(Channel* ch, const std::string& msg, int except_fd);
+    /** @brief Same, for a line composed in the tick arena. */
+    void broadcast(Channel* ch, const MsgBuilder& msg, int except_fd);
+
+    /**
+     * @brief Queue a line once to every client sharing a channel with c.
+     *
+     * For events about c itself (NICK, QUIT): a peer on several of c's
+     * channels gets one copy, not one per shared channel. All recipients
+     * reference the same segment.
+     */
+    void broadcastPeers(const Client& c, const MsgBuilder& msg, int except_fd);
 
     /**
      * @brief Send a server-prefixed line that appears to come from a nick.
@@ -117,28 +312,30 @@ public:
     /**
      * @brief Lookup a channel by name or create it if missing.
      *
-     * The new channel is inserted using a normalized lower-case key and its
+     * The new channel is indexed under its RFC 1459 case-folded name and its
      * original name preserved for display. The bot is notified on creation.
      *
      * @param name Display or input channel name (e.g., "#general").
      * @return Pointer to an existing or newly created Channel.
      */
->>>>>>> Stashed changes
     Channel* getOrCreateChannel(const std::string& name);
 
+    /**
+     * @brief Turn a connected socket into a Client, as admission does for
+     *        accepted ones. The socket must be non-blocking.
+     *
+     * Used by admitPending(); also lets tools and benchmarks attach
+     * socketpair-backed clients to a Server without a listener.
+     */
+    Client*  admit(int fd);
+
     /**
      * @brief Find a channel by name.
      * @param name Case-insensitive channel name.
      * @return Channel* if found; NULL otherwise.
      */
     Channel* findChannel(const std::string& name);
-<<<<<<< Updated upstream
-    Client* findClientByNick(const std::string& nick);
-    const std::string& serverName() const;
-
-    // helper for the Bot to inject server-validated commands (string must end with \r\n)
-    void sendServerAs(const std::string& nickFrom, const std::string& commandLine);
-=======
+    Channel* findChannel(const char* p, size_t n);
 
     /**
      * @brief Find a connected Client by nick.
@@ -146,29 +343,86 @@ public:
      * @return Client* if found; NULL otherwise.
      */
     Client*  findClientByNick(const std::string& nick);
+    Client*  findClientByNick(const char* p, size_t n);
+
+    /**
+     * @brief Change a client's nick and keep the nick index in step.
+     *
+     * All nick changes go through here so findClientByNick() stays O(1).
+     * The caller has already checked the new nick is valid and free.
+     */
+    void     setClientNick(Client& c, const std::string& nick);
 
+    /** @return Channel whose interned name is a, or NULL. */
+    Channel* channelByAtom(Atom a) const;
+
+    /** @return Client holding a channel member ID, or NULL. */
+    Client*  clientByMember(unsigned id) const;
+    /** @brief Channel::NickFn over clientByMember() (ctx is the Server). */
+    static const std::string& memberNick(void* srv, unsigned id);
+
+    /** @return Pool counters for STATS p: Client, then Channel. */
+    const PoolStats& clientPoolStats() const { return _clientPool.stats(); }
+    const PoolStats& channelPoolStats() const { return _channelPool.stats(); }
+
+    /** @brief Timers fired from run(); arm with delays in milliseconds. */
+    TimerWheel& timers() { return _timers; }
+
+    /** @brief Scratch memory for composing replies; freed at end of tick. */
+    Arena& arena() { return _arena; }
+
+    /** @brief Counters, gauges and histograms fed by the I/O paths. */
+    Metrics& metrics() { return _metrics; }
+    const Metrics& metrics() const { return _metrics; }
+    /** @brief Refresh the gauges (clients, channels, SendQ...) from live state. */
+    void sampleGauges();
     /**
-     * @brief Enter the poll()-based event loop.
+     * @brief Write the registry and the per-command handler time
+     *        histograms as Prometheus-style exposition text.
+     */
+    void writeMetrics(std::ostream& os);
+
+    /**
+     * @brief Enter the event loop.
      *
      * This method blocks and continuously:
      * - Accepts new connections
      * - Reads incoming data and parses IRC lines
      * - Dispatches commands to CommandHandler
      * - Writes pending outbound buffers
-     * - Performs periodic housekeeping (e.g., bot reminders)
      */
     void run();
+    /**
+     * @brief One event-loop tick: wait for readiness (at most max_wait_ms,
+     *        -1 = until the next timer), then do everything a tick does.
+     *
+     * run() is step(-1) in a loop. Simulations over a MemoryTransport call
+     * step(0) after feeding input or advancing a SimClock.
+     *
+     * @return false if the poller failed.
+     */
+    bool step(int max_wait_ms);
+    /**
+     * @return true if the server holds no work of its own: nothing waiting
+     *         for admission, for flood tokens or for its SendQ to drain.
+     *         Input still unread in the transport is not counted.
+     */
+    bool idle() const;
+    /** @return The time source (ServerConfig::clock or the system clock). */
+    Clock& clock() { return *_clock; }
 
     // Helpers used by commands / cleanup
     /**
      * @brief Disconnect and remove a client from all server state.
      *
-     * Closes the socket, removes the fd from poll(), leaves channels, and
-     * possibly triggers channel cleanup (see maybeDeleteChannel()).
+     * Broadcasts QUIT to the client's channels, removes the fd from the
+     * poller, closes the socket and frees the Client. Callers that are in the
+     * middle of processing the client must not touch it afterwards.
      *
-     * @param fd Client file descriptor to remove.
+     * @param fd     Client file descriptor to remove.
+     * @param reason QUIT reason shown to channel peers.
      */
-    void removeClient(int fd);
+    void removeClient(int fd, const std::string& reason = "Client disconnected");
 
     // ---- new helpers for features/fixes ----
     /**
@@ -177,6 +431,15 @@ public:
      */
     void maybeDeleteChannel(const std::string& lower_key);
 
+    /**
+     * @brief Clear c's invite to ch, if any, on both sides.
+     *
+     * Keeps Client::invites() equal to the channels where c holds INVITED,
+     * so the atom references taken by INVITE are dropped with the role
+     * (JOIN, PART, KICK, QUIT, channel teardown).
+     */
+    void revokeInvite(Client& c, Channel* ch);
+
     /**
      * @brief Re-grant operator if a channel has no operators left.
      *
@@ -199,46 +462,114 @@ public:
     void onMemberLeftChannel(Channel* ch, const std::string& lower_key, const std::string& nickJustLeft);
 
     // Exposed state for bot/ft (kept simple for this project)
-    /** Map of client fd -> Client*. Owned by Server; cleaned up on remove. */
-    std::map<int, Client*>              _clients;
-    /** Map of lower(channel) -> Channel*. Owned by Server. */
-    std::map<std::string, Channel*>     _channels;
+    /** fd -> Client* slot table. Clients owned by Server; freed on remove. */
+    ConnTable                           _clients;
+    /** Interned names of nicks and channels (see AtomTable.hpp). */
+    AtomTable                           _atoms;
+    /** Channel atom -> Channel* (0 if none). Channels owned by Server. */
+    std::vector<Channel*>               _channels;
     /** Configured server password (required by PASS). */
     std::string                         _password;
     /** Advertised server name used in numerics/prefixes. */
     std::string                         _servername;
+    /** ":" + _servername + " ", the start of every numeric stem. */
+    std::string                         _prefix;
     /** Optional built-in helper bot. Constructed during startup. */
     Bot*                                _bot;
     /** File transfer coordinator for FILE* pseudo-commands. */
     FileTransfer*                       _ft;
->>>>>>> Stashed changes
 
 private:
     /**
-     * @brief Create a non-blocking listening socket and bind to the port.
+     * @brief Open the transport's listening endpoint and watch it.
      * @param port Port string (e.g., "6667").
      */
     void setupSocket(const std::string& port);
 
+    /** @brief Bind the AF_UNIX admin socket at _cfg.adminSocket, if set. */
+    void setupAdminSocket();
+    /**
+     * @brief Accept admin connections and start writing each one the metrics
+     *        dump (rendered once per call). Nothing is read from them.
+     */
+    void serveAdmin();
+    /** @brief Write more of an admin dump; close it when done or failed. */
+    void writeAdmin(AdminConn* a);
+    void closeAdmin(AdminConn* a);
+    /** @brief Admin dump deadline (ctx is the Server, arg the AdminConn). */
+    static void onAdminTimer(void* srv, Timer& t);
+
     /**
-     * @brief Add an fd to the pollfd vector with desired events mask.
+     * @brief Start watching an fd in the poller with the desired events mask.
      */
     void addPollfd(int fd, short events);
 
     /**
      * @brief Change the events mask for an already-tracked fd.
+     *
+     * The last mask is cached per connection, so repeated requests for the
+     * same mask (e.g. POLLOUT on every queued line) cost no syscall.
      */
     void setPollEvents(int fd, short events);
-<<<<<<< Updated upstream
-    void removeClient(int fd);
-=======
 
     /**
-     * @brief Accept a new inbound connection and allocate a Client.
+     * @brief Accept inbound connections into the admission queue.
+     *
+     * Loops until EAGAIN, the per-tick accept budget, or a full queue. In
+     * the last two cases _acceptMore makes the next tick resume without a
+     * new readiness event (needed for edge-triggered pollers).
      */
->>>>>>> Stashed changes
     void handleNewConnection();
 
+    /**
+     * @brief Turn up to welcomeBudget queued sockets into Clients.
+     *
+     * A queued socket is not polled, so its PASS/NICK/USER wait in the
+     * kernel; during a reconnect storm the welcome and registration work is
+     * spread over ticks instead of stalling existing users.
+     */
+    void admitPending();
+
+    /** @return SendQ limits for c's class (by registration state). */
+    const ServerConfig::ConnClass& classOf(const Client* c) const;
+
+    /**
+     * @brief SendQ policy check before queuing n more bytes to c.
+     *
+     * May pause c's input (soft limit), refuse a PRIO_LOW line (drop limit
+     * or global budget exhausted), or schedule c for eviction (hard limit,
+     * or over the global budget while above the soft limit). Eviction is
+     * deferred to evictSlow() so broadcasts never remove a member mid-loop.
+     * @return true if the bytes may be queued.
+     */
+    bool enqueueOk(Client* c, size_t n, SendPrio prio);
+    /** @brief Queue seg to every joined member of ch except except_fd. */
+    void broadcastSegment(Channel* ch, const SegmentRef& seg, int except_fd);
+    /** @brief Queue seg to every peer of c (see broadcastPeers()). */
+    void broadcastPeers(const Client& c, const SegmentRef& seg, int except_fd);
+    /** @brief Queue seg to member m if its SendQ allows. */
+    void deliver(Client* m, const SegmentRef& seg);
+
+    /** @return Read interest for c: POLLIN, or 0 while its input is paused. */
+    short readMask(const Client* c) const;
+    /** @brief Start/stop reading c's socket (and dispatching its lines). */
+    void setReadPaused(Client* c, bool on);
+    /** @brief Resume paused clients whose SendQ fell to half the soft limit. */
+    void resumeReaders();
+    /** @brief Disconnect clients marked by enqueueOk() ("Excess SendQ"). */
+    void evictSlow();
+    /** @brief Give throttled clients another go at their deferred lines. */
+    void runThrottled();
+
+    /** @brief Client liveness timer callback (ctx is the Server). */
+    static void onClientTimer(void* srv, Timer& t);
+    /**
+     * @brief Registration deadline, then idle keepalive: PING after
+     * pingInterval of silence, disconnect if pingTimeout passes without
+     * any line from the client.
+     */
+    void clientTimer(Client* c);
+
     /**
      * @brief Read incoming data, accumulate, and dispatch complete lines.
      * @param fd The client fd ready for reading.
@@ -251,6 +582,27 @@ private:
      */
     void handleClientWrite(int fd);
 
+    /**
+     * @brief Frame complete lines out of the client's input buffer, parse
+     * them in place, and dispatch each one.
+     *
+     * Each line is charged its command's cost against the client's token
+     * bucket; when the bucket runs dry the line is put back and the client
+     * queued for runThrottled(). Input left over past the class's
+     * floodBacklog disconnects the client ("Excess Flood").
+     * @return false if the client was disconnected (c is gone).
+     */
+    bool processInput(int fd, Client* c);
+
+    /** @brief Spawn the reactor threads (multi-reactor mode). */
+    void startReactors();
+    /** @return The reactor that owns this client's socket. */
+    Reactor* reactorFor(const Client* c) const;
+    /** @brief Handle DATA/GONE messages from every reactor. */
+    void drainReactors();
+    /** @brief Hand queued output to reactors and ring their doorbells. */
+    void flushReactors();
+
     /**
      * @brief Close the listening socket and free global resources.
      * Called during orderly shutdown.
@@ -262,3 +614,5 @@ private:
     friend class Bot;
     friend class FileTransfer;
 };
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+/**
+ * @file TimerWheel.hpp
+ * @brief Hierarchical timing wheel driving the event loop's poll timeout.
+ *
+ * Five levels of 64 slots at 1 ms resolution cover 2^30 ms (about 12 days);
+ * longer delays park in the top level and are re-filed when they come up.
+ * A Timer sits in exactly one slot on an intrusive doubly-linked list, so
+ * arm() and cancel() are O(1) and never allocate, whatever the number of
+ * timers. Level N slots are "cascaded" (re-filed one level down) each time
+ * the level below wraps, as in the classic Linux kernel timer design.
+ *
+ * advance() jumps straight over stretches where the lower levels are
+ * empty, so an idle wheel costs O(1) per call rather than one step per
+ * elapsed millisecond. nextTimeout() returns a lower bound on the time to
+ * the next expiry (exact for timers due within 64 ms), suitable as the
+ * poller timeout.
+ *
+ * Timers are owned by the objects they serve (Client, Bot) and cancel
+ * themselves on destruction.
+ */
+
+#include <cstddef>
+
+class TimerWheel;
+
+class Timer {
+public:
+    /** @brief Expiry callback: ctx is the owning subsystem, see arg(). */
+    typedef void (*Fn)(void* ctx, Timer& t);
+
+    Timer();
+    ~Timer();
+
+    /** @brief Set the callback and its opaque arguments. */
+    void set(Fn fn, void* ctx, void* arg);
+    /** @return Object the timer belongs to, as passed to set(). */
+    void* arg() const { return _arg; }
+    /** @return true while armed (not yet fired or cancelled). */
+    bool armed() const { return _prev != 0; }
+    /** @brief Disarm; no-op if not armed. */
+    void cancel();
+
+private:
+    friend class TimerWheel;
+    Fn            _fn;
+    void*         _ctx;
+    void*         _arg;
+    unsigned long _expires; // wheel tick (ms) the timer is due
+    Timer*        _prev;    // slot list links; 0 when not armed
+    Timer*        _next;
+    TimerWheel*   _wheel;
+    int           _level;
+
+    Timer(const Timer&);
+    Timer& operator=(const Timer&);
+};
+
+class TimerWheel {
+public:
+    enum { BITS = 6, SLOTS = 1 << BITS, LEVELS = 5 };
+
+    /** @param nowMs Current time in ms (e.g. monotonicUsec() / 1000). */
+    explicit TimerWheel(unsigned long nowMs);
+    /** @brief Disarms (without firing) any timers still armed. */
+    ~TimerWheel();
+
+    /** @brief (Re-)arm t to fire delayMs after the wheel's current time. */
+    void arm(Timer& t, unsigned long delayMs);
+
+    /** @brief Fire every timer due at or before nowMs. */
+    void advance(unsigned long nowMs);
+
+    /**
+     * @return Milliseconds from nowMs until the wheel next needs advance(),
+     *         0 if overdue, or -1 if no timer is armed.
+     */
+    int nextTimeout(unsigned long nowMs) const;
+
+    /** @return Number of armed timers. */
+    size_t size() const { return _total; }
+    /** @return The wheel's current time (last advance() target), in ms. */
+    unsigned long now() const { return _now; }
+
+private:
+    friend class Timer;
+    Timer         _slots[LEVELS][SLOTS]; // list heads (sentinels)
+    size_t        _count[LEVELS];        // armed timers per level
+    size_t        _total;
+    unsigned long _now;                  // every tick <= _now is processed
+
+    void place(Timer& t);
+    void unlink(Timer& t);
+    void cascade(int level, unsigned idx);
+    void tick(unsigned long t);
+
+    TimerWheel(const TimerWheel&);
+    TimerWheel& operator=(const TimerWheel&);
+};
+
+#endif
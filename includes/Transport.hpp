@@ -0,0 +1,180 @@
+#ifndef TRANSPORT_HPP
+#define TRANSPORT_HPP
+
+/**
+ * @file Transport.hpp
+ * @brief Where the Server's client connections come from and go to.
+ *
+ * Everything the single-threaded Server does with a client connection, it
+ * does through a Transport: listen, accept, recv, a gathered write, close,
+ * plus the Poller that watches those descriptors. Calls keep the syscall
+ * contract (non-blocking, -1 with errno, EAGAIN when there is nothing to
+ * do, recv() returning 0 at end of stream), so the event loop is the same
+ * code whatever is underneath.
+ *
+ * Implementations:
+ * - SocketTransport: kernel TCP sockets; the default.
+ * - MemoryTransport: connections are buffers in this process, driven by a
+ *   simulation through connect()/send()/hangup(). No fds, no syscalls, so
+ *   millions of clients fit in one process and a profile shows only the
+ *   server's own work. Pair it with SimClock (Clock.hpp) and Server::step().
+ *
+ * Reactor threads and the admin socket need kernel sockets; the Server
+ * turns them off over any other transport.
+ */
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "Poller.hpp"
+
+class Transport {
+public:
+    virtual ~Transport() {}
+
+    /** @return Short name for logs ("socket", "memory"). */
+    virtual const char* name() const = 0;
+    /** @return true if descriptors are kernel sockets (reactors, admin socket). */
+    virtual bool kernel() const { return false; }
+
+    /**
+     * @brief Open the listening endpoint.
+     * @return Its descriptor, or -1 after reporting the error.
+     */
+    virtual int listen(const std::string& port, int backlog) = 0;
+    /** @return A new non-blocking connection, or -1 with errno (EAGAIN: none pending). */
+    virtual int accept(int listenFd) = 0;
+    /** @return Bytes read, 0 at end of stream, or -1 with errno (EAGAIN: nothing yet). */
+    virtual ssize_t recv(int fd, char* buf, size_t len) = 0;
+    /** @return Bytes written from iov[0..cnt), or -1 with errno (EAGAIN: full). */
+    virtual ssize_t writev(int fd, const struct iovec* iov, int cnt) = 0;
+    /** @brief Release the descriptor; the peer sees end of stream. */
+    virtual void close(int fd) = 0;
+
+    /** @brief Poller able to watch this transport's descriptors. Caller owns it. */
+    virtual Poller* createPoller(const std::string& kind) = 0;
+};
+
+/** @brief Kernel TCP: getaddrinfo/bind/listen, accept4, recv, sendmsg. */
+class SocketTransport : public Transport {
+public:
+    virtual const char* name() const;
+    virtual bool kernel() const { return true; }
+    virtual int     listen(const std::string& port, int backlog);
+    virtual int     accept(int listenFd);
+    virtual ssize_t recv(int fd, char* buf, size_t len);
+    virtual ssize_t writev(int fd, const struct iovec* iov, int cnt);
+    virtual void    close(int fd);
+    virtual Poller* createPoller(const std::string& kind);
+};
+
+/**
+ * @brief In-process connections for simulations and benchmarks.
+ *
+ * Descriptors are small integers private to this transport. A simulated
+ * client calls connect(), then send()s bytes the server recv()s, and reads
+ * what the server wrote with output()/takeOutput(). Writes never block;
+ * keepOutput(false) makes them count bytes only, for runs too big to keep
+ * every reply.
+ *
+ * A descriptor is recycled once both ends have closed it: the server with
+ * close(), the client with hangup(). Until then the client may still read
+ * its output and closedByServer() tells whether it was disconnected.
+ *
+ * Readiness is level-triggered like poll(): fds with unread input (or end
+ * of stream), POLLOUT interest, or (the listener) pending connections.
+ * MemoryPoller::wait() never blocks; it visits only descriptors touched
+ * since they were last found idle, so its cost follows activity, not the
+ * number of connections.
+ */
+class MemoryTransport : public Transport {
+public:
+    MemoryTransport();
+
+    virtual const char* name() const;
+    virtual int     listen(const std::string& port, int backlog);
+    virtual int     accept(int listenFd);
+    virtual ssize_t recv(int fd, char* buf, size_t len);
+    virtual ssize_t writev(int fd, const struct iovec* iov, int cnt);
+    virtual void    close(int fd);
+    virtual Poller* createPoller(const std::string& kind);
+
+    // --- simulated client side
+
+    /**
+     * @brief Open a connection to the listener; the server accepts it on a
+     *        later tick. @return The connection's descriptor, -1 if nobody listens.
+     */
+    int  connect();
+    /** @brief Client sends bytes (input may be queued before the accept). */
+    void send(int fd, const char* p, size_t n);
+    void send(int fd, const std::string& s) { send(fd, s.data(), s.size()); }
+    /** @brief Client closes: the server reads end of stream after pending input. */
+    void hangup(int fd);
+    /** @return true once the server has closed fd (e.g. after QUIT or an error). */
+    bool closedByServer(int fd) const;
+
+    /** @brief Keep written bytes for output() (default), or only count them. */
+    void keepOutput(bool keep) { _keep = keep; }
+    /** @return What the server wrote to fd since the last takeOutput(). */
+    const std::string& output(int fd) const;
+    /** @brief Move fd's kept output into out, leaving it empty. */
+    void takeOutput(int fd, std::string& out);
+    /** @return Total bytes the server has written to fd. */
+    unsigned long written(int fd) const;
+    /** @return Connections currently open on either end. */
+    size_t connections() const { return _open; }
+    /** @return true when every connection is accepted and all input read. */
+    bool drained() const { return _backlog.empty() && _unread == 0; }
+
+private:
+    struct Conn {
+        std::string   in;       // client -> server, unread from inOff
+        size_t        inOff;
+        std::string   out;      // server -> client, if kept
+        unsigned long written;
+        short         events;   // poller interest
+        bool          used;
+        bool          listener;
+        bool          accepted;
+        bool          serverOpen;
+        bool          clientOpen;
+        bool          marked;   // on _ready
+        Conn();
+    };
+    std::vector<Conn> _conns;
+    std::vector<int>  _free;
+    std::deque<int>   _backlog;   // connected, not yet accepted
+    std::vector<int>  _ready;     // descriptors that may be ready
+    int               _listen;
+    size_t            _open;
+    size_t            _unread;    // input bytes not yet recv()d, all conns
+    bool              _keep;
+
+    bool  valid(int fd) const { return fd >= 0 && (size_t)fd < _conns.size() && _conns[fd].used; }
+    int   alloc();
+    void  release(int fd);
+    void  mark(int fd);
+    short revents(int fd) const;
+
+    friend class MemoryPoller;
+};
+
+/** @brief Poller over a MemoryTransport's descriptors. */
+class MemoryPoller : public Poller {
+    MemoryTransport& _t;
+public:
+    explicit MemoryPoller(MemoryTransport& t): _t(t) {}
+    virtual const char* name() const;
+    virtual void add(int fd, short events);
+    virtual void modify(int fd, short events);
+    virtual void remove(int fd);
+    /** @brief Reports what is ready now; timeout_ms is ignored (never blocks). */
+    virtual int  wait(std::vector<PollEvent>& ready, int timeout_ms);
+};
+
+#endif
@@ -8,14 +8,29 @@
 
 #include <string>
 #include <vector>
+#include <cstddef>
 
 /**
- * @brief ASCII lower-case transformation (locale-independent).
+ * @brief RFC 1459 case folding of one byte: A-Z and the specials []\^
+ * map to a-z and {}|~ (their lower-case forms). Other bytes are unchanged.
+ */
+inline char ircFold(char c) {
+    return (c >= 'A' && c <= '^') ? (char)(c + ('a' - 'A')) : c;
+}
+
+/**
+ * @brief Lower-case transformation under RFC 1459 case mapping
+ * (locale-independent).
  * @param s Input string
- * @return Lower-cased copy of s
+ * @return Folded copy of s
  */
 std::string toLower(const std::string& s);
 
+/** @return Hash of [p, p+n) after ircFold(); equal for equal names. */
+unsigned long ircHash(const char* p, size_t n);
+/** @return true if [p, p+n) and s are the same name under ircFold(). */
+bool ircEqual(const char* p, size_t n, const std::string& s);
+
 /**
  * @brief Split an IRC line into command, parameters and trailing field.
  *
@@ -32,8 +47,51 @@ void splitCmd(const std::string& line,
               std::vector<std::string>& params,
               std::string& trailing);
 
+/** @brief Non-owning view of bytes inside another buffer. */
+struct StrView {
+    const char* p;
+    size_t      n;
+    StrView(): p(""), n(0) {}
+    StrView(const char* ptr, size_t len): p(ptr), n(len) {}
+    bool empty() const { return n == 0; }
+    std::string str() const { return std::string(p, n); }
+};
+
+/**
+ * @brief One parsed IRC line as views into the caller's buffer.
+ *
+ * Holds at most MAX_PARAMS middle parameters (the RFC 1459 limit); extra
+ * tokens are dropped. Views are only valid while the source buffer is.
+ */
+struct IrcLine {
+    enum { MAX_PARAMS = 15 };
+    StrView command;
+    StrView params[MAX_PARAMS];
+    int     nparams;
+    StrView trailing;
+    bool    hasTrailing;
+    IrcLine(): nparams(0), hasTrailing(false) {}
+};
+
+/**
+ * @brief Allocation-free equivalent of splitCmd().
+ *
+ * Same tokenization rules (optional ':' prefix skipped, trailing after the
+ * first " :", whitespace-separated head), but the result points into
+ * [line, line+len) instead of copying.
+ *
+ * @return false if the line has no command token.
+ */
+bool parseIrcLine(const char* line, size_t len, IrcLine& out);
+
+/** @return Microseconds from an arbitrary fixed point (CLOCK_MONOTONIC). */
+unsigned long monotonicUsec();
+/** @return Nanoseconds from the same fixed point. */
+unsigned long monotonicNsec();
+
 /** @return true if name looks like a channel identifier (e.g., starts with '#'). */
 bool isChannelName(const std::string& name);
+bool isChannelName(const StrView& name);
 /** @return true if nick satisfies simplified RFC constraints for this project. */
 bool isNickValid(const std::string& nick);
 
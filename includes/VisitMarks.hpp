@@ -0,0 +1,43 @@
+#ifndef VISIT_MARKS_HPP
+#define VISIT_MARKS_HPP
+
+/**
+ * @file VisitMarks.hpp
+ * @brief "Seen in this pass?" flags over small dense ids, cleared in O(1).
+ *
+ * Each id keeps the number of the last pass that visited it. Starting a
+ * pass bumps the current number, which unmarks every id at once, so a
+ * fan-out over several overlapping channels can skip the members it has
+ * already reached without building a set. Only when the counter wraps is
+ * the array cleared for real.
+ *
+ * Ids are member IDs or atoms: dense, reused, bounded by the connection
+ * and name counts. The array grows to the largest id seen and stays.
+ */
+
+#include <vector>
+#include <algorithm>
+
+class VisitMarks {
+    std::vector<unsigned> _mark; // id -> pass that last visited it
+    unsigned              _pass;
+public:
+    VisitMarks(): _pass(1) {}
+
+    /** @brief Start a new pass: every id is unvisited again. */
+    void next() {
+        if (++_pass != 0) return;
+        std::fill(_mark.begin(), _mark.end(), 0u);
+        _pass = 1;
+    }
+
+    /** @return true the first time id is visited in the current pass. */
+    bool visit(unsigned id) {
+        if (id >= _mark.size()) _mark.resize(id + 1, 0u);
+        if (_mark[id] == _pass) return false;
+        _mark[id] = _pass;
+        return true;
+    }
+};
+
+#endif
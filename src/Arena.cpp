@@ -0,0 +1,105 @@
+#include "Arena.hpp"
+
+#include <cstring>
+
+static size_t roundUp(size_t n) { return (n + 7) & ~static_cast<size_t>(7); }
+
+Arena::Arena(size_t blockSize, size_t keepBlocks)
+: _blockSize(roundUp(blockSize ? blockSize : 1)), _keep(keepBlocks), _cur(0), _off(0),
+  _last(0), _used(0), _peak(0) {}
+
+Arena::~Arena() {
+    reset();
+    for (size_t i = 0; i < _blocks.size(); ++i) delete[] _blocks[i];
+}
+
+char* Arena::newBlock() {
+    _blocks.push_back(new char[_blockSize]);
+    return _blocks.back();
+}
+
+// Oversized requests get a block of their own; otherwise bump through the
+// current block, moving on to the next retained (or a new) one when full.
+char* Arena::alloc(size_t n) {
+    size_t r = roundUp(n ? n : 1);
+    char* p;
+    if (r > _blockSize) {
+        p = new char[r];
+        _large.push_back(p);
+    } else {
+        if (_blocks.empty()) newBlock();
+        if (_off + r > _blockSize) {
+            if (_cur + 1 == _blocks.size()) newBlock();
+            ++_cur;
+            _off = 0;
+        }
+        p = _blocks[_cur] + _off;
+        _off += r;
+    }
+    _used += r;
+    _last = p;
+    return p;
+}
+
+bool Arena::extend(char* p, size_t oldN, size_t newN) {
+    if (!p || p != _last || _blocks.empty()) return false;
+    size_t oldR = roundUp(oldN ? oldN : 1), newR = roundUp(newN);
+    if (p + oldR != _blocks[_cur] + _off) return false; // a large block
+    if (_off - oldR + newR > _blockSize) return false;
+    _off = _off - oldR + newR;
+    _used = _used - oldR + newR;
+    return true;
+}
+
+void Arena::reset() {
+    if (_used > _peak) _peak = _used;
+    for (size_t i = 0; i < _large.size(); ++i) delete[] _large[i];
+    _large.clear();
+    while (_blocks.size() > _keep) {
+        delete[] _blocks.back();
+        _blocks.pop_back();
+    }
+    _cur = _off = _used = 0;
+    _last = 0;
+}
+
+MsgBuilder::MsgBuilder(Arena& a, size_t hint)
+: _a(a), _p(a.alloc(hint ? hint : 1)), _n(0), _cap(hint ? hint : 1) {}
+
+MsgBuilder& MsgBuilder::operator<<(const char* s) {
+    return append(s, std::strlen(s));
+}
+
+// Double until it fits; grow in place while nothing was allocated after us.
+void MsgBuilder::reserve(size_t need) {
+    if (_n + need <= _cap) return;
+    size_t cap = _cap;
+    while (cap < _n + need) cap *= 2;
+    if (!_a.extend(_p, _cap, cap)) {
+        char* q = _a.alloc(cap);
+        std::memcpy(q, _p, _n);
+        _p = q;
+    }
+    _cap = cap;
+}
+
+MsgBuilder& MsgBuilder::append(const char* p, size_t n) {
+    reserve(n);
+    std::memcpy(_p + _n, p, n);
+    _n += n;
+    return *this;
+}
+
+MsgBuilder& MsgBuilder::unsignedNumber(unsigned long v) {
+    char buf[24];
+    char* e = buf + sizeof(buf);
+    char* s = e;
+    do { *--s = (char)('0' + v % 10); v /= 10; } while (v);
+    return append(s, e - s);
+}
+
+MsgBuilder& MsgBuilder::number(long v) {
+    if (v >= 0) return unsignedNumber((unsigned long)v);
+    append("-", 1);
+    return unsignedNumber(0UL - (unsigned long)v);
+}
@@ -0,0 +1,86 @@
+#include "AtomTable.hpp"
+#include "Utils.hpp"
+
+AtomTable::AtomTable(): _atoms(1), _live(0) {
+    _atoms[0].hash = 0;
+    _atoms[0].refs = 0;
+}
+
+// Slot holding the atom for [p, p+n), or the empty slot where it would go.
+size_t AtomTable::probe(const char* p, size_t n, unsigned long h) const {
+    size_t mask = _slots.size() - 1;
+    size_t i = h & mask;
+    while (_slots[i]) {
+        const Entry& e = _atoms[_slots[i]];
+        if (e.hash == h && ircEqual(p, n, e.text)) return i;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// Double the slot array (kept at most half full) and reinsert every atom.
+void AtomTable::grow() {
+    std::vector<Atom> old;
+    old.swap(_slots);
+    _slots.assign(old.empty() ? 64 : old.size() * 2, NO_ATOM);
+    size_t mask = _slots.size() - 1;
+    for (size_t i = 0; i < old.size(); ++i) {
+        if (!old[i]) continue;
+        size_t j = _atoms[old[i]].hash & mask;
+        while (_slots[j]) j = (j + 1) & mask;
+        _slots[j] = old[i];
+    }
+}
+
+Atom AtomTable::intern(const std::string& name) {
+    if ((_live + 1) * 2 > _slots.size()) grow();
+    unsigned long h = ircHash(name.data(), name.size());
+    size_t i = probe(name.data(), name.size(), h);
+    if (_slots[i]) { ++_atoms[_slots[i]].refs; return _slots[i]; }
+
+    Atom a;
+    if (_free.empty()) { a = _atoms.size(); _atoms.push_back(Entry()); }
+    else { a = _free.back(); _free.pop_back(); }
+    Entry& e = _atoms[a];
+    e.text = toLower(name);
+    e.hash = h;
+    e.refs = 1;
+    _slots[i] = a;
+    ++_live;
+    return a;
+}
+
+Atom AtomTable::find(const char* p, size_t n) const {
+    if (_slots.empty()) return NO_ATOM;
+    return _slots[probe(p, n, ircHash(p, n))];
+}
+
+void AtomTable::retain(Atom a) {
+    if (a) ++_atoms[a].refs;
+}
+
+void AtomTable::release(Atom a) {
+    if (!a || --_atoms[a].refs) return;
+    unlink(a);
+    std::string().swap(_atoms[a].text);
+    _free.push_back(a);
+    --_live;
+}
+
+// Remove a from the slot array with backward-shift deletion (no tombstones).
+void AtomTable::unlink(Atom a) {
+    const Entry& e = _atoms[a];
+    size_t mask = _slots.size() - 1;
+    size_t hole = probe(e.text.data(), e.text.size(), e.hash);
+    for (size_t j = (hole + 1) & mask; _slots[j]; j = (j + 1) & mask) {
+        size_t home = _atoms[_slots[j]].hash & mask;
+        // j may move into the hole unless its home lies cyclically in (hole, j]
+        bool stays = (hole <= j) ? (hole < home && home <= j)
+                                 : (hole < home || home <= j);
+        if (stays) continue;
+        _slots[hole] = _slots[j];
+        hole = j;
+    }
+    _slots[hole] = NO_ATOM;
+}
+
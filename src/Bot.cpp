@@ -7,11 +7,12 @@
 #include <cstdlib>
 
 Bot::Bot(Server& s, const std::string& nick)
-: _srv(s), _nick(nick)
+: _srv(s), _nick(nick), _startedAt(s.clock().wall()), _nextPollId(1)
 {
     // add your own nick(s) here to allow privileged bot actions
     _ops_lower.insert("admin");
     _ops_lower.insert("operator");
+    _reminderTimer.set(&Bot::onReminderTimer, this, 0);
 }
 
 const std::string& Bot::nick() const { return _nick; }
@@ -48,11 +49,13 @@ void Bot::onPrivmsg(const Client& from, const std::string& target, const std::st
     std::string lcmd = toLower(cmd);
 
     if (lcmd == "help") {
-        say(where, "!ping | !echo <text> | !topic <text> | !op <nick> | !kick <nick> [reason]");
+        say(where, "!ping | !echo <text> | !remind <1h30m> <text> | !topic <text> | !op <nick> | !kick <nick> [reason]");
     } else if (lcmd == "ping") {
         say(where, "pong");
     } else if (lcmd == "echo") {
         say(where, arg.empty() ? "(nothing to echo)" : arg);
+    } else if (lcmd == "remind") {
+        doRemind(where, from.nick(), arg);
     } else if (lcmd == "topic") {
         if (!isChannel(where)) { say(where, "Use in a channel."); return; }
         if (arg.empty()) { say(where, "Usage: !topic <new topic>"); return; }
@@ -74,3 +77,88 @@ void Bot::onPrivmsg(const Client& from, const std::string& target, const std::st
         else _srv.sendServerAs(from.nick(), "KICK " + where + " " + victim + " :" + reason + "\r\n");
     }
 }
+
+// "2h30m10s", "45m", "10s", "1h"; a bare number means seconds.
+bool Bot::parseDuration(const std::string& s, long& secondsOut) {
+    if (s.empty()) return false;
+    long total = 0, num = 0;
+    bool digits = false;
+    for (size_t i = 0; i < s.size(); ++i) {
+        char c = s[i];
+        if (c >= '0' && c <= '9') {
+            num = num * 10 + (c - '0');
+            if (num > 10000000) return false;
+            digits = true;
+            continue;
+        }
+        if (!digits) return false;
+        if (c == 'd' || c == 'D') total += num * 86400;
+        else if (c == 'h' || c == 'H') total += num * 3600;
+        else if (c == 'm' || c == 'M') total += num * 60;
+        else if (c == 's' || c == 'S') total += num;
+        else return false;
+        num = 0;
+        digits = false;
+    }
+    total += num;
+    if (total <= 0) return false;
+    secondsOut = total;
+    return true;
+}
+
+std::string Bot::formatDuration(long secs) {
+    std::ostringstream os;
+    if (secs >= 86400) { os << secs / 86400 << "d"; secs %= 86400; }
+    if (secs >= 3600) { os << secs / 3600 << "h"; secs %= 3600; }
+    if (secs >= 60) { os << secs / 60 << "m"; secs %= 60; }
+    if (secs || os.str().empty()) os << secs << "s";
+    return os.str();
+}
+
+// !remind <duration> <text>
+void Bot::doRemind(const std::string& where, const std::string& who, const std::string& arg) {
+    static const long MAX_SECS = 7L * 86400;
+    static const size_t MAX_PENDING = 1000;
+    size_t sp = arg.find(' ');
+    long secs = 0;
+    if (sp == std::string::npos || !parseDuration(arg.substr(0, sp), secs) || secs > MAX_SECS) {
+        say(where, "Usage: !remind <duration up to 7d, e.g. 10m or 1h30m> <text>");
+        return;
+    }
+    if (_reminders.size() >= MAX_PENDING) { say(where, who + ": too many pending reminders, try later."); return; }
+    Reminder r;
+    r.where = where;
+    r.who = who;
+    r.text = arg.substr(sp + 1);
+    r.due = _srv.clock().wall() + secs;
+    _reminders.push_back(r);
+    scheduleReminders();
+    say(where, who + ": ok, I'll remind you in " + formatDuration(secs) + ".");
+}
+
+void Bot::onReminderTimer(void* bot, Timer&) {
+    static_cast<Bot*>(bot)->checkReminders();
+}
+
+void Bot::checkReminders() {
+    std::time_t now = _srv.clock().wall();
+    for (size_t i = 0; i < _reminders.size(); ) {
+        if (_reminders[i].due > now) { ++i; continue; }
+        Reminder r = _reminders[i];
+        _reminders.erase(_reminders.begin() + i);
+        say(r.where, r.who + ": reminder: " + r.text);
+    }
+    scheduleReminders();
+}
+
+// One timer for all reminders: the list is short and only changes on
+// !remind or when the earliest one fires.
+void Bot::scheduleReminders() {
+    if (_reminders.empty()) { _reminderTimer.cancel(); return; }
+    std::time_t first = _reminders[0].due;
+    for (size_t i = 1; i < _reminders.size(); ++i)
+        if (_reminders[i].due < first) first = _reminders[i].due;
+    std::time_t now = _srv.clock().wall();
+    unsigned long delay = first > now ? (unsigned long)(first - now) * 1000UL : 0;
+    _srv.timers().arm(_reminderTimer, delay);
+}
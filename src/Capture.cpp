@@ -0,0 +1,164 @@
+#include "Capture.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+static const char MAGIC[] = "IRCCAP1\n";
+
+static size_t putVarint(char* out, unsigned long v) {
+    size_t n = 0;
+    while (v >= 0x80) { out[n++] = (char)(v | 0x80); v >>= 7; }
+    out[n++] = (char)v;
+    return n;
+}
+
+static bool getVarint(const char*& p, const char* end, unsigned long& v) {
+    v = 0;
+    for (unsigned shift = 0; p < end && shift < sizeof(v) * 8; shift += 7) {
+        unsigned char b = (unsigned char)*p++;
+        v |= (unsigned long)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+Capture::Capture()
+: _fd(-1), _running(false), _stop(0), _cur(0), _curSince(0), _last(0), _chunks(0) {}
+
+Capture::~Capture() { stop(); }
+
+bool Capture::start(const std::string& path, unsigned long usec) {
+    if (_fd >= 0) return true;
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) { std::perror(path.c_str()); return false; }
+    if (write(fd, MAGIC, sizeof(MAGIC) - 1) != (ssize_t)(sizeof(MAGIC) - 1) || !_wake.open()) {
+        std::perror(path.c_str());
+        close(fd);
+        return false;
+    }
+    _fd = fd;
+    _stop = 0;
+    _last = usec;
+    if (pthread_create(&_thread, 0, &Capture::threadMain, this) != 0) {
+        std::perror("capture thread");
+        close(_fd);
+        _fd = -1;
+        return false;
+    }
+    _running = true;
+    return true;
+}
+
+// Hand over the tail, let the writer drain everything, then free the chunks.
+void Capture::stop() {
+    if (!_running) return;
+    if (pending()) handOver();
+    __atomic_store_n(&_stop, 1, __ATOMIC_SEQ_CST);
+    _wake.signal();
+    pthread_join(_thread, 0);
+    _running = false;
+    Chunk* c;
+    while (_full.pop(c)) delete c;
+    while (_empty.pop(c)) delete c;
+    delete _cur;
+    _cur = 0;
+    _chunks = 0;
+    close(_fd);
+    _fd = -1;
+}
+
+// Encode in place; a record that finds no room is dropped whole, so the log
+// never holds a partial one and deltas stay relative to the last kept record.
+bool Capture::append(Kind k, unsigned long conn, unsigned long usec, const char* p, size_t n) {
+    if (_fd < 0) return false;
+    char head[1 + 3 * 10];
+    size_t h = 0;
+    head[h++] = (char)k;
+    h += putVarint(head + h, conn);
+    h += putVarint(head + h, usec > _last ? usec - _last : 0);
+    if (k == LINE) h += putVarint(head + h, n);
+    if (h + n > CHUNK_BYTES) return false;
+    if (_cur && _cur->n + h + n > CHUNK_BYTES) handOver();
+    if (!_cur) {
+        if (!_empty.pop(_cur)) {
+            if (_chunks >= MAX_CHUNKS) return false;
+            _cur = new Chunk;
+            ++_chunks;
+        }
+        _cur->n = 0;
+    }
+    if (!_cur->n) _curSince = usec;
+    std::memcpy(_cur->data + _cur->n, head, h);
+    if (n) std::memcpy(_cur->data + _cur->n + h, p, n);
+    _cur->n += h + n;
+    if (usec > _last) _last = usec;
+    return true;
+}
+
+void Capture::handOver() {
+    _full.push(_cur);
+    _cur = 0;
+    _wake.signal();
+}
+
+void Capture::tick(unsigned long usec) {
+    if (pending() && usec - _curSince >= FLUSH_MS * 1000UL) handOver();
+}
+
+void* Capture::threadMain(void* self) {
+    static_cast<Capture*>(self)->writerLoop();
+    return 0;
+}
+
+// After a write error the rest is discarded: the log stays a valid prefix
+// up to the failed chunk.
+void Capture::writerLoop() {
+    struct pollfd pfd;
+    pfd.fd = _wake.fd();
+    pfd.events = POLLIN;
+    bool failed = false;
+    for (;;) {
+        bool stopping = __atomic_load_n(&_stop, __ATOMIC_SEQ_CST) != 0;
+        _wake.drain();
+        Chunk* c;
+        while (_full.pop(c)) {
+            size_t off = 0;
+            while (!failed && off < c->n) {
+                ssize_t w = write(_fd, c->data + off, c->n - off);
+                if (w < 0 && errno == EINTR) continue;
+                if (w <= 0) { std::perror("capture"); failed = true; break; }
+                off += w;
+            }
+            c->n = 0;
+            _empty.push(c);
+        }
+        if (stopping) break;
+        poll(&pfd, 1, -1);
+    }
+}
+
+bool Capture::checkMagic(const char* p, size_t n) {
+    return n >= sizeof(MAGIC) - 1 && std::memcmp(p, MAGIC, sizeof(MAGIC) - 1) == 0;
+}
+
+size_t Capture::magicSize() { return sizeof(MAGIC) - 1; }
+
+int Capture::next(const char*& p, const char* end, Record& r) {
+    if (p >= end) return 0;
+    const char* q = p;
+    int kind = (unsigned char)*q++;
+    unsigned long conn, delta, len = 0;
+    if (kind > CLOSE || !getVarint(q, end, conn) || !getVarint(q, end, delta)) return -1;
+    if (kind == LINE && (!getVarint(q, end, len) || (unsigned long)(end - q) < len)) return -1;
+    r.kind = kind;
+    r.conn = conn;
+    r.usec += delta;
+    r.line = q;
+    r.len = len;
+    p = q + len;
+    return 1;
+}
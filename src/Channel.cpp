@@ -1,65 +1,166 @@
 #include "Channel.hpp"
 
+#include <sstream>
+
 // Construct a channel with the given display name. Modes and limits are
 // initialized to defaults (not invite-only, no topic restriction, unlimited users).
-Channel::Channel(const std::string& name)
-: _name(name), _inviteOnly(false), _topicRestricted(false), _userLimit(-1) {}
+Channel::Channel(const std::string& name, Atom atom) {
+    reset(name, atom);
+}
+
+void Channel::reset(const std::string& name, Atom atom) {
+    recycle();
+    _name = name;
+    _atom = atom;
+}
+
+// Member vectors above this many entries are freed rather than kept.
+static const size_t ENTRIES_KEEP = 1024;
+
+// Defaults for every field live here; the member vector keeps its capacity.
+void Channel::recycle() {
+    _name.clear();
+    _atom = AtomTable::NO_ATOM;
+    _topic.clear();
+    if (_entries.capacity() > ENTRIES_KEEP) std::vector<Member>().swap(_entries);
+    else _entries.clear();
+    _joined = 0;
+    _ops = 0;
+    _inviteOnly = false;
+    _topicRestricted = false;
+    _key.clear();
+    _userLimit = -1;
+    _names.clear();
+    _modes.clear();
+    _namesDirty = _modesDirty = true;
+}
 
 // Return the display name of the channel.
 const std::string& Channel::name() const { return _name; }
+// Return the interned (folded) channel name.
+Atom Channel::atom() const { return _atom; }
 // Return the current topic string.
 const std::string& Channel::topic() const { return _topic; }
 // Set the channel topic.
 void Channel::setTopic(const std::string& t) { _topic = t; }
 
-// True if the given fd is a member of this channel.
-bool Channel::hasMemberFd(int fd) const { return _members.find(fd) != _members.end(); }
-// Add a client fd to the member set.
-void Channel::addMember(int fd) { _members.insert(fd); }
-// Remove a client fd from the member set.
-void Channel::removeMember(int fd) { _members.erase(fd); }
-// Return the set of member fds.
-const std::set<int>& Channel::members() const { return _members; }
-
-// True if the given nick is an operator in this channel.
-bool Channel::isOp(const std::string& nick) const { return _operators.find(nick) != _operators.end(); }
-// Add a nick to the operator set.
-void Channel::addOp(const std::string& nick) { _operators.insert(nick); }
-// Remove a nick from the operator set.
-void Channel::removeOp(const std::string& nick) { _operators.erase(nick); }
-<<<<<<< Updated upstream
-=======
+// Index of the first entry with id >= the given one.
+size_t Channel::lowerBound(unsigned id) const {
+    size_t lo = 0, hi = _entries.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (_entries[mid].id < id) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Binary search for id's entry; NULL if it has none.
+const Channel::Member* Channel::findEntry(unsigned id) const {
+    size_t i = lowerBound(id);
+    return (i < _entries.size() && _entries[i].id == id) ? &_entries[i] : 0;
+}
+
+// Apply a role change and keep the JOINED/OP counters and sort order.
+// An entry whose last role bit is cleared is removed.
+void Channel::setRoles(unsigned id, unsigned char set, unsigned char clear) {
+    size_t lo = lowerBound(id);
+    bool found = lo < _entries.size() && _entries[lo].id == id;
+    if (!found) {
+        if (!set) return;
+        Member m; m.id = id; m.roles = 0;
+        _entries.insert(_entries.begin() + lo, m);
+    }
+    Member& m = _entries[lo];
+    unsigned char before = m.roles;
+    m.roles = (unsigned char)((before | set) & ~clear);
+    if ((before ^ m.roles) & JOINED) { if (m.roles & JOINED) ++_joined; else --_joined; }
+    if ((before ^ m.roles) & OP)     { if (m.roles & OP) ++_ops; else --_ops; }
+    if ((before ^ m.roles) & (JOINED | OP)) _namesDirty = true;
+    if (!m.roles) _entries.erase(_entries.begin() + lo);
+}
+
+// True if id has joined this channel.
+bool Channel::hasMember(unsigned id) const { const Member* m = findEntry(id); return m && (m->roles & JOINED); }
+// Mark id as joined.
+void Channel::addMember(unsigned id) { setRoles(id, JOINED, 0); }
+// Forget id completely: leaving drops ops and any pending invite.
+void Channel::removeMember(unsigned id) { setRoles(id, 0, 0xff); }
+// Number of joined members.
+size_t Channel::memberCount() const { return _joined; }
+// Return the sorted entry list.
+const std::vector<Channel::Member>& Channel::entries() const { return _entries; }
+
+// Rebuilt in place, so the string keeps its capacity across changes.
+const std::string& Channel::names(NickFn nickOf, void* ctx) {
+    if (!_namesDirty) return _names;
+    _names.clear();
+    for (size_t i = 0; i < _entries.size(); ++i) {
+        if (!(_entries[i].roles & JOINED)) continue;
+        if (!_names.empty()) _names += ' ';
+        if (_entries[i].roles & OP) _names += '@';
+        _names += nickOf(ctx, _entries[i].id);
+    }
+    _namesDirty = false;
+    return _names;
+}
+
+void Channel::invalidateNames() { _namesDirty = true; }
+
+const std::string& Channel::modes() {
+    if (!_modesDirty) return _modes;
+    _modes = "+";
+    if (_inviteOnly) _modes += 'i';
+    if (_topicRestricted) _modes += 't';
+    if (!_key.empty()) _modes += 'k';
+    if (_userLimit != -1) _modes += 'l';
+    if (!_key.empty()) { _modes += ' '; _modes += _key; }
+    if (_userLimit != -1) { std::ostringstream os; os << ' ' << _userLimit; _modes += os.str(); }
+    _modesDirty = false;
+    return _modes;
+}
+
+// True if id is an operator in this channel.
+bool Channel::isOp(unsigned id) const { const Member* m = findEntry(id); return m && (m->roles & OP); }
+// Grant or revoke operator status for a joined member.
+void Channel::setOp(unsigned id, bool on) {
+    if (!hasMember(id)) return;
+    if (on) setRoles(id, OP, 0); else setRoles(id, 0, OP);
+}
 // True if any operator exists.
-bool Channel::hasAnyOp() const { return !_operators.empty(); }
->>>>>>> Stashed changes
+bool Channel::hasAnyOp() const { return _ops != 0; }
 
-// Add a nick to the invite list (for +i channels).
-void Channel::invite(const std::string& nick) { _invited.insert(nick); }
-// True if the nick is currently invited.
-bool Channel::isInvited(const std::string& nick) const { return _invited.find(nick) != _invited.end(); }
-// Remove the invite for a nick, returning true if it was present.
-bool Channel::consumeInvite(const std::string& nick) { std::set<std::string>::iterator it = _invited.find(nick); if (it == _invited.end()) return false; _invited.erase(it); return true; }
+// Record an invite for id (for +i channels).
+void Channel::invite(unsigned id) { setRoles(id, INVITED, 0); }
+// True if id currently holds an invite.
+bool Channel::isInvited(unsigned id) const { const Member* m = findEntry(id); return m && (m->roles & INVITED); }
+// Remove the invite for id, returning true if it was present.
+bool Channel::consumeInvite(unsigned id) {
+    if (!isInvited(id)) return false;
+    setRoles(id, 0, INVITED);
+    return true;
+}
 
 // True if invite-only mode (+i) is set.
 bool Channel::inviteOnly() const { return _inviteOnly; }
 // Set or clear invite-only mode (+i).
-void Channel::setInviteOnly(bool b) { _inviteOnly = b; }
+void Channel::setInviteOnly(bool b) { _inviteOnly = b; _modesDirty = true; }
 
 // True if topic is restricted to ops (+t).
 bool Channel::topicRestricted() const { return _topicRestricted; }
 // Set or clear topic restriction (+t).
-void Channel::setTopicRestricted(bool b) { _topicRestricted = b; }
+void Channel::setTopicRestricted(bool b) { _topicRestricted = b; _modesDirty = true; }
 
 // Return the current channel key (+k), or empty if none.
 const std::string& Channel::key() const { return _key; }
 // Set the channel key (+k).
-void Channel::setKey(const std::string& k) { _key = k; }
+void Channel::setKey(const std::string& k) { _key = k; _modesDirty = true; }
 // Remove the channel key (-k).
-void Channel::clearKey() { _key.clear(); }
+void Channel::clearKey() { _key.clear(); _modesDirty = true; }
 
 // Return the user limit (+l), or -1 if unlimited.
 int Channel::userLimit() const { return _userLimit; }
 // Set the user limit (+l).
-void Channel::setUserLimit(int lim) { _userLimit = lim; }
+void Channel::setUserLimit(int lim) { _userLimit = lim; _modesDirty = true; }
 // True if the channel is full (limit reached).
-bool Channel::isFull() const { return _userLimit != -1 && (int)_members.size() >= _userLimit; }
+bool Channel::isFull() const { return _userLimit != -1 && (int)_joined >= _userLimit; }
@@ -1,36 +1,158 @@
 #include "Client.hpp"
 #include "Server.hpp"
 
+// Largest input buffer a recycled client keeps (one flooder's backlog
+// should not be carried into every later connection on this object).
+static const size_t INBUF_KEEP = 16384;
+
 // Construct a client wrapper for an accepted TCP connection. Initially the
 // client is not registered (must PASS, NICK, and USER).
-Client::Client(int fd)
-: _fd(fd), _registered(false), _pass_ok(false) {}
+Client::Client(int fd, unsigned long connId, unsigned memberId) {
+    reset(fd, connId, memberId);
+}
+
+void Client::reset(int fd, unsigned long connId, unsigned memberId) {
+    recycle();
+    _fd = fd;
+    _connId = connId;
+    _memberId = memberId;
+}
+
+// The one place per-connection fields get their initial values.
+void Client::recycle() {
+    _timer.cancel();
+    _fd = -1;
+    _connId = 0;
+    _memberId = 0;
+    _registered = _pass_ok = false;
+    _readPaused = _evicting = _throttled = false;
+    _capHold = false;
+    _caps = 0;
+    _floodTokens = _floodAt = 0;
+    _lastActive = 0;
+    _pingPending = false;
+    _nick.clear();
+    _user.clear();
+    _real.clear();
+    _stem.clear();
+    _nickAtom = AtomTable::NO_ATOM;
+    _inbuf.reset(INBUF_KEEP);
+    _outbuf.clear();
+    _channels.clear();
+    _invites.clear();
+}
 
 Client::~Client() {}
 
 int Client::fd() const { return _fd; }
+unsigned long Client::connId() const { return _connId; }
+unsigned Client::memberId() const { return _memberId; }
 const std::string& Client::nick() const { return _nick; }
+Atom Client::nickAtom() const { return _nickAtom; }
 const std::string& Client::user() const { return _user; }
 const std::string& Client::real() const { return _real; }
 bool Client::isRegistered() const { return _registered; }
 bool Client::passOk() const { return _pass_ok; }
 
 void Client::setPassOk(bool v) { _pass_ok = v; }
-void Client::setNick(const std::string& n) { _nick = n; }
+void Client::setNick(const std::string& n, Atom atom) { _nick = n; _nickAtom = atom; }
+void Client::setReplyStem(const std::string& serverPrefix) {
+    _stem.assign(serverPrefix);
+    _stem += "000 ";
+    if (_nick.empty()) _stem += '*';
+    else _stem += _nick;
+    _stem += ' ';
+}
+const std::string& Client::replyStem() const { return _stem; }
 void Client::setUser(const std::string& u, const std::string& r) { _user = u; _real = r; }
-std::string& Client::inbuf() { return _inbuf; }
-std::string& Client::outbuf() { return _outbuf; }
+LineBuffer& Client::inbuf() { return _inbuf; }
+OutQueue& Client::outbuf() { return _outbuf; }
+size_t Client::sendqBytes() const { return _outbuf.bytes(); }
 
-const std::set<std::string>& Client::channels() const { return _channels; }
-void Client::joinChannel(const std::string& name) { _channels.insert(name); }
-void Client::leaveChannel(const std::string& name) { _channels.erase(name); }
+bool Client::readPaused() const { return _readPaused; }
+void Client::setReadPaused(bool v) { _readPaused = v; }
+bool Client::evicting() const { return _evicting; }
+void Client::setEvicting() { _evicting = true; }
+void Client::touch(unsigned long nowMs) { _lastActive = nowMs; _pingPending = false; }
+unsigned long Client::lastActive() const { return _lastActive; }
+bool Client::pingPending() const { return _pingPending; }
+void Client::setPingPending(bool v) { _pingPending = v; }
+Timer& Client::timer() { return _timer; }
+
+bool Client::hasCap(unsigned cap) const { return (_caps & cap) != 0; }
+unsigned Client::caps() const { return _caps; }
+void Client::setCaps(unsigned caps) { _caps = caps; }
+void Client::setCapHold(bool v) { _capHold = v; }
+bool Client::throttled() const { return _throttled; }
+void Client::setThrottled(bool v) { _throttled = v; }
+
+// Refill in whole milliseconds and advance _floodAt by exactly the time
+// credited, so frequent calls do not lose the fractional remainder. Whether
+// the bucket fills is decided before multiplying: ms * rate can overflow
+// with large limits or after a long idle.
+bool Client::takeTokens(unsigned cost, unsigned long now, unsigned rate, unsigned burst) {
+    unsigned long cap = (unsigned long)burst * 1000;
+    unsigned long ms = (now - _floodAt) / 1000;
+    if (ms && (_floodTokens >= cap || ms >= (cap - _floodTokens + rate - 1) / rate)) {
+        _floodTokens = cap;
+        _floodAt = now;
+    } else if (ms) {
+        _floodTokens += ms * rate;
+        _floodAt += ms * 1000;
+    }
+    unsigned long need = (unsigned long)cost * 1000;
+    if (need > cap) need = cap; // a cost above the burst would never pass
+    if (_floodTokens < need) return false;
+    _floodTokens -= need;
+    return true;
+}
+
+void Client::refillTokens(unsigned long now, unsigned burst) {
+    _floodTokens = (unsigned long)burst * 1000;
+    _floodAt = now;
+}
+
+const std::vector<Atom>& Client::channels() const { return _channels; }
+
+void Client::joinChannel(Atom chan) {
+    for (size_t i = 0; i < _channels.size(); ++i) if (_channels[i] == chan) return;
+    _channels.push_back(chan);
+}
+
+void Client::leaveChannel(Atom chan) {
+    for (size_t i = 0; i < _channels.size(); ++i) {
+        if (_channels[i] != chan) continue;
+        _channels[i] = _channels.back();
+        _channels.pop_back();
+        return;
+    }
+}
+
+const std::vector<Atom>& Client::invites() const { return _invites; }
+
+bool Client::noteInvite(Atom chan) {
+    for (size_t i = 0; i < _invites.size(); ++i) if (_invites[i] == chan) return false;
+    _invites.push_back(chan);
+    return true;
+}
+
+bool Client::dropInvite(Atom chan) {
+    for (size_t i = 0; i < _invites.size(); ++i) {
+        if (_invites[i] != chan) continue;
+        _invites[i] = _invites.back();
+        _invites.pop_back();
+        return true;
+    }
+    return false;
+}
 
 // Attempt to complete registration and send welcome numerics if PASS, NICK,
 // and USER were all provided. This is called after any relevant update.
 void Client::tryRegister(Server& s) {
-    if (!_registered && _pass_ok && !_nick.empty() && !_user.empty()) {
+    if (!_registered && !_capHold && _pass_ok && !_nick.empty() && !_user.empty()) {
         _registered = true;
-        s.sendToClient(_fd, ":ircserv 001 " + _nick + " :Welcome to ft_irc " + _nick + "\r\n");
-        s.sendToClient(_fd, ":ircserv NOTICE " + _nick + " :You're registered! Try: JOIN #room\r\n");
+        refillTokens(s.clock().usec(), s.classOf(this).floodBurst); // the user class starts full
+        s.sendReply(*this, RPL_WELCOME, _nick);
+        s.sendHint(_fd, ":ircserv NOTICE " + _nick + " :You're registered! Try: JOIN #room\r\n");
     }
 }
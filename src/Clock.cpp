@@ -0,0 +1,13 @@
+#include "Clock.hpp"
+#include "Utils.hpp"
+
+class SystemClock : public Clock {
+public:
+    virtual unsigned long usec() { return monotonicUsec(); }
+    virtual std::time_t wall() { return std::time(0); }
+};
+
+Clock& Clock::system() {
+    static SystemClock c;
+    return c;
+}
@@ -3,243 +3,444 @@
 #include "Client.hpp"
 #include "Channel.hpp"
 #include "Utils.hpp"
+#include "Arena.hpp"
 
-#include <sstream>
 #include <cstdlib>
-#include <unistd.h>
+#include <cctype>
 
-void CommandHandler::sendNumeric(Client& c, const std::string& code, const std::string& msg) {
-    std::string nick = c.nick().empty() ? "*" : c.nick();
-    _srv.sendToClient(c.fd(), ":" + _srv.serverName() + " " + code + " " + nick + " " + msg + "\r\n");
+// Numerics go through Server::sendReply() (see Numerics.hpp); other lines
+// are composed in the tick arena (see Arena.hpp), not std::string temporaries.
+static const char* nickOrStar(const Client& c) {
+    return c.nick().empty() ? "*" : c.nick().c_str();
 }
 
 void CommandHandler::handleLine(Client& c, const std::string& line) {
-    std::string cmd, trailing; std::vector<std::string> params;
-    splitCmd(line, cmd, params, trailing);
-    if (cmd.empty()) return;
-    std::string ucmd = toLower(cmd);
-
-    if (ucmd == "pass") cmdPASS(c, params);
-    else if (ucmd == "nick") cmdNICK(c, params);
-    else if (ucmd == "user") cmdUSER(c, params, trailing);
-    else if (ucmd == "ping") cmdPING(c, params);
-    else if (ucmd == "pong") cmdPONG(c, params);
-    else if (ucmd == "privmsg") cmdPRIVMSG(c, params, trailing);
-    else if (ucmd == "join") cmdJOIN(c, params);
-    else if (ucmd == "part") cmdPART(c, params);
-    else if (ucmd == "quit") cmdQUIT(c, params, trailing);
-    else if (ucmd == "topic") cmdTOPIC(c, params, trailing);
-    else if (ucmd == "mode") cmdMODE(c, params);
-    else if (ucmd == "invite") cmdINVITE(c, params);
-    else if (ucmd == "kick") cmdKICK(c, params, trailing);
-    else if (ucmd == "filesend")   cmdFILESEND(c, params, trailing);
-    else if (ucmd == "fileaccept") cmdFILEACCEPT(c, params);
-    else if (ucmd == "filedata")   cmdFILEDATA(c, params);
-    else if (ucmd == "filedone")   cmdFILEDONE(c, params);
-    else if (ucmd == "filecancel") cmdFILECANCEL(c, params);
-    else {
-        _srv.sendToClient(c.fd(), ":" + _srv.serverName() + " 421 * " + cmd + " :Unknown command\r\n");
-        _srv.sendToClient(c.fd(), ":ircserv NOTICE * :Unknown command. Try: HELP (not implemented) or common IRC commands.\r\n");
+    IrcLine msg;
+    if (!parseIrcLine(line.data(), line.size(), msg)) return;
+    handleLine(c, msg);
+}
+
+// Dispatch table, sorted so each first letter is one run for lookup(). minParams counts
+// middle parameters only; commands with their own "missing argument"
+// numeric (NICK 431, PING 409, PRIVMSG 411) keep 0 and check themselves.
+// cost is the flood-control price in tokens: commands that fan out or
+// build large replies cost more; QUIT is free so it is never held back
+// by the bucket (only by lines queued ahead of it).
+struct CommandHandler::Command {
+    CommandStat     stat;
+    unsigned char   len;
+    unsigned char   minParams;
+    bool            needsReg;
+    unsigned char   cost;
+    Handler         fn;
+};
+
+#define IRC_CMD(name, minp, reg, cost) \
+    { { #name, 0, 0, Histogram() }, sizeof(#name) - 1, minp, reg, cost, &CommandHandler::cmd##name }
+
+CommandHandler::Command CommandHandler::_commands[] = {
+    IRC_CMD(CAP,        1, false, 1),
+    IRC_CMD(FILEACCEPT, 1, true,  2),
+    IRC_CMD(FILECANCEL, 1, true,  2),
+    IRC_CMD(FILEDATA,   2, true,  1),
+    IRC_CMD(FILEDONE,   1, true,  2),
+    IRC_CMD(FILESEND,   2, true,  3),
+    IRC_CMD(INVITE,     2, true,  3),
+    IRC_CMD(JOIN,       1, true,  5),
+    IRC_CMD(KICK,       2, true,  3),
+    IRC_CMD(MODE,       1, true,  2),
+    IRC_CMD(NICK,       0, false, 4),
+    IRC_CMD(PART,       1, true,  3),
+    IRC_CMD(PASS,       1, false, 1),
+    IRC_CMD(PING,       0, false, 1),
+    IRC_CMD(PONG,       0, false, 1),
+    IRC_CMD(PRIVMSG,    0, true,  2),
+    IRC_CMD(QUIT,       0, false, 0),
+    IRC_CMD(STATS,      0, true,  5),
+    IRC_CMD(TOPIC,      1, true,  3),
+    IRC_CMD(USER,       3, false, 1),
+};
+
+#undef IRC_CMD
+
+// Unknown commands still cost a 421 reply and a hint.
+static const unsigned UNKNOWN_COST = 2;
+
+size_t CommandHandler::commandCount() { return sizeof(_commands) / sizeof(_commands[0]); }
+
+const CommandStat& CommandHandler::commandStat(size_t i) { return _commands[i].stat; }
+
+unsigned CommandHandler::lineCost(const IrcLine& msg) {
+    Command* cmd = lookup(msg.command.p, msg.command.n);
+    return cmd ? cmd->cost : UNKNOWN_COST;
+}
+
+// Jump to the group for the initial letter, then compare length and bytes
+// (ASCII case-insensitive) within it. No allocation. The groups are found
+// by scanning the sorted table on the first call (the core thread is the
+// only caller), so adding a command needs no other edit.
+CommandHandler::Command* CommandHandler::lookup(const char* p, size_t n) {
+    static size_t begin[26], end[26];
+    static bool indexed = false;
+    if (!indexed) {
+        for (size_t i = 0; i < commandCount(); ++i) {
+            size_t l = _commands[i].stat.name[0] - 'A';
+            if (begin[l] == end[l]) begin[l] = i;
+            end[l] = i + 1;
+        }
+        indexed = true;
+    }
+    if (n == 0) return 0;
+    char first = (char)std::toupper((unsigned char)p[0]);
+    if (first < 'A' || first > 'Z') return 0;
+    for (size_t i = begin[first - 'A']; i < end[first - 'A']; ++i) {
+        Command& cmd = _commands[i];
+        if (cmd.len != n) continue;
+        size_t k = 1;
+        while (k < n && std::toupper((unsigned char)p[k]) == cmd.stat.name[k]) ++k;
+        if (k == n) return &cmd;
+    }
+    return 0;
+}
+
+// Copy the views into the reusable scratch strings. Param slots are parked
+// in _spare rather than destroyed so their buffers survive short lines.
+void CommandHandler::handleLine(Client& c, const IrcLine& msg) {
+    if (msg.command.empty()) return;
+    Command* cmd = lookup(msg.command.p, msg.command.n);
+    if (!cmd) {
+        _srv.sendReplyTo(c.fd(), StrView("*", 1), ERR_UNKNOWNCOMMAND, msg.command);
+        _srv.sendHint(c.fd(), ":ircserv NOTICE * :Unknown command. Try: HELP (not implemented) or common IRC commands.\r\n");
+        return;
+    }
+    if (cmd->needsReg && !requireRegistered(c, cmd->stat.name)) return;
+    if (msg.nparams < cmd->minParams) {
+        _srv.sendReply(c, ERR_NEEDMOREPARAMS, cmd->stat.name);
+        return;
+    }
+
+    while ((int)_params.size() > msg.nparams) {
+        _spare.push_back(std::string());
+        _spare.back().swap(_params.back());
+        _params.pop_back();
+    }
+    while ((int)_params.size() < msg.nparams) {
+        _params.push_back(std::string());
+        if (!_spare.empty()) { _params.back().swap(_spare.back()); _spare.pop_back(); }
     }
+    for (int i = 0; i < msg.nparams; ++i) _params[i].assign(msg.params[i].p, msg.params[i].n);
+    _cmd.assign(msg.command.p, msg.command.n);
+    _trailing.assign(msg.trailing.p, msg.trailing.n);
+
+    const StrView& last = msg.hasTrailing ? msg.trailing
+                        : msg.nparams ? msg.params[msg.nparams - 1] : msg.command;
+    unsigned long t0 = monotonicNsec();
+    (this->*cmd->fn)(c, _params, _trailing);
+    cmd->stat.calls++;
+    cmd->stat.bytes += (last.p + last.n) - msg.command.p;
+    cmd->stat.ns.record(monotonicNsec() - t0);
 }
 
-void CommandHandler::cmdPASS(Client& c, const std::vector<std::string>& p) {
-    if (p.empty()) { sendNumeric(c, "461", "PASS :Not enough parameters"); return; }
-    if (c.isRegistered()) { sendNumeric(c, "462", ":You may not reregister"); return; }
+// Capabilities offered by CAP LS, in the order they are listed.
+static const struct { const char* name; unsigned bit; } CAPS[] = {
+    { "echo-message",     Client::CAP_ECHO_MESSAGE },
+    { "ircserv/no-hints", Client::CAP_NO_HINTS },
+};
+static const size_t CAP_COUNT = sizeof(CAPS) / sizeof(CAPS[0]);
+
+// ASCII case-insensitive compare of s against an upper-case keyword.
+static bool keywordIs(const std::string& s, const char* kw) {
+    size_t i = 0;
+    for (; i < s.size() && kw[i]; ++i)
+        if (std::toupper((unsigned char)s[i]) != kw[i]) return false;
+    return i == s.size() && !kw[i];
+}
+
+// Parse a CAP REQ list ("a -b ..."). All or nothing, as IRCv3 requires:
+// one unknown name and the whole request is refused.
+static bool applyCapReq(const std::string& list, unsigned& caps) {
+    unsigned on = 0, off = 0;
+    size_t b = 0;
+    while (b < list.size()) {
+        size_t e = list.find(' ', b);
+        if (e == std::string::npos) e = list.size();
+        if (e > b) {
+            bool minus = list[b] == '-';
+            size_t s = b + (minus ? 1 : 0);
+            size_t k = 0;
+            while (k < CAP_COUNT && list.compare(s, e - s, CAPS[k].name) != 0) ++k;
+            if (k == CAP_COUNT) return false;
+            (minus ? off : on) |= CAPS[k].bit;
+        }
+        b = e + 1;
+    }
+    caps = (caps | on) & ~off;
+    return true;
+}
+
+// CAP LS / LIST / REQ / END. LS or REQ from an unregistered client holds
+// registration until CAP END, so the caps apply from the welcome onward.
+void CommandHandler::cmdCAP(Client& c, const std::vector<std::string>& p, const std::string& trailing) {
+    const std::string& sub = p[0];
+    MsgBuilder m(_srv.arena());
+    m << ':' << _srv.serverName() << " CAP " << nickOrStar(c) << ' ';
+    if (keywordIs(sub, "LS") || keywordIs(sub, "LIST")) {
+        bool ls = keywordIs(sub, "LS");
+        if (ls && !c.isRegistered()) c.setCapHold(true);
+        m << (ls ? "LS :" : "LIST :");
+        bool first = true;
+        for (size_t k = 0; k < CAP_COUNT; ++k) {
+            if (!ls && !c.hasCap(CAPS[k].bit)) continue;
+            if (!first) m << ' ';
+            m << CAPS[k].name;
+            first = false;
+        }
+    } else if (keywordIs(sub, "REQ")) {
+        const std::string& list = !trailing.empty() ? trailing : p.size() >= 2 ? p[1] : trailing;
+        if (!c.isRegistered()) c.setCapHold(true);
+        unsigned caps = c.caps();
+        bool ok = applyCapReq(list, caps);
+        if (ok) c.setCaps(caps);
+        m << (ok ? "ACK :" : "NAK :") << list;
+    } else if (keywordIs(sub, "END")) {
+        c.setCapHold(false);
+        c.tryRegister(_srv);
+        return;
+    } else {
+        _srv.sendReply(c, ERR_INVALIDCAPCMD, sub);
+        return;
+    }
+    m << "\r\n";
+    _srv.sendToClient(c.fd(), m);
+}
+
+void CommandHandler::cmdPASS(Client& c, const std::vector<std::string>& p, const std::string&) {
+    if (c.isRegistered()) { _srv.sendReply(c, ERR_ALREADYREGISTRED); return; }
     if (p[0] == _srv._password) {
         c.setPassOk(true);
-        _srv.sendToClient(c.fd(), ":ircserv NOTICE " + (c.nick().empty() ? std::string("*") : c.nick()) + " :Password accepted. Now send NICK <nickname> and USER <username> 0 * :<realname>.\r\n");
+        MsgBuilder m(_srv.arena());
+        m << ":ircserv NOTICE " << nickOrStar(c) << " :Password accepted. Now send NICK <nickname> and USER <username> 0 * :<realname>.\r\n";
+        _srv.sendHint(c.fd(), m);
     } else {
-        sendNumeric(c, "464", ":Password incorrect");
-        _srv.sendToClient(c.fd(), ":ircserv NOTICE * :Incorrect password. Try: PASS <password>.\r\n");
+        _srv.sendReply(c, ERR_PASSWDMISMATCH);
+        _srv.sendHint(c.fd(), ":ircserv NOTICE * :Incorrect password. Try: PASS <password>.\r\n");
     }
     c.tryRegister(_srv);
 }
 
-void CommandHandler::cmdNICK(Client& c, const std::vector<std::string>& p) {
-    if (p.empty()) { sendNumeric(c, "431", ":No nickname given"); return; }
+void CommandHandler::cmdNICK(Client& c, const std::vector<std::string>& p, const std::string&) {
+    if (p.empty()) { _srv.sendReply(c, ERR_NONICKNAMEGIVEN); return; }
     std::string newnick = p[0];
-    if (!isNickValid(newnick)) { sendNumeric(c, "432", newnick + " :Erroneous nickname"); return; }
+    if (!isNickValid(newnick)) { _srv.sendReply(c, ERR_ERRONEUSNICKNAME, newnick); return; }
     Client* other = _srv.findClientByNick(newnick);
-    if (other && other->fd() != c.fd()) { sendNumeric(c, "433", newnick + " :Nickname is already in use"); return; }
-
-    std::string old = c.nick();
-    c.setNick(newnick);
-    if (!old.empty()) {
-        for (std::set<std::string>::const_iterator sit = c.channels().begin(); sit != c.channels().end(); ++sit) {
-            _srv.broadcast(*sit, ":" + old + " NICK :" + newnick + "\r\n", c.fd());
-        }
-    }
-    _srv.sendToClient(c.fd(), ":ircserv NOTICE " + c.nick() + " :Your nickname is now '" + c.nick() + "'.\r\n");
+    if (other && other->fd() != c.fd()) { _srv.sendReply(c, ERR_NICKNAMEINUSE, newnick); return; }
+
+    MsgBuilder m(_srv.arena());
+    m << ':' << c.nick() << " NICK :" << newnick << "\r\n";
+    bool renamed = !c.nick().empty();
+    _srv.setClientNick(c, newnick);
+    if (renamed) _srv.broadcastPeers(c, m, c.fd());
+    m.clear();
+    m << ":ircserv NOTICE " << c.nick() << " :Your nickname is now '" << c.nick() << "'.\r\n";
+    _srv.sendHint(c.fd(), m);
     c.tryRegister(_srv);
 }
 
 void CommandHandler::cmdUSER(Client& c, const std::vector<std::string>& p, const std::string& trailing) {
-    if (p.size() < 3) { sendNumeric(c, "461", "USER :Not enough parameters"); return; }
     std::string username = p[0];
     std::string realname = trailing.empty() ? p[2] : trailing;
     c.setUser(username, realname);
-    _srv.sendToClient(c.fd(), ":ircserv NOTICE " + (c.nick().empty() ? std::string("*") : c.nick()) + " :User registered as '" + username + "' (" + realname + ").\r\n");
+    MsgBuilder m(_srv.arena());
+    m << ":ircserv NOTICE " << nickOrStar(c) << " :User registered as '" << username << "' (" << realname << ").\r\n";
+    _srv.sendHint(c.fd(), m);
     c.tryRegister(_srv);
 }
 
-void CommandHandler::cmdPING(Client& c, const std::vector<std::string>& p) {
-    if (p.empty()) { sendNumeric(c, "409", ":No origin specified"); return; }
-    _srv.sendToClient(c.fd(), ":" + _srv.serverName() + " PONG " + _srv.serverName() + " :" + p[0] + "\r\n");
-    _srv.sendToClient(c.fd(), ":ircserv NOTICE " + (c.nick().empty() ? std::string("*") : c.nick()) + " :PONG sent.\r\n");
+void CommandHandler::cmdPING(Client& c, const std::vector<std::string>& p, const std::string&) {
+    if (p.empty()) { _srv.sendReply(c, ERR_NOORIGIN); return; }
+    MsgBuilder m(_srv.arena());
+    m << ':' << _srv.serverName() << " PONG " << _srv.serverName() << " :" << p[0] << "\r\n";
+    _srv.sendToClient(c.fd(), m);
+    if (c.hasCap(Client::CAP_NO_HINTS)) return;
+    m.clear();
+    m << ":ircserv NOTICE " << nickOrStar(c) << " :PONG sent.\r\n";
+    _srv.sendHint(c.fd(), m);
 }
 
-void CommandHandler::cmdPONG(Client&, const std::vector<std::string>&) {
+void CommandHandler::cmdPONG(Client&, const std::vector<std::string>&, const std::string&) {
     // ignore
 }
 
+// Targets are walked in place and both lines are built in the arena: a
+// PRIVMSG does no heap work beyond the channel's shared segment. A target
+// named twice (#a,#A or bob,BOB) resolves to the same atom and is served
+// once; distinct channels keep their own line, as the target differs.
 void CommandHandler::cmdPRIVMSG(Client& c, const std::vector<std::string>& p, const std::string& trailing) {
-    if (!requireRegistered(c, "PRIVMSG")) return;
-    if (p.empty() || (trailing.empty() && p.size() < 2)) { sendNumeric(c, "411", ":No recipient given (PRIVMSG)"); return; }
-    const std::string text = trailing.empty() ? (p.size() >= 2 ? p[1] : "") : trailing;
-    if (text.empty()) { sendNumeric(c, "412", ":No text to send"); return; }
-
-    // split comma-separated targets
-    std::vector<std::string> tgts; { std::string cur; for (size_t i=0;i<p[0].size();++i){ if(p[0][i]==','){ if(!cur.empty()) tgts.push_back(cur); cur.clear(); } else cur+=p[0][i]; } if(!cur.empty()) tgts.push_back(cur); }
-    if (tgts.empty()) { sendNumeric(c, "411", ":No recipient given (PRIVMSG)"); return; }
-
-    for (size_t i = 0; i < tgts.size(); ++i) {
-        const std::string& target = tgts[i];
+    if (p.empty() || (trailing.empty() && p.size() < 2)) { _srv.sendReply(c, ERR_NORECIPIENT, "PRIVMSG"); return; }
+    // every arm is an lvalue, so this binds without a copy
+    const std::string& text = !trailing.empty() ? trailing : p.size() >= 2 ? p[1] : trailing;
+    if (text.empty()) { _srv.sendReply(c, ERR_NOTEXTTOSEND); return; }
+
+    // comma-separated targets
+    const std::string& list = p[0];
+    bool any = false;
+    bool echo = c.hasCap(Client::CAP_ECHO_MESSAGE);
+    bool hints = !c.hasCap(Client::CAP_NO_HINTS);
+    MsgBuilder m(_srv.arena());
+    _targets.next();
+    for (size_t b = 0; b <= list.size(); ) {
+        size_t e = list.find(',', b);
+        if (e == std::string::npos) e = list.size();
+        StrView target(list.data() + b, e - b);
+        b = e + 1;
+        if (target.empty()) continue;
+        any = true;
+        m.clear();
         if (isChannelName(target)) {
-            Channel* ch = _srv.findChannel(target);
-            if (!ch) { sendNumeric(c, "403", target + " :No such channel"); continue; }
-            if (!ch->hasMemberFd(c.fd())) { sendNumeric(c, "442", target + " :You're not on that channel"); continue; }
-            std::string msg = ":" + c.nick() + " PRIVMSG " + target + " :" + text + "\r\n";
-            _srv.broadcast(target, msg, c.fd());
-            _srv.sendToClient(c.fd(), ":ircserv NOTICE " + c.nick() + " :Message sent to " + target + ".\r\n");
+            Channel* ch = _srv.findChannel(target.p, target.n);
+            if (!ch) { _srv.sendReply(c, ERR_NOSUCHCHANNEL, target); continue; }
+            if (!ch->hasMember(c.memberId())) { _srv.sendReply(c, ERR_NOTONCHANNEL, target); continue; }
+            if (!_targets.visit(ch->atom())) continue;
+            m << ':' << c.nick() << " PRIVMSG " << target << " :" << text << "\r\n";
+            _srv.broadcast(ch, m, echo ? -1 : c.fd());
         } else {
-            Client* dst = _srv.findClientByNick(target);
-            if (!dst) { sendNumeric(c, "401", target + " :No such nick"); continue; }
-            _srv.sendToClient(dst->fd(), ":" + c.nick() + " PRIVMSG " + dst->nick() + " :" + text + "\r\n");
-            _srv.sendToClient(c.fd(), ":ircserv NOTICE " + c.nick() + " :Message sent to " + target + ".\r\n");
+            Client* dst = _srv.findClientByNick(target.p, target.n);
+            if (!dst) { _srv.sendReply(c, ERR_NOSUCHNICK, target); continue; }
+            if (!_targets.visit(dst->nickAtom())) continue;
+            m << ':' << c.nick() << " PRIVMSG " << dst->nick() << " :" << text << "\r\n";
+            _srv.sendToClient(dst->fd(), m);
+            if (echo) _srv.sendToClient(c.fd(), m);
         }
+        if (!hints) continue;
+        m.clear();
+        m << ":ircserv NOTICE " << c.nick() << " :Message sent to " << target << ".\r\n";
+        _srv.sendHint(c.fd(), m);
     }
-    if (_srv._bot) {
-    // If you supported multi-targets, loop them; otherwise this is fine:
-    std::string target = p[0];
-    std::string text = trailing.empty() ? (p.size() >= 2 ? p[1] : "") : trailing;
-    _srv._bot->onPrivmsg(c, target, text);
-}
+    if (!any) { _srv.sendReply(c, ERR_NORECIPIENT, "PRIVMSG"); return; }
+    if (_srv._bot) _srv._bot->onPrivmsg(c, list, text);
 }
 
-void CommandHandler::cmdJOIN(Client& c, const std::vector<std::string>& p) {
-    if (!requireRegistered(c, "JOIN")) return;
-
-    if (p.empty()) { sendNumeric(c, "461", "JOIN :Not enough parameters"); return; }
+void CommandHandler::cmdJOIN(Client& c, const std::vector<std::string>& p, const std::string&) {
     std::string chan = p[0];
     std::string key  = (p.size() >= 2 ? p[1] : "");
 
-    if (!isChannelName(chan)) { sendNumeric(c, "403", chan + " :No such channel"); return; }
+    if (!isChannelName(chan)) { _srv.sendReply(c, ERR_NOSUCHCHANNEL, chan); return; }
     Channel* ch = _srv.getOrCreateChannel(chan);
 
-    if (!ch->key().empty() && ch->key() != key) { sendNumeric(c, "475", chan + " :Cannot join channel (+k)"); return; }
-    if (ch->inviteOnly() && !ch->isInvited(c.nick())) { sendNumeric(c, "473", chan + " :Cannot join channel (+i)"); return; }
-    if (ch->isFull()) { sendNumeric(c, "471", chan + " :Cannot join channel (+l)"); return; }
+    if (!ch->key().empty() && ch->key() != key) { _srv.sendReply(c, ERR_BADCHANNELKEY, chan); return; }
+    if (ch->inviteOnly() && !ch->isInvited(c.memberId())) { _srv.sendReply(c, ERR_INVITEONLYCHAN, chan); return; }
+    if (ch->isFull()) { _srv.sendReply(c, ERR_CHANNELISFULL, chan); return; }
 
-    if (ch->isInvited(c.nick())) ch->consumeInvite(c.nick());
+    _srv.revokeInvite(c, ch);
 
-    if (!ch->hasMemberFd(c.fd())) {
-        ch->addMember(c.fd());
-        c.joinChannel(toLower(chan));
-        if (ch->members().size() == 1) ch->addOp(c.nick());
+    if (!ch->hasMember(c.memberId())) {
+        ch->addMember(c.memberId());
+        c.joinChannel(ch->atom());
+        if (ch->memberCount() == 1) ch->setOp(c.memberId(), true);
 
-        std::string joinmsg = ":" + c.nick() + " JOIN " + chan + "\r\n";
-        _srv.broadcast(chan, joinmsg, -1);
-        _srv.sendToClient(c.fd(), joinmsg);
+        MsgBuilder m(_srv.arena());
+        m << ':' << c.nick() << " JOIN " << chan << "\r\n";
+        _srv.broadcast(ch, m, -1);
+        _srv.sendToClient(c.fd(), m);
 
-        if (!ch->topic().empty())
-            _srv.sendToClient(c.fd(), ":" + _srv.serverName() + " 332 " + c.nick() + " " + chan + " :" + ch->topic() + "\r\n");
+        if (!ch->topic().empty()) _srv.sendReply(c, RPL_TOPIC, chan, ch->topic());
 
-        std::string names;
-        const std::set<int>& mem = ch->members();
-        for (std::set<int>::const_iterator it = mem.begin(); it != mem.end(); ++it) {
-            Client* m = _srv._clients[*it];
-            if (names.size()) names += " ";
-            if (ch->isOp(m->nick())) names += "@";
-            names += m->nick();
-        }
-        _srv.sendToClient(c.fd(), ":" + _srv.serverName() + " 353 " + c.nick() + " = " + chan + " :" + names + "\r\n");
-        _srv.sendToClient(c.fd(), ":" + _srv.serverName() + " 366 " + c.nick() + " " + chan + " :End of /NAMES list.\r\n");
+        sendNames(c, ch, chan);
 
-        _srv.sendToClient(c.fd(), ":ircserv NOTICE " + c.nick() + " :Joined " + chan + ". Type: PRIVMSG " + chan + " :hello\r\n");
+        m.clear();
+        m << ":ircserv NOTICE " << c.nick() << " :Joined " << chan << ". Type: PRIVMSG " << chan << " :hello\r\n";
+        _srv.sendHint(c.fd(), m);
     }
 }
 
-void CommandHandler::cmdPART(Client& c, const std::vector<std::string>& p) {
-    if (!requireRegistered(c, "JOIN")) return;
+// The cached names list is cut at spaces into lines that fit 512 bytes
+// after this recipient's ":server 353 nick = #chan :" header.
+void CommandHandler::sendNames(Client& c, Channel* ch, const std::string& chan) {
+    const std::string& names = ch->names(&Server::memberNick, &_srv);
+    MsgBuilder m(_srv.arena());
+    _srv.numericStem(m, c, RPL_NAMREPLY);
+    m << "= " << chan << " :";
+    size_t head = m.size();
+    size_t budget = head + 2 < (size_t)MAX_REPLY_LINE ? MAX_REPLY_LINE - 2 - head : 1;
+    size_t at = 0;
+    do {
+        size_t n = names.size() - at;
+        if (n > budget) {
+            size_t cut = names.rfind(' ', at + budget);
+            if (cut == std::string::npos || cut <= at) cut = names.find(' ', at); // one huge nick
+            n = (cut == std::string::npos ? names.size() : cut) - at;
+        }
+        m.truncate(head);
+        m << StrView(names.data() + at, n) << "\r\n";
+        _srv.sendToClient(c.fd(), m);
+        at += n + 1;
+    } while (at < names.size());
+    _srv.sendReply(c, RPL_ENDOFNAMES, chan);
+}
 
-    if (p.empty()) { sendNumeric(c, "461", "PART :Not enough parameters"); return; }
+void CommandHandler::cmdPART(Client& c, const std::vector<std::string>& p, const std::string&) {
     std::string chan = p[0];
     Channel* ch = _srv.findChannel(chan);
-    if (!ch || !ch->hasMemberFd(c.fd())) { sendNumeric(c, "442", chan + " :You're not on that channel"); return; }
-    ch->removeMember(c.fd());
-    c.leaveChannel(toLower(chan));
-    std::string part = ":" + c.nick() + " PART " + chan + "\r\n";
-    _srv.broadcast(chan, part, -1);
-    _srv.sendToClient(c.fd(), ":ircserv NOTICE " + c.nick() + " :You left " + chan + ".\r\n");
+    if (!ch || !ch->hasMember(c.memberId())) { _srv.sendReply(c, ERR_NOTONCHANNEL, chan); return; }
+    _srv.revokeInvite(c, ch);
+    ch->removeMember(c.memberId());
+    c.leaveChannel(ch->atom());
+    MsgBuilder m(_srv.arena());
+    m << ':' << c.nick() << " PART " << chan << "\r\n";
+    _srv.broadcast(ch, m, -1);
+    m.clear();
+    m << ":ircserv NOTICE " << c.nick() << " :You left " << chan << ".\r\n";
+    _srv.sendHint(c.fd(), m);
+    _srv.onMemberLeftChannel(ch, toLower(chan), c.nick());
 }
 
 void CommandHandler::cmdQUIT(Client& c, const std::vector<std::string>&, const std::string& trailing) {
     std::string reason = trailing.empty() ? "Quit" : trailing;
-    for (std::set<std::string>::const_iterator sit = c.channels().begin(); sit != c.channels().end(); ++sit) {
-        _srv.broadcast(*sit, ":" + c.nick() + " QUIT :" + reason + "\r\n", c.fd());
-    }
-    close(c.fd());
+    // removeClient broadcasts the QUIT and frees c; do not touch it afterwards
+    _srv.removeClient(c.fd(), reason);
 }
 
 void CommandHandler::cmdTOPIC(Client& c, const std::vector<std::string>& p, const std::string& trailing) {
-    if (!requireRegistered(c, "JOIN")) return;
-
-    if (p.empty()) { sendNumeric(c, "461", "TOPIC :Not enough parameters"); return; }
     std::string chan = p[0];
     Channel* ch = _srv.findChannel(chan);
-    if (!ch) { sendNumeric(c, "403", chan + " :No such channel"); return; }
-    if (!ch->hasMemberFd(c.fd())) { sendNumeric(c, "442", chan + " :You're not on that channel"); return; }
+    if (!ch) { _srv.sendReply(c, ERR_NOSUCHCHANNEL, chan); return; }
+    if (!ch->hasMember(c.memberId())) { _srv.sendReply(c, ERR_NOTONCHANNEL, chan); return; }
 
+    MsgBuilder m(_srv.arena());
     if (trailing.empty()) {
         if (ch->topic().empty()) {
-            _srv.sendToClient(c.fd(), ":" + _srv.serverName() + " 331 " + c.nick() + " " + chan + " :No topic is set\r\n");
-            _srv.sendToClient(c.fd(), ":ircserv NOTICE " + c.nick() + " :Use: TOPIC " + chan + " :<new topic>\r\n");
+            _srv.sendReply(c, RPL_NOTOPIC, chan);
+            m << ":ircserv NOTICE " << c.nick() << " :Use: TOPIC " << chan << " :<new topic>\r\n";
+            _srv.sendHint(c.fd(), m);
         } else {
-            _srv.sendToClient(c.fd(), ":" + _srv.serverName() + " 332 " + c.nick() + " " + chan + " :" + ch->topic() + "\r\n");
+            _srv.sendReply(c, RPL_TOPIC, chan, ch->topic());
         }
         return;
     }
-    if (ch->topicRestricted() && !ch->isOp(c.nick())) { sendNumeric(c, "482", chan + " :You're not channel operator"); return; }
+    if (ch->topicRestricted() && !ch->isOp(c.memberId())) { _srv.sendReply(c, ERR_CHANOPRIVSNEEDED, chan); return; }
     ch->setTopic(trailing);
-    std::string msg = ":" + c.nick() + " TOPIC " + chan + " :" + trailing + "\r\n";
-    _srv.broadcast(chan, msg, -1);
-    _srv.sendToClient(c.fd(), ":ircserv NOTICE " + c.nick() + " :Topic for " + chan + " is now: " + trailing + "\r\n");
+    m << ':' << c.nick() << " TOPIC " << chan << " :" << trailing << "\r\n";
+    _srv.broadcast(ch, m, -1);
+    m.clear();
+    m << ":ircserv NOTICE " << c.nick() << " :Topic for " << chan << " is now: " << trailing << "\r\n";
+    _srv.sendHint(c.fd(), m);
 }
 
-void CommandHandler::cmdMODE(Client& c, const std::vector<std::string>& p) {
-    if (!requireRegistered(c, "JOIN")) return;
-
-    if (p.empty()) { sendNumeric(c, "461", "MODE :Not enough parameters"); return; }
+void CommandHandler::cmdMODE(Client& c, const std::vector<std::string>& p, const std::string&) {
     std::string chan = p[0];
     Channel* ch = _srv.findChannel(chan);
-    if (!ch) { sendNumeric(c, "403", chan + " :No such channel"); return; }
-    if (!ch->hasMemberFd(c.fd())) { sendNumeric(c, "442", chan + " :You're not on that channel"); return; }
-
-    // helper to send current modes + args
-    std::string modes = "+";
-    std::string args;
-    if (ch->inviteOnly()) modes += "i";
-    if (ch->topicRestricted()) modes += "t";
-    if (!ch->key().empty()) { modes += "k"; if (!args.empty()) args += " "; args += ch->key(); }
-    if (ch->userLimit() != -1) { modes += "l"; if (!args.empty()) args += " "; std::ostringstream os; os << ch->userLimit(); args += os.str(); }
+    if (!ch) { _srv.sendReply(c, ERR_NOSUCHCHANNEL, chan); return; }
+    if (!ch->hasMember(c.memberId())) { _srv.sendReply(c, ERR_NOTONCHANNEL, chan); return; }
 
     if (p.size() == 1) {
-        _srv.sendToClient(c.fd(), ":" + _srv.serverName() + " 324 " + c.nick() + " " + chan + " " + modes + (args.empty() ? "" : (" " + args)) + "\r\n");
-        _srv.sendToClient(c.fd(), ":ircserv NOTICE " + c.nick() + " :Modes on " + chan + " are " + modes + (args.empty() ? "" : (" " + args)) + " (i=invite-only, t=topic-ops-only, k=key, l=limit).\r\n");
+        const std::string& modes = ch->modes();
+        _srv.sendReply(c, RPL_CHANNELMODEIS, chan, modes);
+        MsgBuilder m(_srv.arena());
+        m << ":ircserv NOTICE " << c.nick() << " :Modes on " << chan << " are " << modes << " (i=invite-only, t=topic-ops-only, k=key, l=limit).\r\n";
+        _srv.sendHint(c.fd(), m);
         return;
     }
-    if (!ch->isOp(c.nick())) { sendNumeric(c, "482", chan + " :You're not channel operator"); return; }
+    if (!ch->isOp(c.memberId())) { _srv.sendReply(c, ERR_CHANOPRIVSNEEDED, chan); return; }
 
     std::string flags = p[1];
     bool adding = true;
@@ -252,148 +453,195 @@ void CommandHandler::cmdMODE(Client& c, const std::vector<std::string>& p) {
         else if (f == 't') ch->setTopicRestricted(adding);
         else if (f == 'k') {
             if (adding) {
-                if (argi >= p.size()) { sendNumeric(c, "461", "MODE :Not enough parameters"); return; }
+                if (argi >= p.size()) { _srv.sendReply(c, ERR_NEEDMOREPARAMS, "MODE"); return; }
                 ch->setKey(p[argi++]);
             } else ch->clearKey();
         } else if (f == 'o') {
-            if (argi >= p.size()) { sendNumeric(c, "461", "MODE :Not enough parameters"); return; }
+            if (argi >= p.size()) { _srv.sendReply(c, ERR_NEEDMOREPARAMS, "MODE"); return; }
             std::string nick = p[argi++];
-            if (adding) ch->addOp(nick);
-            else ch->removeOp(nick);
+            Client* who = _srv.findClientByNick(nick);
+            if (!who || !ch->hasMember(who->memberId())) { _srv.sendReply(c, ERR_USERNOTINCHANNEL, nick, chan); continue; }
+            ch->setOp(who->memberId(), adding);
         } else if (f == 'l') {
             if (adding) {
-                if (argi >= p.size()) { sendNumeric(c, "461", "MODE :Not enough parameters"); return; }
+                if (argi >= p.size()) { _srv.sendReply(c, ERR_NEEDMOREPARAMS, "MODE"); return; }
                 int lim = std::atoi(p[argi++].c_str());
                 if (lim < 0) lim = 0;
                 ch->setUserLimit(lim);
             } else ch->setUserLimit(-1);
         }
     }
-    // rebuild modes + args after change
-    modes = "+";
-    args.clear();
-    if (ch->inviteOnly()) modes += "i";
-    if (ch->topicRestricted()) modes += "t";
-    if (!ch->key().empty()) { modes += "k"; args += ch->key(); }
-    if (ch->userLimit() != -1) {
-        modes += "l";
-        if (!args.empty()) args += " ";
-        std::ostringstream os; os << ch->userLimit();
-        args += os.str();
-    }
-
     // Broadcast and confirm
-    std::string final_modes_line = ":" + c.nick() + " MODE " + chan + " " + modes + (args.empty() ? "" : (" " + args)) + "\r\n";
-    _srv.broadcast(chan, final_modes_line, -1);
-    _srv.sendToClient(c.fd(), ":" + _srv.serverName() + " 324 " + c.nick() + " " + chan + " " + modes + (args.empty() ? "" : (" " + args)) + "\r\n");
-    _srv.sendToClient(c.fd(), ":ircserv NOTICE " + c.nick() + " :Set modes on " + chan + " to " + modes + (args.empty() ? "" : (" " + args)) + " (i=invite-only, t=topic-ops-only, k=key, l=limit).\r\n");
+    const std::string& modes = ch->modes();
+    MsgBuilder m(_srv.arena());
+    m << ':' << c.nick() << " MODE " << chan << ' ' << modes << "\r\n";
+    _srv.broadcast(ch, m, -1);
+    _srv.sendReply(c, RPL_CHANNELMODEIS, chan, modes);
+    m.clear();
+    m << ":ircserv NOTICE " << c.nick() << " :Set modes on " << chan << " to " << modes << " (i=invite-only, t=topic-ops-only, k=key, l=limit).\r\n";
+    _srv.sendHint(c.fd(), m);
 }
 
-void CommandHandler::cmdINVITE(Client& c, const std::vector<std::string>& p) {
-    if (!requireRegistered(c, "JOIN")) return;
-
-    if (p.size() < 2) { sendNumeric(c, "461", "INVITE :Not enough parameters"); return; }
+void CommandHandler::cmdINVITE(Client& c, const std::vector<std::string>& p, const std::string&) {
     std::string nick = p[0];
     std::string chan = p[1];
     Channel* ch = _srv.findChannel(chan);
-    if (!ch) { sendNumeric(c, "403", chan + " :No such channel"); return; }
-    if (!ch->hasMemberFd(c.fd())) { sendNumeric(c, "442", chan + " :You're not on that channel"); return; }
-    if (!ch->isOp(c.nick())) { sendNumeric(c, "482", chan + " :You're not channel operator"); return; }
+    if (!ch) { _srv.sendReply(c, ERR_NOSUCHCHANNEL, chan); return; }
+    if (!ch->hasMember(c.memberId())) { _srv.sendReply(c, ERR_NOTONCHANNEL, chan); return; }
+    if (!ch->isOp(c.memberId())) { _srv.sendReply(c, ERR_CHANOPRIVSNEEDED, chan); return; }
     Client* target = _srv.findClientByNick(nick);
-    if (!target) { sendNumeric(c, "401", nick + " :No such nick"); return; }
-
-    ch->invite(nick);
-    _srv.sendToClient(target->fd(), ":" + c.nick() + " INVITE " + nick + " " + chan + "\r\n");
-    sendNumeric(c, "341", nick + " " + chan);
-    _srv.sendToClient(c.fd(), ":ircserv NOTICE " + c.nick() + " :Invited " + nick + " to " + chan + ". If +i (invite-only) is set, they can now JOIN.\r\n");
+    if (!target) { _srv.sendReply(c, ERR_NOSUCHNICK, nick); return; }
+
+    ch->invite(target->memberId());
+    if (target->noteInvite(ch->atom())) _srv._atoms.retain(ch->atom());
+    MsgBuilder m(_srv.arena());
+    m << ':' << c.nick() << " INVITE " << nick << ' ' << chan << "\r\n";
+    _srv.sendToClient(target->fd(), m);
+    _srv.sendReply(c, RPL_INVITING, nick, chan);
+    m.clear();
+    m << ":ircserv NOTICE " << c.nick() << " :Invited " << nick << " to " << chan << ". If +i (invite-only) is set, they can now JOIN.\r\n";
+    _srv.sendHint(c.fd(), m);
 }
 
 void CommandHandler::cmdKICK(Client& c, const std::vector<std::string>& p, const std::string& trailing) {
-    if (!requireRegistered(c, "JOIN")) return;
-    
-    if (p.size() < 2) { sendNumeric(c, "461", "KICK :Not enough parameters"); return; }
     std::string chan = p[0];
     std::string victimNick = p[1];
     Channel* ch = _srv.findChannel(chan);
-    if (!ch) { sendNumeric(c, "403", chan + " :No such channel"); return; }
-    if (!ch->hasMemberFd(c.fd())) { sendNumeric(c, "442", chan + " :You're not on that channel"); return; }
-    if (!ch->isOp(c.nick())) { sendNumeric(c, "482", chan + " :You're not channel operator"); return; }
+    if (!ch) { _srv.sendReply(c, ERR_NOSUCHCHANNEL, chan); return; }
+    if (!ch->hasMember(c.memberId())) { _srv.sendReply(c, ERR_NOTONCHANNEL, chan); return; }
+    if (!ch->isOp(c.memberId())) { _srv.sendReply(c, ERR_CHANOPRIVSNEEDED, chan); return; }
 
     Client* victim = _srv.findClientByNick(victimNick);
-    if (!victim || !ch->hasMemberFd(victim->fd())) { sendNumeric(c, "441", victimNick + " " + chan + " :They aren't on that channel"); return; }
-
-    std::string reason = trailing.empty() ? "Kicked" : trailing;
-    std::string kickmsg = ":" + c.nick() + " KICK " + chan + " " + victimNick + " :" + reason + "\r\n";
-    _srv.broadcast(chan, kickmsg, victim->fd());
-    _srv.sendToClient(victim->fd(), kickmsg);
-
-    ch->removeMember(victim->fd());
-    victim->leaveChannel(toLower(chan));
-    _srv.sendToClient(c.fd(), ":ircserv NOTICE " + c.nick() + " :Kicked " + victimNick + " from " + chan + ".\r\n");
+    if (!victim || !ch->hasMember(victim->memberId())) { _srv.sendReply(c, ERR_USERNOTINCHANNEL, victimNick, chan); return; }
+
+    MsgBuilder m(_srv.arena());
+    m << ':' << c.nick() << " KICK " << chan << ' ' << victimNick << " :";
+    if (trailing.empty()) m << "Kicked"; else m << trailing;
+    m << "\r\n";
+    _srv.broadcast(ch, m, victim->fd());
+    _srv.sendToClient(victim->fd(), m);
+
+    _srv.revokeInvite(*victim, ch);
+    ch->removeMember(victim->memberId());
+    victim->leaveChannel(ch->atom());
+    m.clear();
+    m << ":ircserv NOTICE " << c.nick() << " :Kicked " << victimNick << " from " << chan << ".\r\n";
+    _srv.sendHint(c.fd(), m);
+    _srv.onMemberLeftChannel(ch, toLower(chan), victimNick);
 }
 
 void CommandHandler::cmdFILESEND(Client& c, const std::vector<std::string>& p, const std::string& trailing) {
-    if (!requireRegistered(c, "FILESEND")) return;
-    if (p.size() < 2 || trailing.empty()) { sendNumeric(c, "461", "FILESEND :Not enough parameters"); return; }
+    if (trailing.empty()) { _srv.sendReply(c, ERR_NEEDMOREPARAMS, "FILESEND"); return; }
     std::string targetNick = p[0];
     unsigned long sizeTotal = std::strtoul(p[1].c_str(), 0, 10);
     Client* dst = _srv.findClientByNick(targetNick);
-    if (!dst) { sendNumeric(c, "401", targetNick + " :No such nick"); return; }
+    if (!dst) { _srv.sendReply(c, ERR_NOSUCHNICK, targetNick); return; }
     int tid = _srv._ft->createOffer(c.fd(), dst->fd(), trailing, sizeTotal);
     // 739 to sender; 738 to receiver
-    std::ostringstream tidStream;
-    tidStream << tid;
-    std::string tidStr = tidStream.str();
-    _srv.sendToClient(c.fd(),  ":" + _srv.serverName() + " 739 " + c.nick() + " " + targetNick + " " + (tid > 0 ? tidStr : "0") + " " + p[1] + " :" + trailing + "\r\n");
-    std::ostringstream os; os << tid;
-    _srv.sendToClient(dst->fd(), ":" + _srv.serverName() + " 738 " + c.nick() + " " + os.str() + " " + p[1] + " :" + trailing + "\r\n");
-    _srv.sendToClient(dst->fd(), ":ircserv NOTICE " + dst->nick() + " :Use FILEACCEPT " + os.str() + " to receive.\r\n");
+    _srv.sendReply(c, RPL_FILEOFFERED, targetNick, tid > 0 ? tid : 0, p[1], trailing);
+    _srv.sendReplyTo(dst->fd(), StrView(c.nick().data(), c.nick().size()), RPL_FILEOFFER, tid, p[1], trailing);
+    MsgBuilder m(_srv.arena());
+    m << ":ircserv NOTICE " << dst->nick() << " :Use FILEACCEPT " << tid << " to receive.\r\n";
+    _srv.sendHint(dst->fd(), m);
 }
 
-void CommandHandler::cmdFILEACCEPT(Client& c, const std::vector<std::string>& p) {
-    if (!requireRegistered(c, "FILEACCEPT")) return;
-    if (p.empty()) { sendNumeric(c, "461", "FILEACCEPT :Not enough parameters"); return; }
+void CommandHandler::cmdFILEACCEPT(Client& c, const std::vector<std::string>& p, const std::string&) {
     int tid = std::atoi(p[0].c_str());
     if (_srv._ft->accept(tid, c.fd())) {
-        _srv.sendToClient(c.fd(),  ":" + _srv.serverName() + " 742 * " + p[0] + " :ACCEPTED\r\n");
+        _srv.sendReplyTo(c.fd(), StrView("*", 1), RPL_FILEACCEPTED, p[0]);
         // Notify sender
-        _srv.sendToClient(c.fd(), ":ircserv NOTICE " + c.nick() + " :Start receiving with FILEDATA relayed by server.\r\n");
-    } else sendNumeric(c, "400", p[0] + " :Cannot accept");
+        MsgBuilder m(_srv.arena());
+        m << ":ircserv NOTICE " << c.nick() << " :Start receiving with FILEDATA relayed by server.\r\n";
+        _srv.sendHint(c.fd(), m);
+    } else _srv.sendReply(c, ERR_FILETRANSFER, p[0], "Cannot accept");
 }
 
-void CommandHandler::cmdFILEDATA(Client& c, const std::vector<std::string>& p) {
-    if (!requireRegistered(c, "FILEDATA")) return;
-    if (p.size() < 2) { sendNumeric(c, "461", "FILEDATA :Not enough parameters"); return; }
+void CommandHandler::cmdFILEDATA(Client& c, const std::vector<std::string>& p, const std::string&) {
     int tid = std::atoi(p[0].c_str());
     std::string err;
     if (!_srv._ft->pushData(tid, c.fd(), p[1], err)) {
-        sendNumeric(c, "400", p[0] + " :" + err);
+        _srv.sendReply(c, ERR_FILETRANSFER, p[0], err);
     }
 }
 
-void CommandHandler::cmdFILEDONE(Client& c, const std::vector<std::string>& p) {
-    if (!requireRegistered(c, "FILEDONE")) return;
-    if (p.empty()) { sendNumeric(c, "461", "FILEDONE :Not enough parameters"); return; }
+void CommandHandler::cmdFILEDONE(Client& c, const std::vector<std::string>& p, const std::string&) {
     int tid = std::atoi(p[0].c_str());
     std::string err;
-    if (!_srv._ft->done(tid, c.fd(), err)) sendNumeric(c, "400", p[0] + " :" + err);
+    if (!_srv._ft->done(tid, c.fd(), err)) _srv.sendReply(c, ERR_FILETRANSFER, p[0], err);
 }
 
-void CommandHandler::cmdFILECANCEL(Client& c, const std::vector<std::string>& p) {
-    if (!requireRegistered(c, "FILECANCEL")) return;
-    if (p.empty()) { sendNumeric(c, "461", "FILECANCEL :Not enough parameters"); return; }
+void CommandHandler::cmdFILECANCEL(Client& c, const std::vector<std::string>& p, const std::string&) {
     int tid = std::atoi(p[0].c_str());
     std::string reason;
     if (_srv._ft->cancel(tid, c.fd(), reason)) {
         // Inform both peers if we can find them from transfer map (FileTransfer handles validity)
-        _srv.sendToClient(c.fd(), ":" + _srv.serverName() + " 743 * " + p[0] + " :" + reason + "\r\n");
-    } else sendNumeric(c, "400", p[0] + " :Cannot cancel");
+        _srv.sendReplyTo(c.fd(), StrView("*", 1), RPL_FILECANCELLED, p[0], reason);
+    } else _srv.sendReply(c, ERR_FILETRANSFER, p[0], "Cannot cancel");
+}
+
+// Quantiles of h as "count N p50 .. p99 .. p999 .. max ..", after prefix.
+static void quantileLine(MsgBuilder& m, const char* prefix, const Histogram& h) {
+    m << prefix << " count " << h.count << " p50 " << h.quantile(0.50) << " p99 " << h.quantile(0.99)
+      << " p999 " << h.quantile(0.999) << " max " << h.max;
+}
+
+// STATS m: one 212 per command that has been used. STATS l: one 249 per
+// used command with its handler time quantiles (ns). STATS c: one 249 per
+// counter, gauge and histogram of the metrics registry. STATS p: one 249
+// per object pool. Every query ends with 219.
+void CommandHandler::cmdSTATS(Client& c, const std::vector<std::string>& p, const std::string&) {
+    std::string query = p.empty() ? "*" : p[0];
+    if (query == "m" || query == "M") {
+        for (size_t i = 0; i < commandCount(); ++i) {
+            const CommandStat& st = _commands[i].stat;
+            if (!st.calls) continue;
+            _srv.sendReply(c, RPL_STATSCOMMANDS, st.name, st.calls, st.bytes, st.ns.sum / 1000);
+        }
+    } else if (query == "l" || query == "L") {
+        for (size_t i = 0; i < commandCount(); ++i) {
+            const CommandStat& st = _commands[i].stat;
+            if (!st.calls) continue;
+            MsgBuilder m(_srv.arena());
+            quantileLine(m, st.name, st.ns);
+            _srv.sendReply(c, RPL_STATSDEBUG, StrView(m.data(), m.size()));
+        }
+    } else if (query == "c" || query == "C") {
+        _srv.sampleGauges();
+        const Metrics& mx = _srv.metrics();
+        MsgBuilder m(_srv.arena());
+        for (int i = 0; i < Metrics::COUNTER_COUNT; ++i) {
+            m.clear();
+            m << Metrics::name(Metrics::Counter(i)) << ' ' << mx.counter(Metrics::Counter(i));
+            _srv.sendReply(c, RPL_STATSDEBUG, StrView(m.data(), m.size()));
+        }
+        for (int i = 0; i < Metrics::GAUGE_COUNT; ++i) {
+            m.clear();
+            m << Metrics::name(Metrics::Gauge(i)) << ' ' << mx.gauge(Metrics::Gauge(i));
+            _srv.sendReply(c, RPL_STATSDEBUG, StrView(m.data(), m.size()));
+        }
+        for (int i = 0; i < Metrics::HIST_COUNT; ++i) {
+            m.clear();
+            quantileLine(m, Metrics::name(Metrics::Hist(i)), mx.histogram(Metrics::Hist(i)));
+            _srv.sendReply(c, RPL_STATSDEBUG, StrView(m.data(), m.size()));
+        }
+    } else if (query == "p" || query == "P") {
+        const PoolStats* pools[] = { &_srv.clientPoolStats(), &_srv.channelPoolStats(), &_srv._ft->poolStats() };
+        for (size_t i = 0; i < sizeof(pools) / sizeof(pools[0]); ++i) {
+            const PoolStats& st = *pools[i];
+            unsigned long total = st.hits + st.misses;
+            MsgBuilder m(_srv.arena());
+            m << st.name << " live " << st.live << " peak " << st.peak << " idle " << st.idle
+              << " hits " << st.hits << " misses " << st.misses
+              << " hit-rate " << (total ? st.hits * 100 / total : 0) << '%';
+            _srv.sendReply(c, RPL_STATSDEBUG, StrView(m.data(), m.size()));
+        }
+    }
+    _srv.sendReply(c, RPL_ENDOFSTATS, query);
 }
 
 bool CommandHandler::requireRegistered(Client& c, const char* forCmd) {
     if (c.isRegistered()) return true;
     // 451 ERR_NOTREGISTERED — include the command name if we have it
-    std::string what = forCmd ? std::string(forCmd) : std::string("*");
-    sendNumeric(c, "451", what + " :You have not registered");
+    _srv.sendReply(c, ERR_NOTREGISTERED, forCmd ? forCmd : "*");
     return false;
 }
@@ -0,0 +1,43 @@
+#include "ConnTable.hpp"
+
+ConnTable::ConnTable() {}
+
+// Grow the slot vector to cover fd and append it to the live list.
+void ConnTable::insert(int fd, Client* c) {
+    if (fd < 0) return;
+    if ((size_t)fd >= _slots.size()) _slots.resize(fd + 1);
+    Slot& s = _slots[fd];
+    if (s.client) { s.client = c; return; }
+    s.client = c;
+    s.events = 0;
+    s.live = (int)_live.size();
+    _live.push_back(fd);
+}
+
+// Move the last live fd into the erased position so _live stays dense.
+Client* ConnTable::erase(int fd) {
+    Client* c = get(fd);
+    if (!c) return 0;
+    Slot& s = _slots[fd];
+    int hole = s.live;
+    int last = _live.back();
+    _live[hole] = last;
+    _slots[last].live = hole;
+    _live.pop_back();
+    s.client = 0;
+    s.live = -1;
+    s.events = 0;
+    return c;
+}
+
+bool ConnTable::setEvents(int fd, short events) {
+    if (!get(fd)) return false;
+    if (_slots[fd].events == events) return false;
+    _slots[fd].events = events;
+    return true;
+}
+
+void ConnTable::clear() {
+    _slots.clear();
+    _live.clear();
+}
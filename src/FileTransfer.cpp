@@ -35,10 +35,14 @@ bool FileTransfer::b64Decode(const std::string& in, std::string& out) {
     return true;
 }
 
-FileTransfer::FileTransfer(Server& s): _srv(s), _nextId(1) {}
+FileTransfer::FileTransfer(Server& s): _srv(s), _nextId(1), _pool("transfer", 64) {}
+
+FileTransfer::~FileTransfer() {
+    while (!_byId.empty()) finish(_byId.begin());
+}
 
 int FileTransfer::createOffer(int sender_fd, int receiver_fd, const std::string& filename, unsigned long size_total) {
-    Transfer t;
+    Transfer& t = *_pool.acquire();
     t.id = _nextId++;
     t.sender_fd = sender_fd;
     t.receiver_fd = receiver_fd;
@@ -47,59 +51,78 @@ int FileTransfer::createOffer(int sender_fd, int receiver_fd, const std::string&
     t.size_seen  = 0;
     t.accepted   = false;
     t.active     = true;
-    _byId[t.id]  = t;
+    _byId[t.id]  = &t;
     return t.id;
 }
 
+void FileTransfer::finish(std::map<int, Transfer*>::iterator it) {
+    _pool.release(it->second);
+    _byId.erase(it);
+}
+
+void FileTransfer::dropClient(int fd) {
+    std::map<int, Transfer*>::iterator it = _byId.begin();
+    while (it != _byId.end()) {
+        std::map<int, Transfer*>::iterator cur = it++;
+        if (cur->second->sender_fd == fd || cur->second->receiver_fd == fd) finish(cur);
+    }
+}
+
 bool FileTransfer::accept(int tid, int receiver_fd) {
-    std::map<int,Transfer>::iterator it = _byId.find(tid);
+    std::map<int,Transfer*>::iterator it = _byId.find(tid);
     if (it == _byId.end()) return false;
-    Transfer& t = it->second;
+    Transfer& t = *it->second;
     if (!t.active || t.receiver_fd != receiver_fd) return false;
     t.accepted = true;
     return true;
 }
 
 bool FileTransfer::cancel(int tid, int who_fd, std::string& reasonOut) {
-    std::map<int,Transfer>::iterator it = _byId.find(tid);
+    std::map<int,Transfer*>::iterator it = _byId.find(tid);
     if (it == _byId.end()) return false;
-    Transfer& t = it->second;
+    Transfer& t = *it->second;
     if (!t.active) return false;
     if (who_fd != t.sender_fd && who_fd != t.receiver_fd) return false;
     reasonOut = (who_fd == t.sender_fd ? "Sender cancelled" : "Receiver cancelled");
-    t.active = false;
+    finish(it);
     return true;
 }
 
 bool FileTransfer::pushData(int tid, int sender_fd, const std::string& base64, std::string& errOut) {
-    std::map<int,Transfer>::iterator it = _byId.find(tid);
+    std::map<int,Transfer*>::iterator it = _byId.find(tid);
     if (it == _byId.end()) { errOut = "Unknown transfer id"; return false; }
-    Transfer& t = it->second;
+    Transfer& t = *it->second;
     if (!t.active) { errOut = "Transfer not active"; return false; }
     if (!t.accepted) { errOut = "Transfer not accepted yet"; return false; }
     if (sender_fd != t.sender_fd) { errOut = "Only sender may push data"; return false; }
 
     std::string raw; if (!b64Decode(base64, raw)) { errOut = "Invalid base64"; return false; }
-    t.size_seen += (unsigned long)raw.size();
     // forward chunk (server relays bytes in NOTICE wrapper so it stays IRC-safe)
     // We wrap as: :server FILEDATA <tid> <chunk-bytes> (raw is binary; wrap into base64 again for receiver)
     // But receiver already expects base64? Keep symmetry: the server forwards the *same* base64 chunk.
     // Send to receiver as numeric 740 + chunk:
-    _srv.sendToClient(t.receiver_fd, ":" + _srv.serverName() + " 740 * " + base64 + " \r\n");
+    // Relay is low priority: a lagging receiver gets back-pressure, not eviction
+    MsgBuilder m(_srv.arena(), base64.size() + 64);
+    m << ':' << _srv.serverName() << " 740 * " << base64 << " \r\n";
+    if (!_srv.sendToClient(t.receiver_fd, m, Server::PRIO_LOW)) {
+        errOut = "Receiver SendQ full, resend this chunk later";
+        return false;
+    }
+    t.size_seen += (unsigned long)raw.size();
     return true;
 }
 
 bool FileTransfer::done(int tid, int sender_fd, std::string& errOut) {
-    std::map<int,Transfer>::iterator it = _byId.find(tid);
+    std::map<int,Transfer*>::iterator it = _byId.find(tid);
     if (it == _byId.end()) { errOut = "Unknown transfer id"; return false; }
-    Transfer& t = it->second;
+    Transfer& t = *it->second;
     if (!t.active) { errOut = "Transfer not active"; return false; }
     if (sender_fd != t.sender_fd) { errOut = "Only sender may finish"; return false; }
     if (t.size_total && t.size_seen != t.size_total) {
         // allow mismatch but warn
     }
-    t.active = false;
-    _srv.sendToClient(t.receiver_fd, ":" + _srv.serverName() + " 741 * " + t.filename + " :FILE DONE\r\n");
-    _srv.sendToClient(t.sender_fd,   ":" + _srv.serverName() + " 741 * " + t.filename + " :FILE DONE\r\n");
+    _srv.sendReplyTo(t.receiver_fd, StrView("*", 1), RPL_FILEDONE, t.filename);
+    _srv.sendReplyTo(t.sender_fd, StrView("*", 1), RPL_FILEDONE, t.filename);
+    finish(it);
     return true;
 }
@@ -0,0 +1,55 @@
+#include "LineBuffer.hpp"
+
+#include <cstring>
+
+LineBuffer::LineBuffer(): _start(0), _scan(0), _prev(0) {}
+
+void LineBuffer::append(const char* p, size_t n) {
+    _buf.append(p, n);
+}
+
+// Look for '\n' preceded by '\r' (a bare '\n' stays part of the line, as
+// with the old find("\r\n")). Remember how far we got for the next call.
+bool LineBuffer::next(const char*& line, size_t& len) {
+    const char* base = _buf.data();
+    size_t end = _buf.size();
+    size_t i = _scan > _start ? _scan : _start;
+    while (i < end) {
+        const char* nl = static_cast<const char*>(std::memchr(base + i, '\n', end - i));
+        if (!nl) break;
+        size_t at = nl - base;
+        if (at > _start && base[at - 1] == '\r') {
+            line = base + _start;
+            len = at - 1 - _start;
+            _prev = _start;
+            _start = at + 1;
+            _scan = _start;
+            return true;
+        }
+        i = at + 1;
+    }
+    _scan = end;
+    return false;
+}
+
+// Only the put-back line itself gets rescanned on the next call.
+void LineBuffer::unread() {
+    _start = _prev;
+    _scan = _prev;
+}
+
+void LineBuffer::reset(size_t keepCap) {
+    if (_buf.capacity() > keepCap) std::string().swap(_buf);
+    else _buf.clear();
+    _start = _scan = _prev = 0;
+}
+
+// Drop the consumed prefix in one move; keep capacity for the next recv().
+void LineBuffer::compact() {
+    if (_start == 0) return;
+    if (_start >= _buf.size()) _buf.clear();
+    else _buf.erase(0, _start);
+    _scan -= (_scan >= _start ? _start : _scan);
+    _start = 0;
+    _prev = 0;
+}
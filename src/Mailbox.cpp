@@ -0,0 +1,38 @@
+#include "Mailbox.hpp"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+Wakeup::Wakeup(): _rfd(-1), _wfd(-1), _pending(0) {}
+
+Wakeup::~Wakeup() {
+    if (_rfd != -1) close(_rfd);
+    if (_wfd != -1) close(_wfd);
+}
+
+bool Wakeup::open() {
+    int p[2];
+    if (pipe(p) != 0) return false;
+    fcntl(p[0], F_SETFL, O_NONBLOCK);
+    fcntl(p[1], F_SETFL, O_NONBLOCK);
+    _rfd = p[0];
+    _wfd = p[1];
+    return true;
+}
+
+// Only the first signal after a drain() touches the pipe.
+void Wakeup::signal() {
+    if (__atomic_exchange_n(&_pending, 1, __ATOMIC_SEQ_CST)) return;
+    char b = 1;
+    while (write(_wfd, &b, 1) < 0 && errno == EINTR) {}
+}
+
+// Empty the pipe, then clear the flag. A producer that pushes after the
+// clear signals again; anything pushed before it is visible to the mailbox
+// drain that follows. Clearing first could eat a byte and leave the flag set.
+void Wakeup::drain() {
+    char buf[64];
+    while (read(_rfd, buf, sizeof(buf)) > 0) {}
+    __atomic_store_n(&_pending, 0, __ATOMIC_SEQ_CST);
+}
@@ -0,0 +1,85 @@
+#include "Metrics.hpp"
+
+#include <cstring>
+
+#define IRC_METRIC_NAME(id, name, help) name,
+#define IRC_METRIC_HELP(id, name, help) help,
+static const char* const COUNTER_NAMES[] = { IRC_COUNTERS(IRC_METRIC_NAME) };
+static const char* const COUNTER_HELP[]  = { IRC_COUNTERS(IRC_METRIC_HELP) };
+static const char* const GAUGE_NAMES[]   = { IRC_GAUGES(IRC_METRIC_NAME) };
+static const char* const GAUGE_HELP[]    = { IRC_GAUGES(IRC_METRIC_HELP) };
+static const char* const HIST_NAMES[]    = { IRC_HISTOGRAMS(IRC_METRIC_NAME) };
+static const char* const HIST_HELP[]     = { IRC_HISTOGRAMS(IRC_METRIC_HELP) };
+#undef IRC_METRIC_NAME
+#undef IRC_METRIC_HELP
+
+// Inverse of index(): bucket i >= SUB covers [(SUB + sub) << shift, next).
+unsigned long Histogram::upperBound(unsigned i) {
+    if (i + 1 < SUB) return i;
+    if (i + 1 >= BUCKETS) return ~0UL;
+    unsigned n = i + 1;
+    unsigned e = n / SUB + SUB_BITS - 1;
+    return ((unsigned long)(SUB + n % SUB) << (e - SUB_BITS)) - 1;
+}
+
+unsigned long Histogram::quantile(double q) const {
+    if (!count) return 0;
+    unsigned long want = (unsigned long)(q * count);
+    if (want < 1) want = 1;
+    if (want > count) want = count;
+    unsigned long seen = 0;
+    for (unsigned i = 0; i < BUCKETS; ++i) {
+        seen += bucket[i];
+        if (seen < want) continue;
+        unsigned long ub = upperBound(i);
+        return ub < max ? ub : max;
+    }
+    return max;
+}
+
+Metrics::Metrics() {
+    std::memset(_counter, 0, sizeof(_counter));
+    std::memset(_gauge, 0, sizeof(_gauge));
+    std::memset(_hist, 0, sizeof(_hist));
+}
+
+const char* Metrics::name(Counter c) { return COUNTER_NAMES[c]; }
+const char* Metrics::name(Gauge g) { return GAUGE_NAMES[g]; }
+const char* Metrics::name(Hist h) { return HIST_NAMES[h]; }
+
+void Metrics::writeHeader(std::ostream& os, const char* name, const char* help, const char* type) {
+    os << "# HELP ircserv_" << name << ' ' << help << "\n# TYPE ircserv_" << name << ' ' << type << '\n';
+}
+
+// Cumulative counts at every non-empty bucket; le is the bucket's largest value.
+void Metrics::writeHistogram(std::ostream& os, const char* name, const std::string& labels,
+                             const Histogram& h) {
+    const char* sep = labels.empty() ? "" : ",";
+    unsigned long seen = 0;
+    for (unsigned i = 0; i + 1 < Histogram::BUCKETS; ++i) {
+        if (!h.bucket[i]) continue;
+        seen += h.bucket[i];
+        os << "ircserv_" << name << "_bucket{" << labels << sep << "le=\"" << Histogram::upperBound(i)
+           << "\"} " << seen << '\n';
+    }
+    os << "ircserv_" << name << "_bucket{" << labels << sep << "le=\"+Inf\"} " << h.count << '\n';
+    const char* open = labels.empty() ? "" : "{";
+    const char* close = labels.empty() ? "" : "}";
+    os << "ircserv_" << name << "_sum" << open << labels << close << ' ' << h.sum << '\n';
+    os << "ircserv_" << name << "_count" << open << labels << close << ' ' << h.count << '\n';
+}
+
+void Metrics::write(std::ostream& os) const {
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        writeHeader(os, COUNTER_NAMES[i], COUNTER_HELP[i], "counter");
+        os << "ircserv_" << COUNTER_NAMES[i] << ' ' << _counter[i] << '\n';
+    }
+    for (int i = 0; i < GAUGE_COUNT; ++i) {
+        writeHeader(os, GAUGE_NAMES[i], GAUGE_HELP[i], "gauge");
+        os << "ircserv_" << GAUGE_NAMES[i] << ' ' << _gauge[i] << '\n';
+    }
+    for (int i = 0; i < HIST_COUNT; ++i) {
+        writeHeader(os, HIST_NAMES[i], HIST_HELP[i], "histogram");
+        writeHistogram(os, HIST_NAMES[i], std::string(), _hist[i]);
+    }
+}
@@ -0,0 +1,60 @@
+#include "Numerics.hpp"
+
+#include <cstring>
+
+const NumericDef NUMERICS[NUMERIC_COUNT] = {
+#define IRC_NUMERIC_DEF(id, code, fmt) { code, fmt },
+    IRC_NUMERICS(IRC_NUMERIC_DEF)
+#undef IRC_NUMERIC_DEF
+};
+
+ReplyArg::ReplyArg(const char* s): _v(s, std::strlen(s)) {}
+
+// A rendered number points into our own buffer: re-point it at the copy's.
+ReplyArg::ReplyArg(const ReplyArg& o): _v(o._v) {
+    if (o._v.p >= o._num && o._v.p < o._num + sizeof(o._num)) {
+        std::memcpy(_num, o._num, sizeof(_num));
+        _v.p = _num + (o._v.p - o._num);
+    }
+}
+
+void ReplyArg::setNumber(unsigned long v, bool neg) {
+    char* e = _num + sizeof(_num);
+    char* s = e;
+    do { *--s = (char)('0' + v % 10); v /= 10; } while (v);
+    if (neg) *--s = '-';
+    _v = StrView(s, e - s);
+}
+
+// Copy what fits in [o, end); returns the new write position.
+static char* put(char* o, char* end, const char* p, size_t n) {
+    size_t room = end - o;
+    if (n > room) n = room;
+    std::memcpy(o, p, n);
+    return o + n;
+}
+
+size_t formatNumeric(char* out, const StrView& stem, size_t codeAt, Numeric id,
+                     const ReplyArg* const* args, int nargs) {
+    char* end = out + MAX_REPLY_LINE - 2; // CRLF always fits
+    char* o = put(out, end, stem.p, stem.n);
+    if (codeAt + 3 <= (size_t)(o - out)) std::memcpy(out + codeAt, NUMERICS[id].code, 3);
+    const char* f = NUMERICS[id].fmt;
+    int next = 0;
+    while (*f && o < end) {
+        const char* pct = std::strchr(f, '%');
+        if (!pct) { o = put(o, end, f, std::strlen(f)); break; }
+        o = put(o, end, f, pct - f);
+        if (pct[1] == 's') {
+            if (next < nargs) { const StrView& v = args[next]->view(); o = put(o, end, v.p, v.n); }
+            ++next;
+            f = pct + 2;
+        } else {
+            o = put(o, end, pct, 1);
+            f = pct + 1;
+        }
+    }
+    *o++ = '\r';
+    *o++ = '\n';
+    return o - out;
+}
@@ -0,0 +1,151 @@
+#include "OutQueue.hpp"
+
+#include <new>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL 0 // non-Linux: rely on SO_NOSIGPIPE / SIG_IGN instead
+#endif
+
+// Header and bytes live in one allocation; the bytes follow the object.
+Segment* Segment::create(const char* p, size_t n) {
+    void* mem = ::operator new(sizeof(Segment) + n);
+    Segment* s = new (mem) Segment(n, n);
+    if (n) std::memcpy(const_cast<char*>(s->data()), p, n);
+    return s;
+}
+
+Segment* Segment::createChunk(size_t cap) {
+    void* mem = ::operator new(sizeof(Segment) + cap);
+    return new (mem) Segment(0, cap);
+}
+
+void Segment::fill(const char* p, size_t n) {
+    std::memcpy(const_cast<char*>(data()) + _size, p, n);
+    _size += n;
+}
+
+void Segment::release() {
+    if (__atomic_sub_fetch(&_refs, 1, __ATOMIC_ACQ_REL) != 0) return;
+    this->~Segment();
+    ::operator delete(this);
+}
+
+SegmentRef::SegmentRef(const std::string& s)
+: _p(Segment::create(s.data(), s.size())) {}
+
+OutQueue::OutQueue(): _off(0), _bytes(0), _tailOpen(false) {}
+
+// Shared segments are queued as-is and close the tail chunk so later private
+// bytes cannot be reordered in front of them.
+void OutQueue::push(const SegmentRef& seg) {
+    if (seg.empty()) return;
+    _segs.push_back(seg);
+    _bytes += seg.size();
+    _tailOpen = false;
+}
+
+void OutQueue::append(const std::string& s) {
+    append(s.data(), s.size());
+}
+
+// Fill the open tail chunk, then continue in fresh CHUNK_BYTES chunks.
+// Payloads larger than a chunk get one exact-size segment of their own.
+void OutQueue::append(const char* p, size_t n) {
+    if (!n) return;
+    const size_t cap = CHUNK_BYTES - sizeof(Segment);
+    if (!_tailOpen && n >= cap) {
+        _segs.push_back(SegmentRef(Segment::create(p, n)));
+        _bytes += n;
+        return;
+    }
+    while (n) {
+        Segment* tail = _tailOpen ? _segs.back().get() : 0;
+        if (!tail || !tail->unique() || !tail->room()) {
+            _segs.push_back(SegmentRef(Segment::createChunk(cap)));
+            _tailOpen = true;
+            tail = _segs.back().get();
+        }
+        size_t k = n < tail->room() ? n : tail->room();
+        tail->fill(p, k);
+        _bytes += k;
+        p += k;
+        n -= k;
+    }
+}
+
+void OutQueue::splice(OutQueue& other) {
+    if (other.empty()) return;
+    if (empty()) { swap(other); return; }
+    // other's partially-written head keeps its offset by re-queuing the rest
+    bool first = true;
+    bool otherOpen = other._tailOpen;
+    while (!other._segs.empty()) {
+        if (first && other._off) {
+            const SegmentRef& h = other._segs.front();
+            append(h.data() + other._off, h.size() - other._off);
+        } else {
+            push(other._segs.front());
+        }
+        first = false;
+        other._segs.pop_front();
+    }
+    _tailOpen = otherOpen;
+    other.clear();
+}
+
+int OutQueue::gather(struct iovec* iov, int max) const {
+    int cnt = 0;
+    for (std::deque<SegmentRef>::const_iterator it = _segs.begin();
+         it != _segs.end() && cnt < max; ++it, ++cnt) {
+        size_t skip = (cnt == 0) ? _off : 0;
+        iov[cnt].iov_base = const_cast<char*>(it->data() + skip);
+        iov[cnt].iov_len  = it->size() - skip;
+    }
+    return cnt;
+}
+
+// Gather up to IOV_BATCH segments into one sendmsg(). MSG_NOSIGNAL turns a
+// write to a reset peer into EPIPE instead of killing the process.
+ssize_t OutQueue::writeTo(int fd) {
+    struct iovec iov[IOV_BATCH];
+    int cnt = gather(iov, IOV_BATCH);
+    if (cnt == 0) return 0;
+    struct msghdr mh;
+    std::memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = iov;
+    mh.msg_iovlen = cnt;
+    ssize_t n = ::sendmsg(fd, &mh, MSG_NOSIGNAL);
+    if (n > 0) consume((size_t)n);
+    return n;
+}
+
+// Advance the read offset, popping (and releasing) fully written segments.
+void OutQueue::consume(size_t n) {
+    if (n > _bytes) n = _bytes;
+    _bytes -= n;
+    while (n && !_segs.empty()) {
+        size_t left = _segs.front().size() - _off;
+        if (n < left) { _off += n; return; }
+        n -= left;
+        _off = 0;
+        _segs.pop_front(); // chunk fully sent: its memory goes back now
+    }
+    if (_segs.empty()) { _off = 0; _tailOpen = false; }
+}
+
+void OutQueue::clear() {
+    _segs.clear();
+    _off = 0;
+    _bytes = 0;
+    _tailOpen = false;
+}
+
+void OutQueue::swap(OutQueue& o) {
+    _segs.swap(o._segs);
+    size_t t = _off; _off = o._off; o._off = t;
+    t = _bytes; _bytes = o._bytes; o._bytes = t;
+    bool b = _tailOpen; _tailOpen = o._tailOpen; o._tailOpen = b;
+}
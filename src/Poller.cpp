@@ -0,0 +1,130 @@
+#include "Poller.hpp"
+
+#include <cerrno>
+#include <unistd.h>
+
+// Pick a backend by name. An empty name means "best available": epoll on
+// Linux, poll elsewhere. Anything we cannot provide falls back to poll.
+Poller* Poller::create(const std::string& kind) {
+#ifdef __linux__
+    if (kind.empty() || kind == "epoll" || kind == "epoll-et") {
+        EpollPoller* ep = new EpollPoller(kind == "epoll-et");
+        if (ep->ok()) return ep;
+        delete ep;
+    }
+#else
+    (void)kind;
+#endif
+    return new PollPoller();
+}
+
+// ---------------------------------------------------------------- poll(2)
+
+PollPoller::PollPoller() {}
+
+const char* PollPoller::name() const { return "poll"; }
+
+// Track an fd with the desired poll events (e.g., POLLIN or POLLIN|POLLOUT).
+void PollPoller::add(int fd, short events) {
+    if (fd < 0) return;
+    if ((size_t)fd >= _index.size()) _index.resize(fd + 1, -1);
+    if (_index[fd] != -1) { _pfds[_index[fd]].events = events; return; }
+    struct pollfd p; p.fd = fd; p.events = events; p.revents = 0;
+    _index[fd] = (int)_pfds.size();
+    _pfds.push_back(p);
+}
+
+// Update the desired events mask for an existing pollfd entry.
+void PollPoller::modify(int fd, short events) {
+    if (fd < 0 || (size_t)fd >= _index.size() || _index[fd] == -1) return;
+    _pfds[_index[fd]].events = events;
+}
+
+// Swap the last entry into the removed slot; no compaction pass needed.
+void PollPoller::remove(int fd) {
+    if (fd < 0 || (size_t)fd >= _index.size() || _index[fd] == -1) return;
+    int hole = _index[fd];
+    _pfds[hole] = _pfds.back();
+    _index[_pfds[hole].fd] = hole;
+    _pfds.pop_back();
+    _index[fd] = -1;
+}
+
+// poll() the whole set, then collect entries with non-zero revents.
+int PollPoller::wait(std::vector<PollEvent>& ready, int timeout_ms) {
+    ready.clear();
+    int ret = ::poll(_pfds.empty() ? 0 : &_pfds[0], _pfds.size(), timeout_ms);
+    if (ret <= 0) return ret;
+    for (size_t i = 0; i < _pfds.size() && (int)ready.size() < ret; ++i) {
+        if (!_pfds[i].revents) continue;
+        PollEvent ev; ev.fd = _pfds[i].fd; ev.revents = _pfds[i].revents;
+        ready.push_back(ev);
+    }
+    return (int)ready.size();
+}
+
+// --------------------------------------------------------------- epoll(7)
+#ifdef __linux__
+
+// Translate a poll(2) interest mask into epoll flags.
+static unsigned int toEpoll(short events, bool edge) {
+    unsigned int e = 0;
+    if (events & POLLIN)  e |= EPOLLIN;
+    if (events & POLLOUT) e |= EPOLLOUT;
+    if (edge) e |= EPOLLET;
+    return e;
+}
+
+// Translate epoll readiness bits back into poll(2) revents.
+static short fromEpoll(unsigned int e) {
+    short r = 0;
+    if (e & EPOLLIN)  r |= POLLIN;
+    if (e & EPOLLOUT) r |= POLLOUT;
+    if (e & EPOLLHUP) r |= POLLHUP;
+    if (e & EPOLLERR) r |= POLLERR;
+    return r;
+}
+
+EpollPoller::EpollPoller(bool edgeTriggered)
+: _epfd(::epoll_create(1024)), _edge(edgeTriggered), _evbuf(64), _watched(0) {}
+
+EpollPoller::~EpollPoller() { if (_epfd >= 0) close(_epfd); }
+
+bool EpollPoller::ok() const { return _epfd >= 0; }
+
+const char* EpollPoller::name() const { return _edge ? "epoll-et" : "epoll"; }
+
+bool EpollPoller::edgeTriggered() const { return _edge; }
+
+void EpollPoller::add(int fd, short events) {
+    struct epoll_event ev; ev.events = toEpoll(events, _edge); ev.data.u64 = 0; ev.data.fd = fd;
+    if (::epoll_ctl(_epfd, EPOLL_CTL_ADD, fd, &ev) == 0) ++_watched;
+}
+
+void EpollPoller::modify(int fd, short events) {
+    struct epoll_event ev; ev.events = toEpoll(events, _edge); ev.data.u64 = 0; ev.data.fd = fd;
+    ::epoll_ctl(_epfd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+void EpollPoller::remove(int fd) {
+    struct epoll_event ev; ev.events = 0; ev.data.u64 = 0; // non-NULL for pre-2.6.9 kernels
+    if (::epoll_ctl(_epfd, EPOLL_CTL_DEL, fd, &ev) == 0) --_watched;
+}
+
+// epoll_wait() hands back only ready descriptors. Grow the event buffer when
+// it came back full so bursts are reported in as few calls as possible.
+int EpollPoller::wait(std::vector<PollEvent>& ready, int timeout_ms) {
+    ready.clear();
+    if (_evbuf.size() < 64) _evbuf.resize(64);
+    int n = ::epoll_wait(_epfd, &_evbuf[0], (int)_evbuf.size(), timeout_ms);
+    if (n <= 0) return n;
+    for (int i = 0; i < n; ++i) {
+        PollEvent pe; pe.fd = _evbuf[i].data.fd; pe.revents = fromEpoll(_evbuf[i].events);
+        ready.push_back(pe);
+    }
+    if ((size_t)n == _evbuf.size() && _evbuf.size() < (size_t)_watched)
+        _evbuf.resize(_evbuf.size() * 2);
+    return n;
+}
+
+#endif
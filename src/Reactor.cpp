@@ -0,0 +1,199 @@
+#include "Reactor.hpp"
+
+#include <iostream>
+#include <cerrno>
+#include <cstdio>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+// fds at or above this are not accounted (queued() reports 0)
+static size_t queuedSlots() {
+    struct rlimit rl;
+    size_t n = 1024;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY) n = rl.rlim_cur;
+    return n < ((size_t)1 << 20) ? n : ((size_t)1 << 20);
+}
+
+Reactor::Reactor(int index, const std::string& pollerKind, Wakeup& coreWake)
+: _index(index), _pollerKind(pollerKind), _poller(0), _coreWake(coreWake),
+  _queued(queuedSlots(), 0), _queuedTotal(0), _running(false), _posted(false), _stop(0) {}
+
+Reactor::~Reactor() {
+    stop();
+    delete _poller;
+}
+
+// Create the poller and doorbell, then spawn the I/O thread.
+bool Reactor::start() {
+    if (_running) return true;
+    if (!_wake.open()) return false;
+    _poller = Poller::create(_pollerKind);
+    _poller->add(_wake.fd(), POLLIN);
+    if (pthread_create(&_thread, 0, &Reactor::threadMain, this) != 0) return false;
+    _running = true;
+    return true;
+}
+
+// Flag the thread, ring it, join it, and close whatever sockets it still owns.
+void Reactor::stop() {
+    if (!_running) return;
+    __atomic_store_n(&_stop, 1, __ATOMIC_SEQ_CST);
+    _wake.signal();
+    pthread_join(_thread, 0);
+    _running = false;
+    drainInbox(); // adopt anything still queued so its socket gets closed
+    for (size_t fd = 0; fd < _conns.size(); ++fd) if (_conns[fd]) closeConn((int)fd);
+}
+
+void Reactor::post(const ReactorMsg& m) { _inbox.push(m); _posted = true; }
+void Reactor::wake() { if (_posted) { _posted = false; _wake.signal(); } }
+bool Reactor::receive(ReactorMsg& out) { return _outbox.pop(out); }
+
+size_t Reactor::queued(int fd) const {
+    if (fd < 0 || (size_t)fd >= _queued.size()) return 0;
+    return __atomic_load_n(&_queued[fd], __ATOMIC_RELAXED);
+}
+
+size_t Reactor::queuedTotal() const {
+    return __atomic_load_n(&_queuedTotal, __ATOMIC_RELAXED);
+}
+
+// Reactor thread: record fd's new backlog and adjust the shard total.
+void Reactor::publishQueued(int fd, size_t bytes) {
+    if (fd < 0 || (size_t)fd >= _queued.size()) return;
+    size_t old = _queued[fd];
+    if (old == bytes) return;
+    __atomic_store_n(&_queued[fd], bytes, __ATOMIC_RELAXED);
+    if (bytes > old) __atomic_add_fetch(&_queuedTotal, bytes - old, __ATOMIC_RELAXED);
+    else __atomic_sub_fetch(&_queuedTotal, old - bytes, __ATOMIC_RELAXED);
+}
+
+// Re-register fd's interest: POLLIN unless paused, POLLOUT while backlogged.
+void Reactor::rearm(int fd, Conn* c) {
+    _poller->modify(fd, (c->paused ? 0 : POLLIN) | (c->pollout ? POLLOUT : 0));
+}
+
+void* Reactor::threadMain(void* self) {
+    static_cast<Reactor*>(self)->loop();
+    return 0;
+}
+
+Reactor::Conn* Reactor::conn(int fd) const {
+    return (fd >= 0 && (size_t)fd < _conns.size()) ? _conns[fd] : 0;
+}
+
+// Reactor event loop: socket readiness plus our doorbell for inbox work.
+void Reactor::loop() {
+    std::vector<PollEvent> ready;
+    while (!__atomic_load_n(&_stop, __ATOMIC_SEQ_CST)) {
+        int ret = _poller->wait(ready, -1);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "reactor " << _index << ": ";
+            std::perror(_poller->name()); break;
+        }
+        for (size_t i = 0; i < ready.size(); ++i) {
+            int fd = ready[i].fd;
+            short re = ready[i].revents;
+            if (fd == _wake.fd()) { drainInbox(); continue; }
+            if (re & POLLIN) handleRead(fd);
+            if (re & POLLOUT) handleWrite(fd);
+            if (re & (POLLHUP | POLLERR | POLLNVAL)) markGone(fd);
+        }
+    }
+}
+
+// Apply everything the core queued for us since the last wake-up.
+void Reactor::drainInbox() {
+    _wake.drain();
+    ReactorMsg m;
+    while (_inbox.pop(m)) {
+        if (m.op == ReactorMsg::ADOPT) {
+            if ((size_t)m.fd >= _conns.size()) _conns.resize(m.fd + 1, 0);
+            Conn* c = new Conn();
+            c->id = m.id;
+            _conns[m.fd] = c;
+            _poller->add(m.fd, POLLIN);
+            continue;
+        }
+        Conn* c = conn(m.fd);
+        if (!c || c->id != m.id) continue;
+        if (m.op == ReactorMsg::SEND) {
+            if (c->gone) continue;
+            c->outbuf.splice(m.out);
+            handleWrite(m.fd);
+        } else if (m.op == ReactorMsg::CLOSE) {
+            closeConn(m.fd);
+        } else if (m.op == ReactorMsg::PAUSE || m.op == ReactorMsg::RESUME) {
+            bool paused = (m.op == ReactorMsg::PAUSE);
+            if (c->gone || c->paused == paused) continue;
+            c->paused = paused;
+            rearm(m.fd, c);
+        }
+    }
+}
+
+// Read what the kernel has and forward it to the core as one DATA message.
+// Line framing stays on the core so command semantics live in one place.
+void Reactor::handleRead(int fd) {
+    Conn* c = conn(fd);
+    if (!c || c->gone) return;
+    ReactorMsg m(ReactorMsg::DATA, fd, c->id);
+    bool eof = false;
+    do {
+        char buf[4096];
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n < 0 && (errno == EWOULDBLOCK || errno == EAGAIN || errno == EINTR)) break;
+        if (n <= 0) { eof = true; break; }
+        m.data.append(buf, n);
+    } while (_poller->edgeTriggered());
+    if (!m.data.empty()) {
+        _outbox.push(m);
+        _coreWake.signal();
+    }
+    if (eof) markGone(fd);
+}
+
+// Flush the shard-local buffer; arm POLLOUT only while bytes remain.
+void Reactor::handleWrite(int fd) {
+    Conn* c = conn(fd);
+    if (!c || c->gone) return;
+    OutQueue& ob = c->outbuf;
+    while (!ob.empty()) {
+        ssize_t n = ob.writeTo(fd);
+        if (n < 0) {
+            if (errno == EWOULDBLOCK || errno == EAGAIN) {
+                publishQueued(fd, ob.bytes());
+                if (!c->pollout) { c->pollout = true; rearm(fd, c); }
+                return;
+            }
+            if (errno == EINTR) continue;
+            markGone(fd);
+            return;
+        }
+    }
+    publishQueued(fd, 0);
+    if (c->pollout) { c->pollout = false; rearm(fd, c); }
+}
+
+// Stop watching the socket and tell the core; the core answers with CLOSE.
+void Reactor::markGone(int fd) {
+    Conn* c = conn(fd);
+    if (!c || c->gone) return;
+    c->gone = true;
+    _poller->remove(fd);
+    _outbox.push(ReactorMsg(ReactorMsg::GONE, fd, c->id));
+    _coreWake.signal();
+}
+
+void Reactor::closeConn(int fd) {
+    Conn* c = conn(fd);
+    if (!c) return;
+    if (!c->gone) _poller->remove(fd);
+    publishQueued(fd, 0);
+    close(fd);
+    delete c;
+    _conns[fd] = 0;
+}
@@ -5,23 +5,48 @@
 #include "Utils.hpp"
 
 #include <iostream>
+#include <sstream>
 #include <cstring>
 #include <cstdlib>
 #include <cerrno>
 #include <cstdio>
 #include <sys/types.h>
 #include <sys/socket.h>
-#include <netdb.h>
+#include <sys/un.h>
 #include <fcntl.h>
 #include <unistd.h>
 
+#ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL 0 // non-Linux: rely on SO_NOSIGPIPE / SIG_IGN instead
+#endif
+
 // Construct the server: initialize containers, create the listening socket,
 // and instantiate helper subsystems (bot and file transfer).
-Server::Server(const std::string& port, const std::string& password)
-: _listen_fd(-1), _password(password), _servername("ircserv"),
-  _bot(0), _ft(0) // NEW
+Server::Server(const std::string& port, const std::string& password, const ServerConfig& cfg)
+: _listen_fd(-1), _admin_fd(-1), _cfg(cfg), _poller(0),
+  _transport(cfg.transport ? cfg.transport : &_sockets), _clock(cfg.clock ? cfg.clock : &Clock::system()),
+  _nextConnId(0), _acceptLeft(0), _acceptMore(false), _dispatcher(0),
+  _timers(_clock->usec() / 1000), _clientPool("client"), _channelPool("channel"),
+  _sendqTotal(0), _password(password), _servername("ircserv"), _bot(0), _ft(0) // NEW
 {
+    _prefix = ":" + _servername + " ";
+    if (_cfg.backlog <= 0) _cfg.backlog = SOMAXCONN;
+    if (_cfg.acceptBudget <= 0) _cfg.acceptBudget = 1;
+    if (_cfg.welcomeBudget <= 0) _cfg.welcomeBudget = 1;
+    if (_cfg.poolKeep < 0) _cfg.poolKeep = 0;
+    _clientPool.setKeep(_cfg.poolKeep);
+    _channelPool.setKeep(_cfg.poolKeep);
+    _dispatcher = new CommandHandler(*this);
+    if (!_transport->kernel() && (_cfg.reactors > 0 || !_cfg.adminSocket.empty())) {
+        std::cerr << _transport->name() << " transport: reactors and admin socket disabled" << std::endl;
+        _cfg.reactors = 0;
+        _cfg.adminSocket.clear();
+    }
+    _poller = _transport->createPoller(_cfg.poller);
     setupSocket(port);
+    setupAdminSocket();
+    if (!_cfg.captureFile.empty()) _capture.start(_cfg.captureFile, _clock->usec());
+    if (_cfg.reactors > 0) startReactors();
     // NEW: create subsystems
     _bot = new Bot(*this, "helperbot");
     _ft  = new FileTransfer(*this);
@@ -30,203 +55,689 @@ Server::Server(const std::string& port, const std::string& password)
 // Destructor: close sockets and free owned objects.
 Server::~Server() {
     closeAndCleanup();
+    _capture.stop();
     // NEW
     delete _bot; _bot = 0;
     delete _ft;  _ft = 0;
+    delete _poller; _poller = 0;
+    delete _dispatcher; _dispatcher = 0;
 }
 
 const std::string& Server::serverName() const { return _servername; }
 
-// Create a non-blocking listening socket bound to the requested port and
-// add it to the poll() set for connection readiness notifications.
+// Open the listener through the transport and register it with the poller
+// for connection readiness notifications.
 void Server::setupSocket(const std::string& port) {
-    struct addrinfo hints; std::memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_UNSPEC;
-    hints.ai_socktype = SOCK_STREAM;
-    hints.ai_flags = AI_PASSIVE;
-
-    struct addrinfo* res = 0;
-    int err = getaddrinfo(NULL, port.c_str(), &hints, &res);
-    if (err != 0) {
-        std::cerr << "getaddrinfo: " << gai_strerror(err) << std::endl;
-        std::exit(1);
-    }
-
-    int fd = -1;
-    for (struct addrinfo* p = res; p; p = p->ai_next) {
-        fd = ::socket(p->ai_family, p->ai_socktype, p->ai_protocol);
-        if (fd < 0) continue;
-
-        int yes = 1;
-        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
-
-        if (bind(fd, p->ai_addr, p->ai_addrlen) == 0) {
-            if (listen(fd, 128) == 0) {
-                _listen_fd = fd;
-                break;
-            }
+    _listen_fd = _transport->listen(port, _cfg.backlog);
+    if (_listen_fd < 0) std::exit(1);
+    addPollfd(_listen_fd, POLLIN);
+}
+
+// Optional metrics endpoint: a stream socket in the filesystem, so only
+// local users with access to the path can read it. A stale socket file
+// from an earlier run is replaced.
+void Server::setupAdminSocket() {
+    if (_cfg.adminSocket.empty()) return;
+    struct sockaddr_un sa; std::memset(&sa, 0, sizeof(sa));
+    if (_cfg.adminSocket.size() >= sizeof(sa.sun_path)) {
+        std::cerr << "admin socket: path too long: " << _cfg.adminSocket << std::endl;
+        return;
+    }
+    sa.sun_family = AF_UNIX;
+    std::memcpy(sa.sun_path, _cfg.adminSocket.c_str(), _cfg.adminSocket.size());
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) { std::perror("admin socket"); return; }
+    unlink(sa.sun_path);
+    if (bind(fd, (struct sockaddr*)&sa, sizeof(sa)) != 0 || listen(fd, 8) != 0) {
+        std::perror("admin socket");
+        close(fd);
+        return;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    _admin_fd = fd;
+    addPollfd(_admin_fd, POLLIN);
+}
+
+// The socket stays non-blocking: what a reader does not take at once goes
+// out on POLLOUT over later ticks, and a reader that stalls is dropped
+// after ADMIN_TIMEOUT_MS. The kernel backlog (8) bounds the accepts per
+// call; the dump is rendered at most once for all of them.
+void Server::serveAdmin() {
+    std::string text;
+    while (true) {
+        int fd = accept(_admin_fd, 0, 0);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            return;
+        }
+        if (_adminConns.size() >= ADMIN_MAX_CONNS) { close(fd); continue; }
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        if (text.empty()) {
+            std::ostringstream os;
+            writeMetrics(os);
+            text = os.str();
+        }
+        AdminConn* a = new AdminConn;
+        a->fd = fd;
+        a->text = text;
+        a->off = 0;
+        a->polled = false;
+        a->timer.set(&Server::onAdminTimer, this, a);
+        _adminConns[fd] = a;
+        writeAdmin(a);
+        if (_adminConns.count(fd)) {
+            a->polled = true;
+            addPollfd(fd, POLLOUT);
+            _timers.arm(a->timer, ADMIN_TIMEOUT_MS);
         }
-        close(fd); fd = -1;
     }
-    freeaddrinfo(res);
+}
 
-    if (_listen_fd < 0) {
-        std::cerr << "Failed to bind/listen" << std::endl;
-        std::exit(1);
+void Server::writeAdmin(AdminConn* a) {
+    while (a->off < a->text.size()) {
+        ssize_t n = send(a->fd, a->text.data() + a->off, a->text.size() - a->off, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        if (n <= 0) break;
+        a->off += n;
     }
+    closeAdmin(a);
+}
 
-    // set non-blocking
-    fcntl(_listen_fd, F_SETFL, O_NONBLOCK);
+void Server::closeAdmin(AdminConn* a) {
+    if (a->polled && _poller) _poller->remove(a->fd);
+    a->timer.cancel();
+    close(a->fd);
+    _adminConns.erase(a->fd);
+    delete a;
+}
 
-    addPollfd(_listen_fd, POLLIN);
+void Server::onAdminTimer(void* srv, Timer& t) {
+    static_cast<Server*>(srv)->closeAdmin(static_cast<AdminConn*>(t.arg()));
+}
+
+void Server::sampleGauges() {
+    _metrics.set(Metrics::CLIENTS, _clients.size());
+    _metrics.set(Metrics::PENDING, _pending.size());
+    _metrics.set(Metrics::CHANNELS, _channelPool.stats().live);
+    _metrics.set(Metrics::SENDQ_BYTES, sendqTotal());
+    _metrics.set(Metrics::ARENA_PEAK, _arena.peak());
+}
+
+void Server::writeMetrics(std::ostream& os) {
+    sampleGauges();
+    _metrics.write(os);
+    Metrics::writeHeader(os, "command_ns", "Handler time per command line", "histogram");
+    for (size_t i = 0; i < CommandHandler::commandCount(); ++i) {
+        const CommandStat& st = CommandHandler::commandStat(i);
+        if (!st.calls) continue;
+        Metrics::writeHistogram(os, "command_ns", std::string("cmd=\"") + st.name + "\"", st.ns);
+    }
 }
 
 // Track an fd with the desired poll events (e.g., POLLIN or POLLIN|POLLOUT).
 void Server::addPollfd(int fd, short events) {
-    struct pollfd p; p.fd = fd; p.events = events; p.revents = 0;
-    _pfds.push_back(p);
+    _poller->add(fd, events);
+    _clients.setEvents(fd, events);
 }
 
-// Update the desired events mask for an existing pollfd entry.
+// Update the desired events mask for an existing fd; skip the poller call when
+// the mask is unchanged. In multi-reactor mode the socket lives on a reactor,
+// so "wants POLLOUT" instead queues the fd for flushReactors().
 void Server::setPollEvents(int fd, short events) {
-    for (size_t i = 0; i < _pfds.size(); ++i) if (_pfds[i].fd == fd) {
-        _pfds[i].events = events;
-        return;
-    }
+    if (!_clients.setEvents(fd, events)) return;
+    if (_reactors.empty()) _poller->modify(fd, events);
+    else if (events & POLLOUT) _flush.push_back(fd);
 }
 
-// Main event loop: poll for events, accept new clients, read lines, and write
-// outbound buffers. This loop is single-threaded and runs until process exit.
-void Server::run() {
-    CommandHandler dispatcher(*this);
-    while (true) {
-        int ret = poll(&_pfds[0], _pfds.size(), -1);
-        if (ret < 0) {
-            if (errno == EINTR) continue;
-            std::perror("poll"); break;
+// Spawn the reactor threads and listen on our own doorbell for their output.
+// If anything fails we stay single-threaded rather than half-sharded.
+void Server::startReactors() {
+    if (!_coreWake.open()) { std::perror("reactors: pipe"); return; }
+    for (int i = 0; i < _cfg.reactors; ++i) {
+        Reactor* r = new Reactor(i, _cfg.poller, _coreWake);
+        if (!r->start()) {
+            std::cerr << "reactors: failed to start thread " << i << ", staying single-threaded" << std::endl;
+            delete r;
+            for (size_t j = 0; j < _reactors.size(); ++j) delete _reactors[j];
+            _reactors.clear();
+            return;
         }
-        for (size_t i = 0; i < _pfds.size(); ++i) {
-            int fd = _pfds[i].fd;
-            short re = _pfds[i].revents;
-            if (!re) continue;
-
-            if (fd == _listen_fd && (re & POLLIN)) {
-                handleNewConnection();
-            } else {
-                if (re & POLLIN) handleClientRead(fd);
-                if (re & POLLOUT) handleClientWrite(fd);
-                if (re & (POLLHUP | POLLERR | POLLNVAL)) removeClient(fd);
+        _reactors.push_back(r);
+    }
+    addPollfd(_coreWake.fd(), POLLIN);
+}
+
+// Connections are spread round-robin by serial, which stays fixed for life.
+Reactor* Server::reactorFor(const Client* c) const {
+    return _reactors[c->connId() % _reactors.size()];
+}
+
+// Core side of the reactor mailboxes: feed received bytes through the normal
+// framing/dispatch path and turn GONE into a regular removeClient().
+void Server::drainReactors() {
+    _coreWake.drain();
+    ReactorMsg m;
+    for (size_t i = 0; i < _reactors.size(); ++i) {
+        while (_reactors[i]->receive(m)) {
+            Client* c = _clients.get(m.fd);
+            if (!c || c->connId() != m.id) continue; // stale: fd was reused
+            if (m.op == ReactorMsg::DATA) {
+                _metrics.add(Metrics::BYTES_IN, m.data.size());
+                _metrics.record(Metrics::READ_BYTES, m.data.size());
+                c->inbuf().append(m.data);
+                processInput(m.fd, c);
+            } else if (m.op == ReactorMsg::GONE) {
+                removeClient(m.fd);
             }
         }
-        // compact pollfd vector (remove closed fds)
-        std::vector<struct pollfd> newpfds;
-        for (size_t i = 0; i < _pfds.size(); ++i) {
-            if (_pfds[i].fd != -1) newpfds.push_back(_pfds[i]);
+    }
+}
+
+// End of a core tick: move each dirty client's output into one SEND message
+// for its reactor, then ring every reactor that received work.
+void Server::flushReactors() {
+    if (_reactors.empty()) return;
+    for (size_t i = 0; i < _flush.size(); ++i) {
+        int fd = _flush[i];
+        Client* c = _clients.get(fd);
+        if (!c) continue;
+        _clients.setEvents(fd, POLLIN);
+        if (c->outbuf().empty()) continue;
+        // from here the bytes count against the reactor's queued() total
+        size_t bytes = c->outbuf().bytes();
+        _sendqTotal -= bytes;
+        _metrics.add(Metrics::BYTES_OUT, bytes);
+        _metrics.record(Metrics::WRITE_BYTES, bytes);
+        ReactorMsg m(ReactorMsg::SEND, fd, c->connId());
+        m.out.swap(c->outbuf());
+        reactorFor(c)->post(m);
+    }
+    _flush.clear();
+    for (size_t i = 0; i < _reactors.size(); ++i) _reactors[i]->wake();
+}
+
+// Main event loop: wait for readiness, accept new clients, read lines, and
+// write outbound buffers. The poller hands back only ready descriptors, so a
+// tick costs O(ready) with epoll. Single-threaded; runs until process exit.
+void Server::run() {
+    while (step(-1)) {}
+}
+
+// One tick of run(). max_wait_ms caps the poller timeout (-1 = no cap).
+bool Server::step(int max_wait_ms) {
+    // sleep until the next timer at most; don't block at all while
+    // connections are waiting to be accepted/admitted
+    int timeout = _timers.nextTimeout(_clock->usec() / 1000);
+    if (_acceptMore || !_pending.empty()) timeout = 0;
+    // token refills, and reactors draining paused clients' queues, do
+    // not wake us up: poll for them while anyone is waiting
+    if ((!_throttled.empty() || (!_paused.empty() && !_reactors.empty()))
+        && (timeout < 0 || timeout > RECHECK_POLL_MS))
+        timeout = RECHECK_POLL_MS;
+    // a partial capture chunk goes to the writer within FLUSH_MS
+    if (_capture.pending() && (timeout < 0 || timeout > Capture::FLUSH_MS))
+        timeout = Capture::FLUSH_MS;
+    if (max_wait_ms >= 0 && (timeout < 0 || timeout > max_wait_ms)) timeout = max_wait_ms;
+    int ret = _poller->wait(_ready, timeout);
+    if (ret < 0) {
+        if (errno == EINTR) return true;
+        std::perror(_poller->name());
+        return false;
+    }
+    unsigned long t0 = monotonicNsec();
+    _acceptLeft = _cfg.acceptBudget;
+    if (_acceptMore) handleNewConnection();
+    for (size_t i = 0; i < _ready.size(); ++i) {
+        int fd = _ready[i].fd;
+        short re = _ready[i].revents;
+
+        if (fd == _listen_fd) {
+            if (re & POLLIN) handleNewConnection();
+        } else if (fd == _admin_fd) {
+            serveAdmin();
+        } else if (!_adminConns.empty() && _adminConns.count(fd)) {
+            writeAdmin(_adminConns[fd]);
+        } else if (!_reactors.empty() && fd == _coreWake.fd()) {
+            drainReactors();
+        } else {
+            if (re & POLLIN) handleClientRead(fd);
+            if (re & POLLOUT) handleClientWrite(fd);
+            if (re & (POLLHUP | POLLERR | POLLNVAL)) removeClient(fd);
         }
-        _pfds.swap(newpfds);
     }
+    _timers.advance(_clock->usec() / 1000);
+    evictSlow();
+    resumeReaders();
+    runThrottled();
+    admitPending();
+    flushReactors();
+    // every reply composed this tick has been copied out by now
+    _arena.reset();
+    _capture.tick(_clock->usec());
+    _metrics.record(Metrics::TICK_NS, monotonicNsec() - t0);
+    return true;
 }
 
-// Accept a pending connection, set it non-blocking, and create a Client
-// object. Send a brief notice guiding the user to authenticate.
+bool Server::idle() const {
+    return _pending.empty() && _throttled.empty() && _paused.empty() && !_acceptMore
+        && _sendqTotal == 0;
+}
+
+// Accept until the kernel queue is empty (EAGAIN), the per-tick budget is
+// spent, or our own admission queue holds a backlog's worth. Accepting is
+// cheap; the Client setup happens in admitPending().
 void Server::handleNewConnection() {
-    struct sockaddr_storage ss; socklen_t slen = sizeof(ss);
-    int cfd = accept(_listen_fd, (struct sockaddr*)&ss, &slen);
-    if (cfd < 0) return;
-    fcntl(cfd, F_SETFL, O_NONBLOCK);
-    _clients[cfd] = new Client(cfd);
-    addPollfd(cfd, POLLIN);
-    sendToClient(cfd, ":ircserv NOTICE * :Welcome to ft_irc. Please authenticate: PASS <password>\r\n");
+    _acceptMore = false;
+    while (_acceptLeft > 0 && (int)_pending.size() < _cfg.backlog) {
+        int cfd = _transport->accept(_listen_fd);
+        if (cfd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            return; // EAGAIN, or out of fds: retry on the next readiness event
+        }
+        --_acceptLeft;
+        _pending.push_back(cfd);
+        _metrics.add(Metrics::CONN_ACCEPTED);
+    }
+    _acceptMore = true;
+}
+
+// Create Clients for the oldest queued sockets.
+void Server::admitPending() {
+    for (int n = 0; n < _cfg.welcomeBudget && !_pending.empty(); ++n) {
+        int cfd = _pending.front();
+        _pending.pop_front();
+        admit(cfd);
+    }
+}
+
+// Give the socket a Client and a member ID, start polling it (or hand it
+// to its reactor) and send the welcome notice.
+Client* Server::admit(int cfd) {
+    unsigned mid;
+    if (_freeMembers.empty()) { mid = _byMember.size(); _byMember.push_back(0); }
+    else { mid = _freeMembers.back(); _freeMembers.pop_back(); }
+    Client* c = _clientPool.acquire();
+    c->reset(cfd, ++_nextConnId, mid);
+    c->setReplyStem(_prefix);
+    _byMember[mid] = c;
+    c->touch(_timers.now());
+    c->refillTokens(_clock->usec(), classOf(c).floodBurst);
+    c->timer().set(&Server::onClientTimer, this, c);
+    if (_cfg.regTimeout > 0) _timers.arm(c->timer(), _cfg.regTimeout * 1000UL);
+    else if (_cfg.pingInterval > 0) _timers.arm(c->timer(), _cfg.pingInterval * 1000UL);
+    _clients.insert(cfd, c);
+    if (_capture.active() && !_capture.opened(c->connId(), _clock->usec()))
+        _metrics.add(Metrics::CAPTURE_DROPPED);
+    if (_reactors.empty()) addPollfd(cfd, POLLIN);
+    else {
+        // hand the socket to its reactor; the core never touches it again
+        _clients.setEvents(cfd, POLLIN);
+        reactorFor(c)->post(ReactorMsg(ReactorMsg::ADOPT, cfd, c->connId()));
+    }
+    sendHint(cfd, ":ircserv NOTICE * :Welcome to ft_irc. Please authenticate: PASS <password>\r\n");
+    return c;
 }
 
 // Queue a message for a client and mark the fd POLLOUT so it will flush.
-void Server::sendToClient(int fd, const std::string& msg) {
-    std::map<int, Client*>::iterator it = _clients.find(fd);
-    if (it == _clients.end()) return;
-    Client* c = it->second;
-    c->outbuf().append(msg);
-
-    for (size_t i = 0; i < _pfds.size(); ++i) if (_pfds[i].fd == fd) {
-        _pfds[i].events = POLLIN | POLLOUT;
-        break;
+bool Server::sendToClient(int fd, const std::string& msg, SendPrio prio) {
+    return sendBytes(fd, msg.data(), msg.size(), prio);
+}
+
+bool Server::sendToClient(int fd, const MsgBuilder& msg, SendPrio prio) {
+    return sendBytes(fd, msg.data(), msg.size(), prio);
+}
+
+// Helper NOTICEs are a tutorial for humans; bots opt out with CAP.
+void Server::sendHint(int fd, const std::string& msg) {
+    Client* c = _clients.get(fd);
+    if (c && !c->hasCap(Client::CAP_NO_HINTS)) sendBytes(fd, msg.data(), msg.size(), PRIO_LOW);
+}
+
+void Server::sendHint(int fd, const MsgBuilder& msg) {
+    Client* c = _clients.get(fd);
+    if (c && !c->hasCap(Client::CAP_NO_HINTS)) sendBytes(fd, msg.data(), msg.size(), PRIO_LOW);
+}
+
+// A numeric is formatted into one bounded stack buffer and queued with a
+// single copy; see Numerics.hpp.
+bool Server::sendReply(const Client& to, Numeric id, const ReplyArg& a, const ReplyArg& b,
+                       const ReplyArg& c, const ReplyArg& d) {
+    const ReplyArg* args[MAX_REPLY_ARGS] = { &a, &b, &c, &d };
+    const std::string& stem = to.replyStem();
+    char line[MAX_REPLY_LINE];
+    size_t n = formatNumeric(line, StrView(stem.data(), stem.size()), _prefix.size(), id, args, MAX_REPLY_ARGS);
+    return sendBytes(to.fd(), line, n);
+}
+
+bool Server::sendReplyTo(int fd, const StrView& target, Numeric id, const ReplyArg& a,
+                         const ReplyArg& b, const ReplyArg& c, const ReplyArg& d) {
+    const ReplyArg* args[MAX_REPLY_ARGS] = { &a, &b, &c, &d };
+    // ":server 000 target ", clipped like the reply itself
+    char stem[MAX_REPLY_LINE];
+    size_t n = _prefix.size(), t = target.n;
+    if (n + 4 + t + 1 > sizeof(stem)) t = sizeof(stem) - n - 5;
+    std::memcpy(stem, _prefix.data(), n);
+    std::memcpy(stem + n, "000 ", 4);
+    std::memcpy(stem + n + 4, target.p, t);
+    stem[n + 4 + t] = ' ';
+    char line[MAX_REPLY_LINE];
+    size_t len = formatNumeric(line, StrView(stem, n + 4 + t + 1), n, id, args, MAX_REPLY_ARGS);
+    return sendBytes(fd, line, len);
+}
+
+void Server::numericStem(MsgBuilder& m, const Client& to, Numeric id) const {
+    const std::string& stem = to.replyStem();
+    size_t at = _prefix.size();
+    m.append(stem.data(), at);
+    m.append(NUMERICS[id].code, 3);
+    m.append(stem.data() + at + 3, stem.size() - at - 3);
+}
+
+// The bytes are copied into the queue's tail chunk, so the caller's buffer
+// (string or arena) may go away right after.
+bool Server::sendBytes(int fd, const char* p, size_t n, SendPrio prio) {
+    Client* c = _clients.get(fd);
+    if (!c || !enqueueOk(c, n, prio)) return false;
+    c->outbuf().append(p, n);
+    _sendqTotal += n;
+    _metrics.add(Metrics::MSGS_OUT);
+    _metrics.add(Metrics::BYTES_QUEUED, n);
+    setPollEvents(fd, readMask(c) | POLLOUT);
+    return true;
+}
+
+// Same, but queue a reference to an already-built shared segment.
+bool Server::sendToClient(int fd, const SegmentRef& msg, SendPrio prio) {
+    Client* c = _clients.get(fd);
+    if (!c || !enqueueOk(c, msg.size(), prio)) return false;
+    c->outbuf().push(msg);
+    _sendqTotal += msg.size();
+    _metrics.add(Metrics::MSGS_OUT);
+    _metrics.add(Metrics::BYTES_QUEUED, msg.size());
+    setPollEvents(fd, readMask(c) | POLLOUT);
+    return true;
+}
+
+const ServerConfig::ConnClass& Server::classOf(const Client* c) const {
+    return _cfg.classes[c->isRegistered() ? ServerConfig::CLASS_USER : ServerConfig::CLASS_UNREGISTERED];
+}
+
+// In reactor mode most of the backlog sits in the reactor, which publishes
+// its per-fd count; bytes in flight in a mailbox are briefly not counted.
+size_t Server::sendqOf(const Client* c) const {
+    size_t n = c->sendqBytes();
+    if (!_reactors.empty()) n += reactorFor(c)->queued(c->fd());
+    return n;
+}
+
+// A shared broadcast segment counts once per recipient, as with any ircd's
+// SendQ: it bounds what each client may owe, not the allocator's footprint.
+size_t Server::sendqTotal() const {
+    size_t n = _sendqTotal;
+    for (size_t i = 0; i < _reactors.size(); ++i) n += _reactors[i]->queuedTotal();
+    return n;
+}
+
+// Graduated response, cheapest first: pause input at the soft limit, shed
+// low-priority lines at the drop limit, evict at the hard limit. When the
+// global budget is spent, low-priority lines stop everywhere and clients
+// already past their soft limit are the ones evicted.
+bool Server::enqueueOk(Client* c, size_t n, SendPrio prio) {
+    if (c->evicting()) return false;
+    const ServerConfig::ConnClass& k = classOf(c);
+    size_t q = sendqOf(c) + n;
+    bool overBudget = sendqTotal() + n > _cfg.sendqTotal;
+    if (prio == PRIO_LOW && (q > k.sendqDrop || overBudget)) {
+        _metrics.add(Metrics::SENDQ_DROPPED);
+        return false;
+    }
+    if (q > k.sendqHard || (overBudget && q > k.sendqSoft)) {
+        c->setEvicting();
+        _evict.push_back(c->fd());
+        return false;
     }
+    if (q > k.sendqSoft) setReadPaused(c, true);
+    return true;
 }
 
-// Attempt to flush as much of the client's out buffer as the kernel accepts.
-// On error, disconnect the client.
-void Server::handleClientWrite(int fd) {
-    std::map<int, Client*>::iterator it = _clients.find(fd);
-    if (it == _clients.end()) return;
-    Client* c = it->second;
-    std::string& ob = c->outbuf();
-    if (ob.empty()) {
-        setPollEvents(fd, POLLIN);
-        return;
+short Server::readMask(const Client* c) const {
+    return c->readPaused() ? 0 : POLLIN;
+}
+
+// Single-threaded: drop POLLIN from the cached mask. Reactor mode: the
+// reactor owns the socket, so tell it to stop (or restart) reading.
+void Server::setReadPaused(Client* c, bool on) {
+    if (c->readPaused() == on) return;
+    c->setReadPaused(on);
+    if (on) _paused.push_back(c->fd());
+    if (_reactors.empty())
+        setPollEvents(c->fd(), readMask(c) | (_clients.events(c->fd()) & POLLOUT));
+    else
+        reactorFor(c)->post(ReactorMsg(on ? ReactorMsg::PAUSE : ReactorMsg::RESUME, c->fd(), c->connId()));
+}
+
+// Resume with hysteresis (half the soft limit) so a client hovering at the
+// limit is not toggled every tick, then run the lines held back meanwhile.
+void Server::resumeReaders() {
+    for (size_t i = 0; i < _paused.size(); ) {
+        int fd = _paused[i];
+        Client* c = _clients.get(fd);
+        if (c && c->readPaused() && !c->evicting() && sendqOf(c) > classOf(c).sendqSoft / 2) {
+            ++i;
+            continue;
+        }
+        _paused[i] = _paused.back();
+        _paused.pop_back();
+        if (!c || !c->readPaused() || c->evicting()) continue;
+        setReadPaused(c, false);
+        processInput(fd, c);
     }
-    ssize_t n = ::send(fd, ob.data(), ob.size(), 0);
-    if (n > 0) {
-        ob.erase(0, n);
+}
+
+void Server::evictSlow() {
+    for (size_t i = 0; i < _evict.size(); ++i) {
+        Client* c = _clients.get(_evict[i]);
+        if (c && c->evicting()) {
+            _metrics.add(Metrics::EVICT_SENDQ);
+            removeClient(_evict[i], "Excess SendQ");
+        }
     }
-    if (n < 0 && (errno != EWOULDBLOCK && errno != EAGAIN)) {
-        removeClient(fd);
-        return;
+    _evict.clear();
+}
+
+// Flush as much of the client's out buffer as the transport accepts. We keep
+// writing until the buffer is empty or the socket would block, which is
+// required for edge-triggered pollers. On error, disconnect the client.
+void Server::handleClientWrite(int fd) {
+    Client* c = _clients.get(fd);
+    if (!c) return;
+    OutQueue& ob = c->outbuf();
+    struct iovec iov[OutQueue::IOV_BATCH];
+    while (!ob.empty()) {
+        ssize_t n = _transport->writev(fd, iov, ob.gather(iov, OutQueue::IOV_BATCH));
+        if (n < 0) {
+            if (errno == EWOULDBLOCK || errno == EAGAIN) return;
+            if (errno == EINTR) continue;
+            removeClient(fd);
+            return;
+        }
+        ob.consume((size_t)n);
+        _sendqTotal -= (size_t)n;
+        _metrics.add(Metrics::BYTES_OUT, n);
+        _metrics.record(Metrics::WRITE_BYTES, n);
     }
-    if (ob.empty()) setPollEvents(fd, POLLIN);
+    setPollEvents(fd, readMask(c));
 }
 
 // Read available bytes into the client's input buffer, split complete lines
-// by CRLF, and dispatch each line to CommandHandler.
+// by CRLF, and dispatch each line to CommandHandler. Edge-triggered pollers
+// only report new data once, so in that mode we read until EAGAIN.
 void Server::handleClientRead(int fd) {
-    char buf[4096];
-    ssize_t n = recv(fd, buf, sizeof(buf), 0);
-    if (n <= 0) {
-        removeClient(fd);
+    do {
+        char buf[4096];
+        ssize_t n = _transport->recv(fd, buf, sizeof(buf));
+        if (n < 0 && (errno == EWOULDBLOCK || errno == EAGAIN || errno == EINTR)) return;
+        if (n <= 0) {
+            removeClient(fd);
+            return;
+        }
+        Client* c = _clients.get(fd);
+        if (!c) return;
+        _metrics.add(Metrics::BYTES_IN, n);
+        _metrics.record(Metrics::READ_BYTES, n);
+        c->inbuf().append(buf, n);
+        // a paused client is resumed by resumeReaders(), which re-arms the fd
+        if (!processInput(fd, c) || c->readPaused()) return;
+    } while (_poller->edgeTriggered());
+}
+
+// Take complete CRLF-terminated lines off the input buffer and dispatch them.
+// Lines are parsed in place; the consumed prefix is dropped once at the end.
+// Stops early while the client's input is paused or its token bucket is
+// empty; the rest waits in inbuf.
+bool Server::processInput(int fd, Client* c) {
+    const char* line;
+    size_t len;
+    IrcLine msg;
+    unsigned long now = _clock->usec();
+    while (!c->readPaused() && !c->evicting() && !c->throttled() && c->inbuf().next(line, len)) {
+        c->touch(now / 1000);
+        if (!parseIrcLine(line, len, msg)) continue;
+        // class looked up per line: registering mid-batch moves to CLASS_USER
+        const ServerConfig::ConnClass& k = classOf(c);
+        if (!c->takeTokens(CommandHandler::lineCost(msg), now, k.floodRate, k.floodBurst)) {
+            c->inbuf().unread();
+            c->setThrottled(true);
+            _throttled.push_back(fd);
+            _metrics.add(Metrics::LINES_THROTTLED);
+            break;
+        }
+        _metrics.add(Metrics::LINES_IN);
+        if (_capture.active() && !_capture.line(c->connId(), now, line, len))
+            _metrics.add(Metrics::CAPTURE_DROPPED);
+        _dispatcher->handleLine(*c, msg);
+        // the command may have disconnected this client (QUIT, errors)
+        if (_clients.get(fd) != c) return false;
+    }
+    c->inbuf().compact();
+    if (c->inbuf().pending() > classOf(c).floodBacklog) {
+        _metrics.add(Metrics::EVICT_FLOOD);
+        removeClient(fd, "Excess Flood");
+        return false;
+    }
+    return true;
+}
+
+void Server::onClientTimer(void* srv, Timer& t) {
+    static_cast<Server*>(srv)->clientTimer(static_cast<Client*>(t.arg()));
+}
+
+// Any line counts as a reply to our PING, so busy clients are never pinged
+// and the timer only re-arms lazily for the time remaining.
+void Server::clientTimer(Client* c) {
+    if (!c->isRegistered()) {
+        removeClient(c->fd(), "Registration timeout");
+        return;
+    }
+    if (_cfg.pingInterval <= 0) return;
+    if (c->pingPending()) {
+        std::ostringstream os;
+        os << "Ping timeout: " << _cfg.pingTimeout << " seconds";
+        removeClient(c->fd(), os.str());
         return;
     }
-    std::map<int, Client*>::iterator it = _clients.find(fd);
-    if (it == _clients.end()) return;
-    Client* c = it->second;
-    c->inbuf().append(buf, n);
+    unsigned long interval = _cfg.pingInterval * 1000UL;
+    unsigned long now = _timers.now();
+    unsigned long idle = now > c->lastActive() ? now - c->lastActive() : 0;
+    if (idle < interval) {
+        _timers.arm(c->timer(), interval - idle);
+        return;
+    }
+    MsgBuilder m(_arena);
+    m << "PING :" << _servername << "\r\n";
+    sendToClient(c->fd(), m);
+    c->setPingPending(true);
+    _timers.arm(c->timer(), (_cfg.pingTimeout > 0 ? _cfg.pingTimeout : 1) * 1000UL);
+}
 
-    size_t pos;
-    CommandHandler dispatcher(*this);
-    while ((pos = c->inbuf().find("\r\n")) != std::string::npos) {
-        std::string line = c->inbuf().substr(0, pos);
-        c->inbuf().erase(0, pos + 2);
-        dispatcher.handleLine(*c, line);
+// Entries added while we run (a client throttled again) wait for the next
+// tick, so one pass visits each waiting client once.
+void Server::runThrottled() {
+    size_t n = _throttled.size();
+    for (size_t i = 0; i < n; ++i) {
+        int fd = _throttled[i];
+        Client* c = _clients.get(fd);
+        if (!c || !c->throttled()) continue; // gone, or a stale duplicate
+        c->setThrottled(false);
+        processInput(fd, c);
     }
+    _throttled.erase(_throttled.begin(), _throttled.begin() + n);
 }
 
 // Find a channel by case-insensitive name or create it (and notify the bot).
 Channel* Server::getOrCreateChannel(const std::string& name) {
-    std::string key = toLower(name);
-    std::map<std::string, Channel*>::iterator it = _channels.find(key);
-    if (it != _channels.end()) return it->second;
-    Channel* ch = new Channel(name);
-    _channels[key] = ch;
+    Channel* ch = findChannel(name);
+    if (ch) return ch;
+    Atom a = _atoms.intern(name);
+    if (_channels.size() < _atoms.limit()) _channels.resize(_atoms.limit(), 0);
+    ch = _channelPool.acquire();
+    ch->reset(name, a);
+    _channels[a] = ch;
     // NEW: have the bot “join” (announce + help)
     if (_bot) _bot->onChannelCreated(name);
     return ch;
 }
 
-<<<<<<< Updated upstream
-
-=======
 // Lookup a channel by name; return NULL if missing.
->>>>>>> Stashed changes
 Channel* Server::findChannel(const std::string& name) {
-    std::string key = toLower(name);
-    std::map<std::string, Channel*>::iterator it = _channels.find(key);
-    if (it != _channels.end()) return it->second;
-    return 0;
+    return channelByAtom(_atoms.find(name));
+}
+
+Channel* Server::findChannel(const char* p, size_t n) {
+    return channelByAtom(_atoms.find(p, n));
+}
+
+Channel* Server::channelByAtom(Atom a) const {
+    return a < _channels.size() ? _channels[a] : 0;
 }
 
-// Linear search for a client by case-insensitive nickname.
+// Case-insensitive nick lookup: one probe in the atom table.
 Client* Server::findClientByNick(const std::string& nick) {
-    for (std::map<int, Client*>::iterator it = _clients.begin(); it != _clients.end(); ++it) {
-        if (toLower(it->second->nick()) == toLower(nick)) return it->second;
+    return findClientByNick(nick.data(), nick.size());
+}
+
+Client* Server::findClientByNick(const char* p, size_t n) {
+    Atom a = _atoms.find(p, n);
+    return a < _nickOwner.size() ? _nickOwner[a] : 0;
+}
+
+Client* Server::clientByMember(unsigned id) const {
+    return id < _byMember.size() ? _byMember[id] : 0;
+}
+
+const std::string& Server::memberNick(void* srv, unsigned id) {
+    static const std::string none;
+    Client* c = static_cast<Server*>(srv)->clientByMember(id);
+    return c ? c->nick() : none;
+}
+
+// Re-key the client under its new nick. A pure case change ("bob" -> "Bob")
+// interns to the same atom and just updates the stored spelling.
+void Server::setClientNick(Client& c, const std::string& nick) {
+    Atom a = _atoms.intern(nick);
+    Atom old = c.nickAtom();
+    if (old) {
+        if (_nickOwner[old] == &c) _nickOwner[old] = 0;
+        _atoms.release(old);
     }
-    return 0;
+    if (_nickOwner.size() < _atoms.limit()) _nickOwner.resize(_atoms.limit(), 0);
+    _nickOwner[a] = &c;
+    c.setNick(nick, a);
+    c.setReplyStem(_prefix);
+    const std::vector<Atom>& chans = c.channels();
+    for (size_t i = 0; i < chans.size(); ++i)
+        if (Channel* ch = channelByAtom(chans[i])) ch->invalidateNames();
 }
 
 // Convenience: run a server-injected command as if 'nickFrom' sent it.
@@ -245,18 +756,60 @@ void Server::sendServerAs(const std::string& nickFrom, const std::string& comman
 }
 
 // Send a prepared message to all channel members, optionally skipping one fd.
+// The bytes are copied once; every member queue shares the same segment.
 void Server::broadcast(const std::string& chan, const std::string& msg, int except_fd) {
-    Channel* c = findChannel(chan);
-    if (!c) return;
-    const std::set<int>& mem = c->members();
-    for (std::set<int>::const_iterator it = mem.begin(); it != mem.end(); ++it) {
-        if (*it == except_fd) continue;
-        sendToClient(*it, msg);
+    broadcast(findChannel(chan), msg, except_fd);
+}
+
+void Server::broadcast(Channel* c, const std::string& msg, int except_fd) {
+    if (c) broadcastSegment(c, SegmentRef(msg), except_fd);
+}
+
+void Server::broadcast(Channel* c, const MsgBuilder& msg, int except_fd) {
+    if (c) broadcastSegment(c, SegmentRef(Segment::create(msg.data(), msg.size())), except_fd);
+}
+
+void Server::broadcastSegment(Channel* c, const SegmentRef& seg, int except_fd) {
+    const std::vector<Channel::Member>& mem = c->entries();
+    for (size_t i = 0; i < mem.size(); ++i) {
+        if (!(mem[i].roles & Channel::JOINED)) continue;
+        Client* m = _byMember[mem[i].id];
+        if (m->fd() != except_fd) deliver(m, seg);
+    }
+}
+
+void Server::broadcastPeers(const Client& c, const MsgBuilder& msg, int except_fd) {
+    if (!c.channels().empty())
+        broadcastPeers(c, SegmentRef(Segment::create(msg.data(), msg.size())), except_fd);
+}
+
+// Walk c's channels with one pass of visit marks: members already reached
+// through an earlier shared channel are skipped in O(1), no set is built.
+void Server::broadcastPeers(const Client& c, const SegmentRef& seg, int except_fd) {
+    _peerMarks.next();
+    const std::vector<Atom>& chans = c.channels();
+    for (size_t k = 0; k < chans.size(); ++k) {
+        Channel* ch = channelByAtom(chans[k]);
+        if (!ch) continue;
+        const std::vector<Channel::Member>& mem = ch->entries();
+        for (size_t i = 0; i < mem.size(); ++i) {
+            if (!(mem[i].roles & Channel::JOINED)) continue;
+            if (!_peerMarks.visit(mem[i].id)) continue;
+            Client* m = _byMember[mem[i].id];
+            if (m->fd() != except_fd) deliver(m, seg);
+        }
     }
 }
 
-<<<<<<< Updated upstream
-=======
+void Server::deliver(Client* m, const SegmentRef& seg) {
+    if (!enqueueOk(m, seg.size(), PRIO_NORMAL)) return;
+    m->outbuf().push(seg);
+    _sendqTotal += seg.size();
+    _metrics.add(Metrics::MSGS_OUT);
+    _metrics.add(Metrics::BYTES_QUEUED, seg.size());
+    setPollEvents(m->fd(), readMask(m) | POLLOUT);
+}
+
 // ---- when a member leaves a channel (PART/QUIT/KICK) ----
 // Handle state after a member leaves: auto-reop if needed, and delete the
 // channel if it is now empty.
@@ -266,18 +819,29 @@ void Server::onMemberLeftChannel(Channel* ch, const std::string& lower_key, cons
     if (!ch) return;
     // If no operators remain, auto-promote first member
     autoReopIfNone(ch);
-    // If empty, delete channel
-    maybeDeleteChannel(toLower(ch->name()));
+    // If empty, delete channel (the atom text is the folded key)
+    maybeDeleteChannel(_atoms.text(ch->atom()));
 }
 
-// If the channel has no members, free it and remove from the map.
+// Clear the role and the client's record together; the record holds an atom
+// reference, released here (the channel keeps its own).
+void Server::revokeInvite(Client& c, Channel* ch) {
+    ch->consumeInvite(c.memberId());
+    if (c.dropInvite(ch->atom())) _atoms.release(ch->atom());
+}
+
+// If the channel has no members, free it and remove it from the index.
 void Server::maybeDeleteChannel(const std::string& lower_key) {
-    std::map<std::string, Channel*>::iterator it = _channels.find(lower_key);
-    if (it == _channels.end()) return;
-    Channel* ch = it->second;
-    if (ch->members().empty()) {
-        delete ch;
-        _channels.erase(it);
+    Channel* ch = findChannel(lower_key);
+    if (!ch) return;
+    if (ch->memberCount() == 0) {
+        Atom a = ch->atom();
+        // what is left are invites to non-members: they die with the channel
+        const std::vector<Channel::Member>& mem = ch->entries();
+        while (!mem.empty()) revokeInvite(*_byMember[mem.back().id], ch);
+        _channels[a] = 0;
+        _channelPool.release(ch);
+        _atoms.release(a); // lower_key may be this atom's text; release last
     }
 }
 
@@ -285,16 +849,15 @@ void Server::maybeDeleteChannel(const std::string& lower_key) {
 // the channel currently has none.
 void Server::autoReopIfNone(Channel* ch) {
     if (!ch) return;
-    if (ch->members().empty()) return;
+    if (ch->memberCount() == 0) return;
     if (ch->hasAnyOp()) return;
 
-    // Promote the first member we can find (by fd order)
-    const std::set<int>& mem = ch->members();
-    for (std::set<int>::const_iterator it = mem.begin(); it != mem.end(); ++it) {
-        std::map<int, Client*>::iterator cit = _clients.find(*it);
-        if (cit == _clients.end() || !cit->second) continue;
-        Client* m = cit->second;
-        ch->addOp(m->nick());
+    // Promote the first joined member in member-ID order
+    const std::vector<Channel::Member>& mem = ch->entries();
+    for (size_t i = 0; i < mem.size(); ++i) {
+        if (!(mem[i].roles & Channel::JOINED)) continue;
+        Client* m = _byMember[mem[i].id];
+        ch->setOp(m->memberId(), true);
         std::string line = ":" + _servername + " MODE " + ch->name() + " +o " + m->nick() + "\r\n";
         broadcast(ch->name(), line, -1);
         break;
@@ -303,38 +866,81 @@ void Server::autoReopIfNone(Channel* ch) {
 
 // Disconnect a client: broadcast QUIT to channels, remove membership and ops,
 // close the socket, and free the Client object.
->>>>>>> Stashed changes
-void Server::removeClient(int fd) {
-    std::map<int, Client*>::iterator it = _clients.find(fd);
-    if (it == _clients.end()) return;
-    Client* c = it->second;
-
-    for (std::set<std::string>::const_iterator sit = c->channels().begin(); sit != c->channels().end(); ++sit) {
-        Channel* ch = findChannel(*sit);
+void Server::removeClient(int fd, const std::string& reason) {
+    Client* c = _clients.get(fd);
+    if (!c) return;
+    _metrics.add(Metrics::CONN_CLOSED);
+    if (_capture.active() && !_capture.closed(c->connId(), _clock->usec()))
+        _metrics.add(Metrics::CAPTURE_DROPPED);
+
+    // the member ID is about to be reused; it must not inherit invites
+    while (!c->invites().empty()) revokeInvite(*c, channelByAtom(c->invites().back()));
+
+    // every peer hears the QUIT once, before any auto-reop it triggers
+    const std::vector<Atom>& chans = c->channels();
+    if (!chans.empty()) {
+        MsgBuilder m(_arena);
+        m << ':' << c->nick() << " QUIT :" << reason << "\r\n";
+        broadcastPeers(*c, m, fd);
+    }
+    for (size_t i = 0; i < chans.size(); ++i) {
+        Channel* ch = channelByAtom(chans[i]);
         if (ch) {
-            ch->removeMember(fd);
-            broadcast(*sit, ":" + c->nick() + " QUIT :Client disconnected\r\n", fd);
+            ch->removeMember(c->memberId());
+            onMemberLeftChannel(ch, _atoms.text(chans[i]), c->nick());
         }
     }
+    if (_ft) _ft->dropClient(fd);
+
+    if (_reactors.empty()) {
+        _poller->remove(fd);
+        _transport->close(fd);
+    } else {
+        // the owning reactor closes the socket; until then the fd cannot be
+        // reused, so no new connection can collide with this slot
+        reactorFor(c)->post(ReactorMsg(ReactorMsg::CLOSE, fd, c->connId()));
+    }
 
-    close(fd);
-    for (size_t i = 0; i < _pfds.size(); ++i) if (_pfds[i].fd == fd) _pfds[i].fd = -1;
-
-    delete c;
-    _clients.erase(it);
+    if (c->nickAtom()) {
+        if (_nickOwner[c->nickAtom()] == c) _nickOwner[c->nickAtom()] = 0;
+        _atoms.release(c->nickAtom());
+    }
+    _byMember[c->memberId()] = 0;
+    _freeMembers.push_back(c->memberId());
+    _sendqTotal -= c->sendqBytes();
+    _clients.erase(fd);
+    _clientPool.release(c);
 }
 
 // Close the listening socket and free all Clients and Channels. Called on
 // orderly shutdown and from the destructor.
 void Server::closeAndCleanup() {
-    if (_listen_fd != -1) close(_listen_fd);
-    for (std::map<int, Client*>::iterator it = _clients.begin(); it != _clients.end(); ++it) {
-        close(it->first);
-        delete it->second;
+    if (_listen_fd != -1) { if (_poller) _poller->remove(_listen_fd); _transport->close(_listen_fd); }
+    if (_admin_fd != -1) {
+        if (_poller) _poller->remove(_admin_fd);
+        close(_admin_fd);
+        unlink(_cfg.adminSocket.c_str());
+        _admin_fd = -1;
     }
-    _clients.clear();
-    for (std::map<std::string, Channel*>::iterator ct = _channels.begin(); ct != _channels.end(); ++ct) {
-        delete ct->second;
+    while (!_adminConns.empty()) closeAdmin(_adminConns.begin()->second);
+    for (size_t i = 0; i < _pending.size(); ++i) _transport->close(_pending[i]);
+    _pending.clear();
+    // reactors close the sockets they own when stopped
+    for (size_t i = 0; i < _reactors.size(); ++i) delete _reactors[i];
+    bool ownSockets = _reactors.empty();
+    _reactors.clear();
+    for (size_t i = 0; i < _clients.size(); ++i) {
+        if (ownSockets) _transport->close(_clients.fdAt(i));
+        _clientPool.release(_clients.at(i));
     }
+    _clients.clear();
+    _nickOwner.clear();
+    _byMember.clear();
+    _freeMembers.clear();
+    _paused.clear();
+    _evict.clear();
+    _throttled.clear();
+    _sendqTotal = 0;
+    for (size_t i = 0; i < _channels.size(); ++i) _channelPool.release(_channels[i]);
     _channels.clear();
 }
@@ -0,0 +1,138 @@
+#include "TimerWheel.hpp"
+
+static const unsigned long MASK = TimerWheel::SLOTS - 1;
+
+// ticks covered by one slot of level l
+static unsigned long span(int l) { return 1UL << (TimerWheel::BITS * l); }
+
+Timer::Timer()
+: _fn(0), _ctx(0), _arg(0), _expires(0), _prev(0), _next(0), _wheel(0), _level(0) {}
+
+Timer::~Timer() { cancel(); }
+
+void Timer::set(Fn fn, void* ctx, void* arg) {
+    _fn = fn;
+    _ctx = ctx;
+    _arg = arg;
+}
+
+void Timer::cancel() {
+    if (armed()) _wheel->unlink(*this);
+}
+
+// Slot heads are empty circular lists: they point at themselves.
+TimerWheel::TimerWheel(unsigned long nowMs): _total(0), _now(nowMs) {
+    for (int l = 0; l < LEVELS; ++l) {
+        _count[l] = 0;
+        for (int i = 0; i < SLOTS; ++i) _slots[l][i]._prev = _slots[l][i]._next = &_slots[l][i];
+    }
+}
+
+TimerWheel::~TimerWheel() {
+    for (int l = 0; l < LEVELS; ++l)
+        for (int i = 0; i < SLOTS; ++i) {
+            Timer& head = _slots[l][i];
+            while (head._next != &head) unlink(*head._next);
+            head._prev = head._next = 0; // heads are Timers too: not "armed"
+        }
+}
+
+// A zero delay still waits for the next tick, so a callback re-arming
+// itself cannot spin inside one advance().
+void TimerWheel::arm(Timer& t, unsigned long delayMs) {
+    t.cancel();
+    t._expires = _now + (delayMs ? delayMs : 1);
+    t._wheel = this;
+    place(t);
+}
+
+// File t by distance from now: level l holds timers due within 64^(l+1)
+// ticks, indexed by the level-l digit of the expiry. Beyond the top level
+// the timer waits in the farthest top slot and is re-filed on cascade.
+void TimerWheel::place(Timer& t) {
+    unsigned long at = t._expires < _now ? _now : t._expires;
+    unsigned long delta = at - _now;
+    int l = 0;
+    while (l < LEVELS - 1 && delta >= span(l + 1)) ++l;
+    if (delta >= span(LEVELS - 1) * SLOTS) at = _now + span(LEVELS - 1) * SLOTS - 1;
+    Timer& head = _slots[l][(at >> (BITS * l)) & MASK];
+    t._level = l;
+    t._prev = head._prev;
+    t._next = &head;
+    head._prev->_next = &t;
+    head._prev = &t;
+    ++_count[l];
+    ++_total;
+}
+
+void TimerWheel::unlink(Timer& t) {
+    t._prev->_next = t._next;
+    t._next->_prev = t._prev;
+    t._prev = t._next = 0;
+    --_count[t._level];
+    --_total;
+}
+
+void TimerWheel::cascade(int level, unsigned idx) {
+    Timer& head = _slots[level][idx];
+    while (head._next != &head) {
+        Timer& t = *head._next;
+        unlink(t);
+        place(t);
+    }
+}
+
+// Process tick t: re-file the upper slots whose window starts here (highest
+// first, so their timers can land in a lower slot cascaded next), then fire
+// the level-0 slot. Callbacks may arm or cancel any timer, including the
+// ones still waiting in this slot.
+void TimerWheel::tick(unsigned long t) {
+    _now = t;
+    for (int l = LEVELS - 1; l > 0; --l)
+        if ((t & (span(l) - 1)) == 0) cascade(l, (t >> (BITS * l)) & MASK);
+    Timer& head = _slots[0][t & MASK];
+    while (head._next != &head) {
+        Timer& x = *head._next;
+        unlink(x);
+        if (x._fn) x._fn(x._ctx, x);
+    }
+}
+
+// Step tick by tick only while level 0 has timers; otherwise jump to the
+// next boundary at which the lowest non-empty level cascades.
+void TimerWheel::advance(unsigned long nowMs) {
+    while (_now < nowMs) {
+        if (_total == 0) { _now = nowMs; break; }
+        unsigned long next = _now + 1;
+        if (_count[0] == 0) {
+            int l = 1;
+            while (l < LEVELS - 1 && _count[l] == 0) ++l;
+            next = (_now | (span(l) - 1)) + 1;
+        }
+        if (next > nowMs) { _now = nowMs; break; }
+        tick(next);
+    }
+}
+
+// Level 0 is exact; for upper levels the next cascade boundary is a safe
+// lower bound (their timers cannot be due before it).
+int TimerWheel::nextTimeout(unsigned long nowMs) const {
+    if (_total == 0) return -1;
+    unsigned long due = 0;
+    bool found = false;
+    if (_count[0]) {
+        for (unsigned long k = 1; k <= (unsigned long)SLOTS; ++k) {
+            const Timer& head = _slots[0][(_now + k) & MASK];
+            if (head._next != &head) { due = _now + k; found = true; break; }
+        }
+    }
+    int l = 1;
+    while (l < LEVELS && _count[l] == 0) ++l;
+    if (l < LEVELS) {
+        unsigned long b = (_now | (span(l) - 1)) + 1;
+        if (!found || b < due) { due = b; found = true; }
+    }
+    if (due <= nowMs) return 0;
+    unsigned long ms = due - nowMs;
+    return ms > (1UL << 30) ? (1 << 30) : (int)ms;
+}
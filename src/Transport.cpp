@@ -0,0 +1,271 @@
+#include "Transport.hpp"
+
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL 0
+#endif
+
+// ---------------------------------------------------------------- sockets
+
+const char* SocketTransport::name() const { return "socket"; }
+
+// Non-blocking listening socket on the first address that binds.
+int SocketTransport::listen(const std::string& port, int backlog) {
+    struct addrinfo hints; std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    struct addrinfo* res = 0;
+    int err = getaddrinfo(NULL, port.c_str(), &hints, &res);
+    if (err != 0) {
+        std::cerr << "getaddrinfo: " << gai_strerror(err) << std::endl;
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo* p = res; p; p = p->ai_next) {
+        fd = ::socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+        if (fd < 0) continue;
+
+        int yes = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+        if (bind(fd, p->ai_addr, p->ai_addrlen) == 0 && ::listen(fd, backlog) == 0) break;
+        ::close(fd); fd = -1;
+    }
+    freeaddrinfo(res);
+
+    if (fd < 0) {
+        std::cerr << "Failed to bind/listen" << std::endl;
+        return -1;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+int SocketTransport::accept(int listenFd) {
+    struct sockaddr_storage ss; socklen_t slen = sizeof(ss);
+#ifdef __linux__
+    return accept4(listenFd, (struct sockaddr*)&ss, &slen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+    int fd = ::accept(listenFd, (struct sockaddr*)&ss, &slen);
+    if (fd >= 0) fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+#endif
+}
+
+ssize_t SocketTransport::recv(int fd, char* buf, size_t len) { return ::recv(fd, buf, len, 0); }
+
+// sendmsg() rather than writev() for MSG_NOSIGNAL: a reset peer is EPIPE,
+// not a SIGPIPE.
+ssize_t SocketTransport::writev(int fd, const struct iovec* iov, int cnt) {
+    struct msghdr mh;
+    std::memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = const_cast<struct iovec*>(iov);
+    mh.msg_iovlen = cnt;
+    return ::sendmsg(fd, &mh, MSG_NOSIGNAL);
+}
+
+void SocketTransport::close(int fd) { ::close(fd); }
+
+Poller* SocketTransport::createPoller(const std::string& kind) { return Poller::create(kind); }
+
+// ---------------------------------------------------------------- memory
+
+MemoryTransport::Conn::Conn()
+: inOff(0), written(0), events(0), used(false), listener(false), accepted(false),
+  serverOpen(false), clientOpen(false), marked(false) {}
+
+MemoryTransport::MemoryTransport(): _listen(-1), _open(0), _unread(0), _keep(true) {}
+
+const char* MemoryTransport::name() const { return "memory"; }
+
+int MemoryTransport::alloc() {
+    int fd;
+    if (_free.empty()) { fd = (int)_conns.size(); _conns.push_back(Conn()); }
+    else { fd = _free.back(); _free.pop_back(); }
+    _conns[fd].used = true;
+    ++_open;
+    return fd;
+}
+
+// Both ends are closed: reset the slot (dropping buffer memory) for reuse.
+// The mark stays: the slot may still sit on _ready, and must not go there twice.
+void MemoryTransport::release(int fd) {
+    bool marked = _conns[fd].marked;
+    _conns[fd] = Conn();
+    _conns[fd].marked = marked;
+    _free.push_back(fd);
+    --_open;
+}
+
+void MemoryTransport::mark(int fd) {
+    Conn& c = _conns[fd];
+    if (c.marked) return;
+    c.marked = true;
+    _ready.push_back(fd);
+}
+
+short MemoryTransport::revents(int fd) const {
+    if (!valid(fd)) return 0;
+    const Conn& c = _conns[fd];
+    short r = 0;
+    if (c.listener) r = _backlog.empty() ? 0 : POLLIN;
+    else if (c.serverOpen) {
+        if (c.inOff < c.in.size() || !c.clientOpen) r |= POLLIN;
+        r |= POLLOUT;
+    }
+    return r & c.events;
+}
+
+int MemoryTransport::listen(const std::string&, int) {
+    if (_listen < 0) {
+        _listen = alloc();
+        _conns[_listen].listener = true;
+        _conns[_listen].serverOpen = true;
+    }
+    return _listen;
+}
+
+int MemoryTransport::accept(int listenFd) {
+    if (listenFd != _listen || _listen < 0) { errno = EBADF; return -1; }
+    if (_backlog.empty()) { errno = EAGAIN; return -1; }
+    int fd = _backlog.front();
+    _backlog.pop_front();
+    _conns[fd].accepted = true;
+    _conns[fd].serverOpen = true;
+    return fd;
+}
+
+ssize_t MemoryTransport::recv(int fd, char* buf, size_t len) {
+    if (!valid(fd) || !_conns[fd].serverOpen) { errno = EBADF; return -1; }
+    Conn& c = _conns[fd];
+    size_t left = c.in.size() - c.inOff;
+    if (left == 0) {
+        if (!c.clientOpen) return 0;
+        errno = EAGAIN;
+        return -1;
+    }
+    size_t n = left < len ? left : len;
+    std::memcpy(buf, c.in.data() + c.inOff, n);
+    c.inOff += n;
+    _unread -= n;
+    if (c.inOff == c.in.size()) { std::string().swap(c.in); c.inOff = 0; }
+    return (ssize_t)n;
+}
+
+ssize_t MemoryTransport::writev(int fd, const struct iovec* iov, int cnt) {
+    if (!valid(fd) || !_conns[fd].serverOpen) { errno = EBADF; return -1; }
+    Conn& c = _conns[fd];
+    if (!c.clientOpen) { errno = EPIPE; return -1; }
+    size_t total = 0;
+    for (int i = 0; i < cnt; ++i) {
+        if (_keep) c.out.append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+        total += iov[i].iov_len;
+    }
+    c.written += total;
+    return (ssize_t)total;
+}
+
+void MemoryTransport::close(int fd) {
+    if (!valid(fd) || !_conns[fd].serverOpen) return;
+    Conn& c = _conns[fd];
+    if (c.listener) {
+        _listen = -1;
+        release(fd);
+        return;
+    }
+    c.serverOpen = false;
+    _unread -= c.in.size() - c.inOff;
+    c.in.clear();
+    c.inOff = 0;
+    if (!c.clientOpen) release(fd);
+}
+
+int MemoryTransport::connect() {
+    if (_listen < 0) return -1;
+    int fd = alloc();
+    _conns[fd].clientOpen = true;
+    _backlog.push_back(fd);
+    mark(_listen);
+    return fd;
+}
+
+void MemoryTransport::send(int fd, const char* p, size_t n) {
+    if (!valid(fd) || !_conns[fd].clientOpen) return;
+    Conn& c = _conns[fd];
+    if (!c.serverOpen && c.accepted) return; // nobody reads it any more
+    c.in.append(p, n);
+    _unread += n;
+    mark(fd);
+}
+
+void MemoryTransport::hangup(int fd) {
+    if (!valid(fd) || !_conns[fd].clientOpen) return;
+    Conn& c = _conns[fd];
+    c.clientOpen = false;
+    if (!c.serverOpen && c.accepted) release(fd);
+    else mark(fd);
+}
+
+bool MemoryTransport::closedByServer(int fd) const {
+    return valid(fd) && _conns[fd].accepted && !_conns[fd].serverOpen;
+}
+
+const std::string& MemoryTransport::output(int fd) const {
+    static const std::string none;
+    return valid(fd) ? _conns[fd].out : none;
+}
+
+void MemoryTransport::takeOutput(int fd, std::string& out) {
+    out.clear();
+    if (valid(fd)) out.swap(_conns[fd].out);
+}
+
+unsigned long MemoryTransport::written(int fd) const { return valid(fd) ? _conns[fd].written : 0; }
+
+// There is only one way to watch in-memory descriptors; kind is ignored.
+Poller* MemoryTransport::createPoller(const std::string&) { return new MemoryPoller(*this); }
+
+const char* MemoryPoller::name() const { return "memory"; }
+
+void MemoryPoller::add(int fd, short events) { modify(fd, events); }
+
+void MemoryPoller::modify(int fd, short events) {
+    if (!_t.valid(fd)) return;
+    _t._conns[fd].events = events;
+    _t.mark(fd);
+}
+
+void MemoryPoller::remove(int fd) {
+    if (_t.valid(fd)) _t._conns[fd].events = 0;
+}
+
+// Report every marked descriptor that is ready; the idle ones leave the
+// list until something touches them again.
+int MemoryPoller::wait(std::vector<PollEvent>& ready, int) {
+    ready.clear();
+    std::vector<int>& list = _t._ready;
+    size_t keep = 0;
+    for (size_t i = 0; i < list.size(); ++i) {
+        int fd = list[i];
+        short r = _t.revents(fd);
+        if (!r) {
+            _t._conns[fd].marked = false;
+            continue;
+        }
+        PollEvent ev = { fd, r };
+        ready.push_back(ev);
+        list[keep++] = fd;
+    }
+    list.resize(keep);
+    return (int)ready.size();
+}
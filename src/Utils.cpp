@@ -1,13 +1,32 @@
 #include "Utils.hpp"
 #include <cctype>
+#include <cstring>
 #include <sstream>
+#include <time.h>
 
 std::string toLower(const std::string& s) {
     std::string out(s);
-    for (size_t i = 0; i < out.size(); ++i) out[i] = std::tolower(out[i]);
+    for (size_t i = 0; i < out.size(); ++i) out[i] = ircFold(out[i]);
     return out;
 }
 
+// FNV-1a over the folded bytes.
+unsigned long ircHash(const char* p, size_t n) {
+    unsigned long h = 2166136261UL;
+    for (size_t i = 0; i < n; ++i) {
+        h ^= (unsigned char)ircFold(p[i]);
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+bool ircEqual(const char* p, size_t n, const std::string& s) {
+    if (n != s.size()) return false;
+    for (size_t i = 0; i < n; ++i)
+        if (ircFold(p[i]) != ircFold(s[i])) return false;
+    return true;
+}
+
 static void trimCRLF(std::string& s) {
     while (!s.empty() && (s[s.size()-1] == '\r' || s[s.size()-1] == '\n'))
         s.erase(s.size()-1);
@@ -43,10 +62,60 @@ void splitCmd(const std::string& rawline,
     while (iss >> p) params.push_back(p);
 }
 
+static bool isWs(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+bool parseIrcLine(const char* line, size_t len, IrcLine& out) {
+    out.command = StrView();
+    out.nparams = 0;
+    out.trailing = StrView();
+    out.hasTrailing = false;
+
+    while (len && (line[len-1] == '\r' || line[len-1] == '\n')) --len;
+
+    // optional prefix starts with ':' — ignore (no s2s)
+    size_t pos = 0;
+    if (len && line[0] == ':') {
+        const char* sp = static_cast<const char*>(std::memchr(line, ' ', len));
+        if (!sp) return false;
+        pos = (sp - line) + 1;
+    }
+
+    // trailing starts with " :"
+    size_t head_end = len;
+    for (const char* sp = line + pos; (sp = static_cast<const char*>(std::memchr(sp, ' ', len - (sp - line)))); ++sp) {
+        if ((size_t)(sp - line) + 1 < len && sp[1] == ':') {
+            head_end = sp - line;
+            out.trailing = StrView(sp + 2, len - head_end - 2);
+            out.hasTrailing = true;
+            break;
+        }
+    }
+
+    // whitespace-separated head: command, then middle params
+    size_t i = pos;
+    bool first = true;
+    while (i < head_end) {
+        while (i < head_end && isWs(line[i])) ++i;
+        if (i >= head_end) break;
+        size_t start = i;
+        while (i < head_end && !isWs(line[i])) ++i;
+        StrView tok(line + start, i - start);
+        if (first) { out.command = tok; first = false; }
+        else if (out.nparams < IrcLine::MAX_PARAMS) out.params[out.nparams++] = tok;
+    }
+    return !out.command.empty();
+}
+
 bool isChannelName(const std::string& name) {
     return !name.empty() && (name[0] == '#' || name[0] == '&');
 }
 
+bool isChannelName(const StrView& name) {
+    return name.n && (name.p[0] == '#' || name.p[0] == '&');
+}
+
 bool isNickValid(const std::string& nick) {
     if (nick.empty()) return false;
     for (size_t i = 0; i < nick.size(); ++i) {
@@ -55,3 +124,15 @@ bool isNickValid(const std::string& nick) {
     }
     return true;
 }
+
+unsigned long monotonicUsec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)ts.tv_sec * 1000000UL + ts.tv_nsec / 1000;
+}
+
+unsigned long monotonicNsec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
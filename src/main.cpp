@@ -8,6 +8,7 @@
 #include "Server.hpp"
 #include <iostream>
 #include <cstdlib>
+#include <cstdio>
 
 /**
  * @brief Return true if the C-string consists only of decimal digits.
@@ -19,6 +20,45 @@ static bool is_number(const char* s) {
     return true;
 }
 
+/**
+ * @brief Parse "soft,drop,hard" SendQ limits (bytes) into a class.
+ * Malformed or out-of-order values are reported and the defaults kept.
+ */
+static void parse_sendq(const char* var, ServerConfig::ConnClass& k) {
+    const char* v = std::getenv(var);
+    if (!v) return;
+    unsigned long soft, drop, hard;
+    char extra;
+    if (std::sscanf(v, "%lu,%lu,%lu%c", &soft, &drop, &hard, &extra) != 3
+        || soft == 0 || soft > drop || drop > hard) {
+        std::cerr << var << ": expected soft,drop,hard with soft <= drop <= hard; using defaults\n";
+        return;
+    }
+    k.sendqSoft = soft;
+    k.sendqDrop = drop;
+    k.sendqHard = hard;
+}
+
+/**
+ * @brief Parse "rate,burst,backlog" input flood limits into a class.
+ * rate and burst are command-cost tokens (per second / bucket size),
+ * backlog is the deferred input in bytes tolerated before disconnecting.
+ */
+static void parse_flood(const char* var, ServerConfig::ConnClass& k) {
+    const char* v = std::getenv(var);
+    if (!v) return;
+    unsigned long rate, burst, backlog;
+    char extra;
+    if (std::sscanf(v, "%lu,%lu,%lu%c", &rate, &burst, &backlog, &extra) != 3
+        || rate == 0 || burst == 0 || backlog == 0) {
+        std::cerr << var << ": expected rate,burst,backlog (all > 0); using defaults\n";
+        return;
+    }
+    k.floodRate = rate;
+    k.floodBurst = burst;
+    k.floodBacklog = backlog;
+}
+
 /**
  * @brief Entry point: parse arguments, construct Server, and run.
  *
@@ -26,6 +66,28 @@ static bool is_number(const char* s) {
  * - <port> must be numeric (e.g., 6667)
  * - <password> is required and will be checked by PASS
  *
+ * Optional tunables come from the environment:
+ * - IRCSERV_POLLER: event backend, one of poll | epoll | epoll-et
+ * - IRCSERV_REACTORS: number of socket I/O threads (0 = single-threaded)
+ * - IRCSERV_BACKLOG: listen backlog (default 128; 0 = SOMAXCONN)
+ * - IRCSERV_ACCEPT_BUDGET: connections accepted per loop tick (default 64)
+ * - IRCSERV_WELCOME_BUDGET: new clients set up per loop tick (default 32)
+ * - IRCSERV_SENDQ_USER / IRCSERV_SENDQ_UNREG: "soft,drop,hard" SendQ bytes
+ *   for registered / unregistered clients (pause input, drop low-priority
+ *   lines, disconnect); defaults 256K,512K,1M and 16K,32K,64K
+ * - IRCSERV_SENDQ_TOTAL: bytes queued across all clients (default 256 MiB)
+ * - IRCSERV_REG_TIMEOUT: seconds allowed to register (default 60; 0 = off)
+ * - IRCSERV_PING_INTERVAL / IRCSERV_PING_TIMEOUT: idle seconds before a
+ *   server PING, and seconds to wait for a reply (defaults 120 / 60)
+ * - IRCSERV_POOL_KEEP: idle Client/Channel objects kept for reuse (default 1024)
+ * - IRCSERV_FLOOD_USER / IRCSERV_FLOOD_UNREG: "rate,burst,backlog" input
+ *   throttling (command-cost tokens per second, bucket size, deferred bytes
+ *   before disconnect); defaults 40,80,65536 and 10,20,8192
+ * - IRCSERV_ADMIN_SOCKET: filesystem path of a local socket that answers
+ *   every connection with a plain-text metrics dump (default: none)
+ * - IRCSERV_CAPTURE: file to record every dispatched client line to, for
+ *   replay with bench/ircreplay (default: none; the file holds passwords)
+ *
  * The server runs until terminated. Fatal exceptions produce a brief error.
  */
 int main(int ac, char** av) {
@@ -33,8 +95,25 @@ int main(int ac, char** av) {
         std::cerr << "Usage: " << av[0] << " <port> <password>\n";
         return 1;
     }
+    ServerConfig cfg;
+    if (const char* v = std::getenv("IRCSERV_POLLER")) cfg.poller = v;
+    if (const char* v = std::getenv("IRCSERV_REACTORS")) cfg.reactors = std::atoi(v);
+    if (const char* v = std::getenv("IRCSERV_BACKLOG")) cfg.backlog = std::atoi(v);
+    if (const char* v = std::getenv("IRCSERV_ACCEPT_BUDGET")) cfg.acceptBudget = std::atoi(v);
+    if (const char* v = std::getenv("IRCSERV_WELCOME_BUDGET")) cfg.welcomeBudget = std::atoi(v);
+    parse_sendq("IRCSERV_SENDQ_USER", cfg.classes[ServerConfig::CLASS_USER]);
+    parse_sendq("IRCSERV_SENDQ_UNREG", cfg.classes[ServerConfig::CLASS_UNREGISTERED]);
+    parse_flood("IRCSERV_FLOOD_USER", cfg.classes[ServerConfig::CLASS_USER]);
+    parse_flood("IRCSERV_FLOOD_UNREG", cfg.classes[ServerConfig::CLASS_UNREGISTERED]);
+    if (const char* v = std::getenv("IRCSERV_REG_TIMEOUT")) cfg.regTimeout = std::atoi(v);
+    if (const char* v = std::getenv("IRCSERV_PING_INTERVAL")) cfg.pingInterval = std::atoi(v);
+    if (const char* v = std::getenv("IRCSERV_PING_TIMEOUT")) cfg.pingTimeout = std::atoi(v);
+    if (const char* v = std::getenv("IRCSERV_POOL_KEEP")) cfg.poolKeep = std::atoi(v);
+    if (const char* v = std::getenv("IRCSERV_ADMIN_SOCKET")) cfg.adminSocket = v;
+    if (const char* v = std::getenv("IRCSERV_CAPTURE")) cfg.captureFile = v;
+    if (const char* v = std::getenv("IRCSERV_SENDQ_TOTAL")) cfg.sendqTotal = std::strtoul(v, 0, 10);
     try {
-        Server s(av[1], av[2]);
+        Server s(av[1], av[2], cfg);
         s.run();
     } catch (...) {
         std::cerr << "Fatal error\n";